@@ -0,0 +1,276 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "logger.h"
+
+Benchmark::Benchmark()
+        : recording(false)
+          , running(false)
+          , currentRun(0)
+          , currentFrame(0)
+{}
+
+Benchmark::~Benchmark()
+{}
+
+bool Benchmark::LoadPath(const std::string& path)
+{
+    std::ifstream in(path);
+    if(!in.is_open())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Couldn't open camera path \"" + path + "\"");
+        return false;
+    }
+
+    std::vector<CameraKeyframe> newPath;
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream lineStream(line);
+
+        CameraKeyframe keyframe;
+        lineStream >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                   >> keyframe.rotation.w >> keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z;
+
+        if(lineStream.fail())
+        {
+            Logger::LogLine(LOG_TYPE::WARNING, "Malformed keyframe in camera path \"" + path + "\": " + line);
+            return false;
+        }
+
+        newPath.push_back(keyframe);
+    }
+
+    if(newPath.empty())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Camera path \"" + path + "\" is empty");
+        return false;
+    }
+
+    cameraPath = std::move(newPath);
+
+    return true;
+}
+
+bool Benchmark::SavePath(const std::string& path) const
+{
+    std::ofstream out(path);
+    if(!out.is_open())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Couldn't open \"" + path + "\" for writing");
+        return false;
+    }
+
+    out << "# px py pz qw qx qy qz\n";
+    out.precision(9);
+    for(const CameraKeyframe& keyframe : cameraPath)
+        out << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+            << keyframe.rotation.w << " " << keyframe.rotation.x << " " << keyframe.rotation.y << " " << keyframe.rotation.z << "\n";
+
+    return true;
+}
+
+void Benchmark::StartRecording()
+{
+    cameraPath.clear();
+    recording = true;
+}
+
+void Benchmark::StopRecording()
+{
+    recording = false;
+}
+
+bool Benchmark::IsRecording() const
+{
+    return recording;
+}
+
+void Benchmark::Record(const PerspectiveCamera& camera)
+{
+    CameraKeyframe keyframe;
+    keyframe.position = camera.GetPosition();
+    keyframe.rotation = camera.GetRotationQuaternion();
+
+    cameraPath.push_back(keyframe);
+}
+
+bool Benchmark::Start(const std::vector<Run>& runs, const std::string& outputPath)
+{
+    if(cameraPath.empty())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Can't start benchmark without a camera path");
+        return false;
+    }
+
+    if(runs.empty())
+        return false;
+
+    recording = false;
+
+    this->runs = runs;
+    this->outputPath = outputPath;
+
+    running = true;
+    currentRun = 0;
+    currentFrame = 0;
+
+    // One sample per frame, GPU times fill them in as they arrive
+    samples.clear();
+    samples.reserve(runs.size() * cameraPath.size());
+    for(int run = 0; run < (int)runs.size(); ++run)
+    {
+        for(int frame = 0; frame < (int)cameraPath.size(); ++frame)
+            samples.push_back({ run, frame, 0.0f, 0.0f, 0.0f });
+    }
+
+    return true;
+}
+
+void Benchmark::Stop()
+{
+    running = false;
+}
+
+bool Benchmark::IsRunning() const
+{
+    return running;
+}
+
+const Benchmark::Run* Benchmark::BeginFrame(PerspectiveCamera& camera)
+{
+    const CameraKeyframe& keyframe = cameraPath[std::max(currentFrame - WARMUP_FRAMES, 0)];
+    camera.SetPosition(keyframe.position);
+    camera.SetRotation(keyframe.rotation);
+
+    return currentFrame == 0 ? &runs[currentRun] : nullptr;
+}
+
+int Benchmark::GetFrameId() const
+{
+    if(!running || currentFrame < WARMUP_FRAMES)
+        return -1;
+
+    return currentRun * (int)cameraPath.size() + currentFrame - WARMUP_FRAMES;
+}
+
+bool Benchmark::IsLastFrameOfRun() const
+{
+    return running && currentFrame - WARMUP_FRAMES == (int)cameraPath.size() - 1;
+}
+
+void Benchmark::SetLightCullTime(int frameId, GLuint64 time)
+{
+    if(frameId >= 0 && frameId < (int)samples.size())
+        samples[frameId].lightCullTime = time * 1e-6f;
+}
+
+void Benchmark::SetOpaqueTime(int frameId, GLuint64 time)
+{
+    if(frameId >= 0 && frameId < (int)samples.size())
+        samples[frameId].opaqueTime = time * 1e-6f;
+}
+
+void Benchmark::EndFrame(float frameTime)
+{
+    int frameId = GetFrameId();
+    if(frameId >= 0)
+        samples[frameId].frameTime = frameTime;
+
+    ++currentFrame;
+    if(currentFrame - WARMUP_FRAMES < (int)cameraPath.size())
+        return;
+
+    Logger::LogLine(LOG_TYPE::INFO, "Benchmark run ", currentRun + 1, "/", (int)runs.size(), " done");
+
+    currentFrame = 0;
+    ++currentRun;
+
+    if(currentRun == (int)runs.size())
+    {
+        running = false;
+        WriteResults();
+    }
+}
+
+bool Benchmark::WriteResults() const
+{
+    std::ofstream csv(outputPath + ".csv");
+    std::ofstream json(outputPath + ".json");
+    if(!csv.is_open() || !json.is_open())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Couldn't write benchmark results to \"" + outputPath + "\"");
+        return false;
+    }
+
+    // Times are in milliseconds
+    csv << "cullMode,lightCount,frame,lightCull,opaque,total\n";
+    for(const Sample& sample : samples)
+        csv << runs[sample.run].cullMode << ","
+            << runs[sample.run].lightCount << ","
+            << sample.frame << ","
+            << sample.lightCullTime << ","
+            << sample.opaqueTime << ","
+            << sample.frameTime << "\n";
+
+    auto writeStatistics = [&](const std::string& name, const std::vector<float>& values, bool last)
+    {
+        json << "      \"" << name << "\": { "
+             << "\"p50\": " << Percentile(values, 0.50f) << ", "
+             << "\"p95\": " << Percentile(values, 0.95f) << ", "
+             << "\"p99\": " << Percentile(values, 0.99f) << " }"
+             << (last ? "\n" : ",\n");
+    };
+
+    json << "{\n  \"frames\": " << cameraPath.size() << ",\n  \"runs\": [\n";
+    for(int i = 0; i < (int)runs.size(); ++i)
+    {
+        std::vector<float> lightCullTimes;
+        std::vector<float> opaqueTimes;
+        std::vector<float> frameTimes;
+
+        for(const Sample& sample : samples)
+        {
+            if(sample.run != i)
+                continue;
+
+            lightCullTimes.push_back(sample.lightCullTime);
+            opaqueTimes.push_back(sample.opaqueTime);
+            frameTimes.push_back(sample.frameTime);
+        }
+
+        json << "    {\n"
+             << "      \"cullMode\": \"" << runs[i].cullMode << "\",\n"
+             << "      \"lightCount\": " << runs[i].lightCount << ",\n";
+        writeStatistics("lightCull", lightCullTimes, false);
+        writeStatistics("opaque", opaqueTimes, false);
+        writeStatistics("total", frameTimes, true);
+        json << (i + 1 < (int)runs.size() ? "    },\n" : "    }\n");
+    }
+    json << "  ]\n}\n";
+
+    Logger::LogLine(LOG_TYPE::INFO, "Benchmark results written to \"" + outputPath + ".csv\" and \"" + outputPath + ".json\"");
+
+    return true;
+}
+
+float Benchmark::Percentile(std::vector<float> values, float percentile)
+{
+    if(values.empty())
+        return 0.0f;
+
+    // Nearest rank
+    int rank = (int)std::ceil(percentile * values.size());
+    int index = std::min(std::max(rank - 1, 0), (int)values.size() - 1);
+
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
@@ -0,0 +1,110 @@
+#ifndef BENCHMARK_H__
+#define BENCHMARK_H__
+
+#include <string>
+#include <vector>
+
+#include <GL/gl3w.h>
+
+#include "perspectiveCamera.h"
+
+/**
+* Replays a recorded camera path once per run and collects per-frame timings.
+*
+* Every frame of the path is rendered exactly once regardless of frame time,
+* so two runs see the same views. Each run starts with WARMUP_FRAMES frames
+* at the first keyframe that aren't recorded. GPU times arrive a few frames
+* late, so they are tagged with GetFrameId when issued and matched to their
+* frame afterwards; every time of a run has to be given before its last
+* EndFrame. Results are written as <output>.csv (every frame) and
+* <output>.json (p50/p95/p99 per run) once every run is done.
+*/
+class Benchmark
+{
+public:
+    Benchmark();
+    ~Benchmark();
+
+    struct CameraKeyframe
+    {
+        glm::vec3 position;
+        glm::quat rotation;
+    };
+
+    struct Run
+    {
+        std::string cullMode;
+        int lightCount;
+    };
+
+    const static int WARMUP_FRAMES = 16;
+
+    /**
+    * Path files have one keyframe per line: "px py pz qw qx qy qz"
+    */
+    bool LoadPath(const std::string& path);
+    bool SavePath(const std::string& path) const;
+
+    void StartRecording();
+    void StopRecording();
+    bool IsRecording() const;
+    // Call once per frame while recording
+    void Record(const PerspectiveCamera& camera);
+
+    bool Start(const std::vector<Run>& runs, const std::string& outputPath);
+    void Stop();
+    bool IsRunning() const;
+
+    /**
+    * Moves the camera to this frame's keyframe
+    *
+    * \returns the run to set up before rendering if this is its first frame, otherwise nullptr
+    */
+    const Run* BeginFrame(PerspectiveCamera& camera);
+    /**
+    * Identifies this frame's sample, -1 during warmup
+    */
+    int GetFrameId() const;
+    // If this frame is the last of its run, pending times have to be given before EndFrame
+    bool IsLastFrameOfRun() const;
+
+    /**
+    * Sets the time of a frame that may already have ended
+    *
+    * \param frameId as given by GetFrameId when the time was issued
+    * \param time nanoseconds
+    */
+    void SetLightCullTime(int frameId, GLuint64 time);
+    void SetOpaqueTime(int frameId, GLuint64 time);
+
+    /**
+    * \param frameTime milliseconds
+    */
+    void EndFrame(float frameTime);
+
+private:
+    struct Sample
+    {
+        int run;
+        int frame;
+        float lightCullTime;
+        float opaqueTime;
+        float frameTime;
+    };
+
+    std::vector<CameraKeyframe> cameraPath;
+    bool recording;
+
+    std::vector<Run> runs;
+    std::string outputPath;
+    bool running;
+    int currentRun;
+    int currentFrame;
+
+    std::vector<Sample> samples;
+
+    bool WriteResults() const;
+    static float Percentile(std::vector<float> values, float percentile);
+};
+
+#endif // BENCHMARK_H__
@@ -42,7 +42,11 @@ void main()
     vec4 projectedPosition = viewProjectionMatrix * vec4(WorldPosition, 1.0f);
     vec2 texel = ProjectedToTexel(projectedPosition.xy / projectedPosition.w);
 
-    const int arrayIndex = GetTreeDataScreen(int(texel.x), int(texel.y));
+    int leafDepth;
+    const int arrayIndex = GetTreeLeafScreen(int(texel.x), int(texel.y), leafDepth);
+
+    // A tile at leafDepth was written to leafDepth's write offsets, which are leafDepth + 1's read offsets
+    readWriteDepth = leafDepth + 1;
 
     vec3 finalColor = vec3(0.0f);
     vec3 textureColor = texture(tex, TexCoord).xyz;
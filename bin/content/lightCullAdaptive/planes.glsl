@@ -50,7 +50,7 @@ const int CENTER = 4;
     return viewPositions;
 }*/
 
-vec3[5] CreateFarPoints(uvec2 workGroupSize)
+vec3[5] CreateFarPoints(uvec2 tile, uvec2 workGroupSize)
 {
     const vec2 offsets[5] =
     {
@@ -65,7 +65,7 @@ vec3[5] CreateFarPoints(uvec2 workGroupSize)
 
     for(int j = 0; j < 5; ++j)
     {
-        vec3 ndcPosition = vec3(((vec2(gl_WorkGroupID.xy) + offsets[j])
+        vec3 ndcPosition = vec3(((vec2(tile) + offsets[j])
                                         * vec2(workGroupSize.x, workGroupSize.y))
                                         / vec2(screenWidth, screenHeight), 1.0f);
         ndcPosition.x *= 2.0f;
@@ -82,6 +82,11 @@ vec3[5] CreateFarPoints(uvec2 workGroupSize)
     return viewPositions;
 }
 
+vec3[5] CreateFarPoints(uvec2 workGroupSize)
+{
+    return CreateFarPoints(gl_WorkGroupID.xy, workGroupSize);
+}
+
 vec4[4] CreatePlanes(vec3 viewPositions[5])
 {
     vec4 planes[4];
@@ -0,0 +1,23 @@
+// Parent tiles that need to be refined, written by lightCompaction.comp.
+// Each parent depth has its own MAX_REFINE_TILES sized region
+layout(std430) buffer RefineTiles
+{
+    ivec2 refineTiles[];
+};
+
+// glDispatchComputeIndirect arguments (num_groups_x, num_groups_y, num_groups_z), one set per parent depth.
+// num_groups_x is four times the number of parent tiles since every parent has four children
+layout(std430) buffer DispatchArgs
+{
+    uint dispatchArgs[];
+};
+
+int GetRefineTilesOffset(int depth)
+{
+    return depth * MAX_REFINE_TILES;
+}
+
+int GetDispatchArgsOffset(int depth)
+{
+    return depth * 3;
+}
@@ -3,5 +3,7 @@ cconst THREADS_PER_GROUP_Y;
 
 cconst MAX_LIGHTS_PER_TILE;
 
+cconst MAX_REFINE_TILES;
+
 //cconst TREE_START_DEPTH;
 //cconst TREE_MAX_DEPTH;
\ No newline at end of file
@@ -15,30 +15,33 @@ layout(std430) buffer TileLights
     TileLightData tileLightData[];
 };
 
-layout(std140) uniform ReadWriteOffsets
+// Uploaded once, one entry per tree depth so no per-level updates are needed.
+// x: light indices read offset, y: light indices write offset,
+// z: tile light data read offset, w: tile light data write offset
+layout(std430) buffer ReadWriteOffsets
 {
-    int lightIndicesDataReadOffset;
-    int lightIndicesDataWriteOffset;
-    int tileLightDataReadOffset;
-    int tileLightDataWriteOffset;
+    ivec4 readWriteOffsets[];
 };
 
+// Has to be set before any of the functions below are called
+int readWriteDepth;
+
 int GetLightIndex(int index)
 {
-    return lightIndices[lightIndicesDataReadOffset + index];
+    return lightIndices[readWriteOffsets[readWriteDepth].x + index];
 }
 
 void SetLightIndex(int index, int data)
 {
-    lightIndices[lightIndicesDataWriteOffset + index] = data;
+    lightIndices[readWriteOffsets[readWriteDepth].y + index] = data;
 }
 
 TileLightData GetTileLightData(int index)
 {
-    return tileLightData[tileLightDataReadOffset + index];
+    return tileLightData[readWriteOffsets[readWriteDepth].z + index];
 }
 
 void SetTileLightData(int index, TileLightData data)
 {
-    tileLightData[tileLightDataWriteOffset + index] = data;
+    tileLightData[readWriteOffsets[readWriteDepth].w + index] = data;
 }
\ No newline at end of file
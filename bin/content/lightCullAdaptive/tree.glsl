@@ -148,6 +148,19 @@ int GetTreeDataGrid(int x, int y, int depth)
     return tree[depthOffset + index];
 }
 
+// Tiles without lights aren't refined, so the deepest node covering the pixel is searched for
+int GetTreeLeafScreen(int screenX, int screenY, out int leafDepth)
+{
+    for(leafDepth = treeMaxDepth; leafDepth > treeStartDepth; --leafDepth)
+    {
+        int index = GetTreeDataGrid(screenX / (screenWidth >> leafDepth), screenY / (screenHeight >> leafDepth), leafDepth);
+        if(index >= 0)
+            return index;
+    }
+
+    return GetTreeDataGrid(screenX / (screenWidth >> leafDepth), screenY / (screenHeight >> leafDepth), leafDepth);
+}
+
 void PutTreeDataScreen(uint x, uint y, int depth, int data)
 {
     PutTreeDataScreen(int(x), int(y), depth, data);
@@ -0,0 +1,43 @@
+#include "shared.glsh"
+
+layout(std430) buffer ScreenSize
+{
+    int screenWidth;
+    int screenHeight;
+};
+
+layout(std430) buffer Lights
+{
+    vec3 padding;
+    float ambientStrength;
+    LightData lights[];
+};
+
+// View space depth of the near and far plane, the slices are spread exponentially between them
+layout(std430) buffer ClusterDepth
+{
+    float nearPlane;
+    float farPlane;
+};
+
+// Every cluster allocates exactly as many indices as it needs by increasing (atomically) occupiedIndices
+layout(std430) buffer LightIndices
+{
+    int occupiedIndices; // Needs to be initialized to 0!
+    int lightIndices[];
+};
+
+// Accessed once per cluster
+layout(std430) buffer ClusterLights
+{
+    ClusterLightData clusterLightData[];
+};
+
+int GetClusterSlice(float viewDepth)
+{
+    if(viewDepth <= nearPlane)
+        return 0;
+
+    int slice = int(log(viewDepth / nearPlane) * (CLUSTER_SLICES / log(farPlane / nearPlane)));
+    return clamp(slice, 0, CLUSTER_SLICES - 1);
+}
@@ -0,0 +1,80 @@
+#version 450 core
+
+#include "commonIncludes.glsl"
+
+uniform mat4 viewProjectionMatrix;
+uniform mat4 worldMatrix;
+
+uniform sampler2D tex;
+uniform int materialIndex;
+
+in vec3 WorldPosition;
+in vec3 Normal;
+in vec2 TexCoord;
+
+out vec4 outColor;
+
+const int MAX_MATERIALS = 64;
+
+struct Material
+{
+    vec3 ambientColor;
+    float specularExponent;
+    vec3 diffuseColor;
+    float opacity;
+};
+
+layout (std140) uniform Materials
+{
+    Material materials[MAX_MATERIALS];
+};
+
+int GetFragmentClusterIndex()
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy) / ivec2(TILE_SIZE_X, TILE_SIZE_Y);
+    // w is 1 / view space depth for a perspective projection
+    int slice = GetClusterSlice(1.0f / gl_FragCoord.w);
+
+    return GetClusterIndex(tile, slice);
+}
+
+void main()
+{
+    vec3 textureColor = texture(tex, TexCoord).xyz;
+
+    vec3 finalColor = vec3(0.0f);
+
+    int arrayIndex = GetFragmentClusterIndex();
+
+    int lightStart = clusterLightData[arrayIndex].start;
+    int lightCount = clusterLightData[arrayIndex].numberOfLights;
+
+    for(int i = lightStart; i < lightStart + lightCount; ++i)
+    {
+        LightData light = lights[lightIndices[i]];
+
+        vec3 lightDirection = WorldPosition - light.position;
+        float lightDistance = length(lightDirection);
+
+        if(lightDistance > light.strength)
+            continue;
+
+        lightDirection = normalize(lightDirection);
+
+        float linearFactor = 2.0f / light.strength;
+        float quadraticFactor = 1.0f / (light.strength * light.strength);
+
+        float attenuation = 1.0f / (1.0f + linearFactor * lightDistance + quadraticFactor * lightDistance * lightDistance);
+        attenuation *= max((light.strength - lightDistance) / light.strength, 0.0f);
+
+        float diffuse = max(dot(-lightDirection, normalize(Normal)), 0.0f);
+
+        finalColor += light.color * diffuse * attenuation;
+    }
+
+    finalColor += ambientStrength;
+    finalColor *= materials[materialIndex].diffuseColor;
+    finalColor *= textureColor;
+
+    outColor = vec4(finalColor, materials[materialIndex].opacity);
+}
\ No newline at end of file
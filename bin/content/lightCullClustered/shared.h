@@ -0,0 +1,44 @@
+cconst THREADS_PER_GROUP_X;
+cconst THREADS_PER_GROUP_Y;
+
+cconst TILE_SIZE_X;
+cconst TILE_SIZE_Y;
+
+cconst TILE_COUNT_X;
+cconst TILE_COUNT_Y;
+
+cconst CLUSTER_SLICES;
+
+cconst MAX_LIGHTS_PER_CLUSTER;
+cconst MAX_LIGHT_INDICES;
+
+struct LightData
+{
+    vec3 position;
+    float strength;
+    vec3 color;
+    float padding;
+};
+
+struct ClusterLightData
+{
+    int start;
+    int numberOfLights;
+    int totalLights; // Lights touching the cluster, numberOfLights is less if some were dropped
+    int padding;
+};
+
+int GetClusterIndex(int tileX, int tileY, int slice)
+{
+    return (slice * TILE_COUNT_Y + tileY) * TILE_COUNT_X + tileX;
+}
+
+int GetClusterIndex(ivec2 tile, int slice)
+{
+    return GetClusterIndex(tile.x, tile.y, slice);
+}
+
+int GetClusterIndex(uvec2 tile, int slice)
+{
+    return GetClusterIndex(int(tile.x), int(tile.y), slice);
+}
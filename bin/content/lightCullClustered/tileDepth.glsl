@@ -0,0 +1,30 @@
+const int TILE_DEPTH_LEVELS = 9;
+
+// Min and max view space depth of each tile, written by depthReduction.comp.
+// Stored as a pyramid where level 0 is the whole screen and every level halves the tile size
+layout(std430) buffer TileDepth
+{
+    vec2 tileDepth[];
+};
+
+int GetTileDepthOffset(int level)
+{
+    // 4^0 + 4^1 + ... + 4^(level - 1)
+    return ((1 << (2 * level)) - 1) / 3;
+}
+
+int GetTileDepthIndex(ivec2 tile, int level)
+{
+    return GetTileDepthOffset(level) + tile.y * (1 << level) + tile.x;
+}
+
+vec2 GetTileDepth(ivec2 tile, int level)
+{
+    return tileDepth[GetTileDepthIndex(tile, level)];
+}
+
+bool InsideTileDepth(vec3 viewPosition, float radius, vec2 depthBounds)
+{
+    return viewPosition.z + radius >= depthBounds.x
+           && viewPosition.z - radius <= depthBounds.y;
+}
\ No newline at end of file
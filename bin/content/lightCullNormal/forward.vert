@@ -11,6 +11,9 @@ out vec3 WorldPosition;
 out vec3 Normal;
 out vec2 TexCoord;
 
+// Has to match zPrepass.vert since the forward pass uses GL_GEQUAL
+invariant gl_Position;
+
 void main()
 {
     vec4 tempWorldPosition = worldMatrix * vec4(position, 1.0f);
@@ -0,0 +1,23 @@
+#version 330 core
+
+// One instance per sprite, see SpriteRenderer::BatchData
+layout(location = 0) in vec4 position; // min.xy, max.xy
+layout(location = 1) in vec4 texCoords; // min.xy, max.xy in texels
+layout(location = 2) in vec4 color;
+
+out vec2 outTexCoord;
+out vec4 outColor;
+
+uniform mat4x4 viewProjMatrix;
+uniform sampler2D tex;
+
+void main()
+{
+    // Corners are indexed top left, top right, bottom right, bottom left
+    vec2 corner = vec2(gl_VertexID == 1 || gl_VertexID == 2, gl_VertexID >= 2);
+
+    outTexCoord = mix(texCoords.xy, texCoords.zw, corner) / vec2(textureSize(tex, 0));
+    outColor = color;
+
+    gl_Position = viewProjMatrix * vec4(mix(position.xy, position.zw, corner), 0.0f, 1.0f);
+}
\ No newline at end of file
@@ -9,5 +9,9 @@ uniform sampler2D tex;
 
 void main()
 {
-    finalColor = texture(tex, outTexCoord) * outColor;
+    // Sampled first so the lookup isn't in non-uniform control flow
+    vec4 texel = texture(tex, outTexCoord);
+
+    // Negative texture coordinates means a solid rectangle, see SpriteRenderer::SOLID_TEX_COORDS
+    finalColor = (outTexCoord.x < 0.0f ? vec4(1.0f) : texel) * outColor;
 }
\ No newline at end of file
@@ -8,10 +8,12 @@ out vec2 outTexCoord;
 out vec4 outColor;
 
 uniform mat4x4 viewProjMatrix;
+uniform sampler2D tex;
 
 void main()
 {
-    outTexCoord = texCoord;
+    // Texture coordinates are in texels so they stay valid if the texture is resized before this draw
+    outTexCoord = texCoord / vec2(textureSize(tex, 0));
     outColor = color;
 
     gl_Position = viewProjMatrix * vec4(position, 0.0f, 1.0f);
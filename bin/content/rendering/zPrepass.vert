@@ -0,0 +1,16 @@
+#version 330 core
+
+uniform mat4 viewProjectionMatrix;
+uniform mat4 worldMatrix;
+
+layout(location = 0) in vec3 position;
+
+// Has to match forward.vert since the forward pass uses GL_GEQUAL
+invariant gl_Position;
+
+void main()
+{
+    vec4 tempWorldPosition = worldMatrix * vec4(position, 1.0f);
+
+    gl_Position = viewProjectionMatrix * tempWorldPosition;
+}
\ No newline at end of file
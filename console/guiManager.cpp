@@ -2,6 +2,7 @@
 
 #include "../os/input.h"
 #include "../spriteRenderer.h"
+#include "../profiler.h"
 
 #include <algorithm>
 
@@ -62,6 +63,8 @@ void GUIManager::SendToLayer(GUIContainer* container, int layer)
 
 void GUIManager::Update(std::chrono::nanoseconds delta)
 {
+	PROFILE_ZONE("GUIManager::Update");
+
 	glm::vec2 mousePosition = Input::GetMousePosition();
 
 	//If any container is locked there is no need to check the rest for enter/exit events
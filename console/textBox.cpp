@@ -112,8 +112,10 @@ void TextBox::Draw(SpriteRenderer* spriteRenderer)
 		//Draw text
 		if(SelectionMade())
 		{
-			unsigned int selectionMinX = style->characterSet->GetWidthAtIndex(text.c_str(),selectionStartIndex);
-			unsigned int selectionMaxX = style->characterSet->GetWidthAtIndex(text.c_str(),selectionEndIndex);
+			const TextRun& run = style->characterSet->GetCachedRun(text.c_str(), text.size());
+
+			unsigned int selectionMinX = static_cast<unsigned int>(run.GetWidthAtIndex(selectionStartIndex));
+			unsigned int selectionMaxX = static_cast<unsigned int>(run.GetWidthAtIndex(selectionEndIndex));
 
 			//Selection highlight
 			glm::vec2 minPosition(workArea.GetMinPosition());
@@ -160,7 +162,7 @@ void TextBox::Draw(SpriteRenderer* spriteRenderer)
 
 		if(text != "")
 		{
-			int width = style->characterSet->GetWidthAtIndex(text.c_str(), cursorIndex);
+			int width = static_cast<int>(style->characterSet->GetCachedRun(text.c_str(), text.size()).GetWidthAtIndex(cursorIndex));
 
 			drawPosition.x += width + xOffset;
 
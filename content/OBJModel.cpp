@@ -8,8 +8,24 @@
 
 #include "texture.h"
 #include "textureCreationParameters.h"
+#include "contentManager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const static float SCALE = 0.01f;
+
+// Written to and read from cooked files as is
+static_assert(sizeof(glm::vec3) == sizeof(float) * 3, "Cooked models expect tightly packed vectors");
 
 OBJModel::OBJModel()
+        : whiteTexture(nullptr)
 {}
 
 OBJModel::~OBJModel()
@@ -39,8 +55,90 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
                                    , ContentManager* contentManager
                                    , ContentParameters* contentParameters)
 {
-    //LibOBJ::OBJModel model;
+    worldMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(SCALE)); // TODO
+
+    // A source that can't be read gets a size of 0, which is never cooked
+    FileData sourceFile = FileData::FromPath(filePath);
+    std::string cookedPath = std::string(filePath) + ".cooked";
+
+    std::vector<MaterialDescription> materialDescriptions;
+    if(!LoadCooked(cookedPath, sourceFile, materialDescriptions))
+    {
+        std::vector<Vertex> vertices;
+        std::vector<GLint> indices;
+
+        CONTENT_ERROR_CODES errorCode = Import(filePath, contentManager, vertices, indices, materialDescriptions);
+        if(errorCode != CONTENT_ERROR_CODES::NONE)
+            return errorCode;
+
+        if(!WriteCooked(cookedPath, sourceFile, vertices, indices, materialDescriptions))
+            Logger::LogLine(LOG_TYPE::WARNING, "Couldn't write cooked model \"" + cookedPath + "\", it will be imported again next time");
+
+        // Set up buffers
+        vertexBuffer.Init<Vertex, glm::vec3, glm::vec3, glm::vec2>(GLEnums::BUFFER_USAGE::STATIC_DRAW, vertices);
+        indexBuffer.Init(GLEnums::BUFFER_USAGE::STATIC_DRAW, indices);
+    }
 
+    CONTENT_ERROR_CODES errorCode = CreateMaterials(materialDescriptions, contentManager);
+    if(errorCode != CONTENT_ERROR_CODES::NONE)
+        return errorCode;
+
+    auto parameters = TryCastTo<OBJModelParameters>(contentParameters);
+
+    // Normal draw binds
+    if(!drawBinds.AddShaders(*contentManager
+                             , GLEnums::SHADER_TYPE::VERTEX, "lightCullAdaptive/forward.vert"
+                             , GLEnums::SHADER_TYPE::FRAGMENT, parameters->shaderPath))
+        return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
+
+    GLInputLayout vertexBufferLayout;
+    vertexBufferLayout.SetInputLayout<glm::vec3, glm::vec3, glm::vec2>();
+
+    drawBinds.AddBuffers(&indexBuffer
+                         , &vertexBuffer, vertexBufferLayout);
+
+    drawBinds.AddUniform("viewProjectionMatrix", glm::mat4x4());
+    drawBinds.AddUniform("worldMatrix", worldMatrix);
+    drawBinds.AddUniform("materialIndex", 0);
+    //drawBinds.AddUniform("lightIndicesDataReadOffset", 0);
+    //drawBinds.AddUniform("lightIndicesDataWriteOffset", 0);
+    //drawBinds.AddUniform("tileLightDataReadOffset", 0);
+    //drawBinds.AddUniform("tileLightDataWriteOffset", 0);
+
+    if(!drawBinds.Init())
+        return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
+
+    std::vector<GPUMaterial> gpuMaterials;
+    gpuMaterials.reserve(materials.size());
+
+    for(const auto& material : materials)
+        gpuMaterials.push_back(GPUMaterial(material));
+
+    drawBinds["Materials"] = gpuMaterials;
+
+    // Depth prepass draw binds
+    if(!depthDrawBinds.AddShaders(*contentManager
+                                  , GLEnums::SHADER_TYPE::VERTEX, "rendering/zPrepass.vert"))
+        return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
+
+    depthDrawBinds.AddBuffers(&indexBuffer
+                              , &vertexBuffer, vertexBufferLayout);
+
+    depthDrawBinds.AddUniform("viewProjectionMatrix", glm::mat4x4());
+    depthDrawBinds.AddUniform("worldMatrix", worldMatrix);
+
+    if(!depthDrawBinds.Init())
+        return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
+
+    return CONTENT_ERROR_CODES::NONE;
+}
+
+CONTENT_ERROR_CODES OBJModel::Import(const char* filePath
+                                     , ContentManager* contentManager
+                                     , std::vector<Vertex>& vertices
+                                     , std::vector<GLint>& indices
+                                     , std::vector<MaterialDescription>& materialDescriptions)
+{
     Assimp::Importer importer;
 
     const aiScene* scene = importer.ReadFile(filePath
@@ -61,7 +159,7 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
     directoryPrefix.erase(directoryPrefix.find_last_of('/') + 1);
     for(int i = 0; i < scene->mNumMaterials; ++i)
     {
-        Material newMaterial;
+        MaterialDescription newMaterial;
 
         aiMaterial* material = scene->mMaterials[i];
 
@@ -78,35 +176,12 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
         aiString textureName;
         aiGetMaterialString(material, AI_MATKEY_TEXTURE_DIFFUSE(0), &textureName);
 
-        Texture* newTexture;
-
-        if(textureName.length == 0)
-        {
-            if(!contentManager->HasCreated("whiteTexture"))
-            {
-                Logger::LogLine(LOG_TYPE::FATAL, "whiteTexture needs to be created before OBJ is loaded if it is needed");
-                return CONTENT_ERROR_CODES::COULDNT_OPEN_DEPENDENCY_FILE;
-            }
-
-            TextureCreationParameters parameters("whiteTexture");
+        if(textureName.length != 0)
+            newMaterial.texturePath = directoryPrefix + textureName.data;
 
-            newTexture = contentManager->Load<Texture>("", &parameters);
-        }
-        else
-        {
-            newTexture = contentManager->Load<Texture>(directoryPrefix + textureName.data);
-            if(newTexture == nullptr)
-                return CONTENT_ERROR_CODES::COULDNT_OPEN_DEPENDENCY_FILE;
-        }
-
-        newMaterial.texture = newTexture;
-
-        materials.push_back(newMaterial);
+        materialDescriptions.push_back(newMaterial);
     }
 
-    std::vector<Vertex> vertices;
-    std::vector<GLint> indices;
-
     std::vector<aiMesh*> opaqueMeshes;
     std::vector<aiMesh*> transparentMeshes;
 
@@ -114,7 +189,7 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
     {
         aiMesh* mesh = scene->mMeshes[i];
 
-        if(materials[mesh->mMaterialIndex].opacity < 1.0f)
+        if(materialDescriptions[mesh->mMaterialIndex].opacity < 1.0f)
             transparentMeshes.push_back(mesh);
         else
             opaqueMeshes.push_back(mesh);
@@ -154,13 +229,11 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
 
         newDrawData.indexCount = (int)(indices.size() - newDrawData.indexOffset);
         newDrawData.materialIndex = mesh->mMaterialIndex;
+        newDrawData.centerPosition = glm::vec3(0.0f);
         
         opaqueDrawData.push_back(newDrawData);
     }
 
-    const static float SCALE = 0.01f;
-    worldMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(SCALE)); // TODO
-
     for(aiMesh* mesh : transparentMeshes)
     {
         DrawData newDrawData;
@@ -206,46 +279,257 @@ CONTENT_ERROR_CODES OBJModel::Load(const char* filePath
         transparentDrawData.push_back(newDrawData);
     }
 
-    // Set up buffers
-    vertexBuffer.Init<Vertex, glm::vec3, glm::vec3, glm::vec2>(GLEnums::BUFFER_USAGE::STATIC_DRAW, vertices);
-    indexBuffer.Init(GLEnums::BUFFER_USAGE::STATIC_DRAW, indices);
+    return CONTENT_ERROR_CODES::NONE;
+}
 
-    auto parameters = TryCastTo<OBJModelParameters>(contentParameters);
+bool OBJModel::LoadCooked(const std::string& cookedPath
+                          , const FileData& sourceFile
+                          , std::vector<MaterialDescription>& materialDescriptions)
+{
+    int file = open(cookedPath.c_str(), O_RDONLY);
+    if(file == -1)
+        return false;
 
-    // Normal draw binds
-    if(!drawBinds.AddShaders(*contentManager
-                             , GLEnums::SHADER_TYPE::VERTEX, "lightCullAdaptive/forward.vert"
-                             , GLEnums::SHADER_TYPE::FRAGMENT, parameters->shaderPath))
-        return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
+    struct stat fileStat;
+    if(fstat(file, &fileStat) == -1
+       || fileStat.st_size < (off_t)sizeof(CookedHeader))
+    {
+        close(file);
+        return false;
+    }
 
-    GLInputLayout vertexBufferLayout;
-    vertexBufferLayout.SetInputLayout<glm::vec3, glm::vec3, glm::vec2>();
+    size_t fileSize = (size_t)fileStat.st_size;
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
 
-    drawBinds.AddBuffers(&indexBuffer
-                         , &vertexBuffer, vertexBufferLayout);
+    if(mapping == MAP_FAILED)
+        return false;
 
-    drawBinds.AddUniform("viewProjectionMatrix", glm::mat4x4());
-    drawBinds.AddUniform("worldMatrix", worldMatrix);
-    drawBinds.AddUniform("materialIndex", 0);
-    //drawBinds.AddUniform("lightIndicesDataReadOffset", 0);
-    //drawBinds.AddUniform("lightIndicesDataWriteOffset", 0);
-    //drawBinds.AddUniform("tileLightDataReadOffset", 0);
-    //drawBinds.AddUniform("tileLightDataWriteOffset", 0);
+    const char* data = (const char*)mapping;
 
-    if(!drawBinds.Init())
-        return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
+    CookedHeader header;
+    std::memcpy(&header, data, sizeof(CookedHeader));
 
-    std::vector<GPUMaterial> gpuMaterials;
-    gpuMaterials.reserve(materials.size());
+    FileData cookedSource;
+    cookedSource.path = sourceFile.path;
+    cookedSource.lastWriteDate = std::experimental::filesystem::file_time_type(std::experimental::filesystem::file_time_type::duration(header.sourceWriteTime));
+    cookedSource.size = header.sourceSize;
 
-    for(const auto& material : materials)
-        gpuMaterials.push_back(GPUMaterial(material));
+    // Counts are widened before multiplying so a garbage header can't wrap around
+    size_t drawCount = (size_t)header.opaqueDrawCount + header.transparentDrawCount;
 
-    drawBinds["Materials"] = gpuMaterials;
+    size_t verticesOffset = sizeof(CookedHeader);
+    size_t indicesOffset = verticesOffset + (size_t)header.vertexCount * sizeof(Vertex);
+    size_t drawDataOffset = indicesOffset + (size_t)header.indexCount * sizeof(GLint);
+    size_t materialsOffset = drawDataOffset + drawCount * sizeof(CookedDrawData);
+    size_t stringsOffset = materialsOffset + (size_t)header.materialCount * sizeof(CookedMaterial);
+
+    if(header.magic != COOKED_MAGIC
+       || header.version != COOKED_VERSION
+       || cookedSource != sourceFile)
+    {
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    const GLint* indices = (const GLint*)(data + indicesOffset);
+    const CookedDrawData* drawData = (const CookedDrawData*)(data + drawDataOffset);
+    const CookedMaterial* materials = (const CookedMaterial*)(data + materialsOffset);
+
+    // A truncated file or one written by something else is imported again instead of
+    // reading outside the mapping or drawing outside the buffers
+    bool valid = stringsOffset + header.stringsSize == fileSize
+                 && header.vertexCount > 0
+                 && header.indexCount > 0;
+
+    for(size_t i = 0; valid && i < header.indexCount; ++i)
+        valid = indices[i] >= 0 && (uint32_t)indices[i] < header.vertexCount;
+
+    for(size_t i = 0; valid && i < drawCount; ++i)
+    {
+        valid = drawData[i].materialIndex >= 0
+                && (uint32_t)drawData[i].materialIndex < header.materialCount
+                && drawData[i].indexOffset >= 0
+                && drawData[i].indexCount >= 0
+                && (uint64_t)drawData[i].indexOffset + (uint64_t)drawData[i].indexCount <= header.indexCount;
+    }
+
+    for(size_t i = 0; valid && i < header.materialCount; ++i)
+        valid = (uint64_t)materials[i].texturePathOffset + materials[i].texturePathLength <= header.stringsSize;
+
+    if(!valid)
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Cooked model \"" + cookedPath + "\" is broken, importing it again");
+        munmap(mapping, fileSize);
+        return false;
+    }
+
+    for(int i = 0; i < (int)drawCount; ++i)
+    {
+        DrawData newDrawData;
+        newDrawData.materialIndex = drawData[i].materialIndex;
+        newDrawData.indexOffset = drawData[i].indexOffset;
+        newDrawData.indexCount = drawData[i].indexCount;
+        newDrawData.centerPosition = drawData[i].centerPosition;
+
+        if(i < (int)header.opaqueDrawCount)
+            opaqueDrawData.push_back(newDrawData);
+        else
+            transparentDrawData.push_back(newDrawData);
+    }
+
+    for(int i = 0; i < (int)header.materialCount; ++i)
+    {
+        MaterialDescription newMaterial;
+        newMaterial.ambientColor = materials[i].ambientColor;
+        newMaterial.specularExponent = materials[i].specularExponent;
+        newMaterial.diffuseColor = materials[i].diffuseColor;
+        newMaterial.opacity = materials[i].opacity;
+
+        newMaterial.texturePath.assign(data + stringsOffset + materials[i].texturePathOffset, materials[i].texturePathLength);
+
+        materialDescriptions.push_back(newMaterial);
+    }
+
+    // GLBufferBase::Init never modifies the data
+    vertexBuffer.Init<glm::vec3, glm::vec3, glm::vec2>(GLEnums::BUFFER_USAGE::STATIC_DRAW, const_cast<char*>(data + verticesOffset), header.vertexCount);
+    indexBuffer.Init<GLint>(GLEnums::BUFFER_USAGE::STATIC_DRAW, const_cast<char*>(data + indicesOffset), (GLsizei)header.indexCount);
+
+    munmap(mapping, fileSize);
+
+    return true;
+}
+
+bool OBJModel::WriteCooked(const std::string& cookedPath
+                           , const FileData& sourceFile
+                           , const std::vector<Vertex>& vertices
+                           , const std::vector<GLint>& indices
+                           , const std::vector<MaterialDescription>& materialDescriptions) const
+{
+    if(sourceFile.size == 0 || vertices.empty() || indices.empty())
+        return false;
+
+    std::vector<CookedDrawData> drawData;
+    for(const std::vector<DrawData>* drawDataList : { &opaqueDrawData, &transparentDrawData })
+    {
+        for(const DrawData& data : *drawDataList)
+        {
+            CookedDrawData newDrawData;
+            newDrawData.materialIndex = data.materialIndex;
+            newDrawData.indexOffset = data.indexOffset;
+            newDrawData.indexCount = data.indexCount;
+            newDrawData.centerPosition = data.centerPosition;
+
+            drawData.push_back(newDrawData);
+        }
+    }
+
+    std::vector<CookedMaterial> materials;
+    std::string strings;
+    for(const MaterialDescription& material : materialDescriptions)
+    {
+        CookedMaterial newMaterial;
+        newMaterial.ambientColor = material.ambientColor;
+        newMaterial.specularExponent = material.specularExponent;
+        newMaterial.diffuseColor = material.diffuseColor;
+        newMaterial.opacity = material.opacity;
+        newMaterial.texturePathOffset = (uint32_t)strings.size();
+        newMaterial.texturePathLength = (uint32_t)material.texturePath.size();
+
+        strings += material.texturePath;
+        materials.push_back(newMaterial);
+    }
+
+    CookedHeader header;
+    header.magic = COOKED_MAGIC;
+    header.version = COOKED_VERSION;
+    header.sourceWriteTime = (int64_t)sourceFile.lastWriteDate.time_since_epoch().count();
+    header.sourceSize = (uint64_t)sourceFile.size;
+    header.vertexCount = (uint32_t)vertices.size();
+    header.indexCount = (uint32_t)indices.size();
+    header.opaqueDrawCount = (uint32_t)opaqueDrawData.size();
+    header.transparentDrawCount = (uint32_t)transparentDrawData.size();
+    header.materialCount = (uint32_t)materials.size();
+    header.stringsSize = (uint32_t)strings.size();
+
+    // Write to a temporary file first so a half written file is never loaded
+    std::string temporaryPath = cookedPath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!out.is_open())
+            return false;
+
+        out.write((const char*)&header, sizeof(CookedHeader));
+        out.write((const char*)&vertices[0], vertices.size() * sizeof(Vertex));
+        out.write((const char*)&indices[0], indices.size() * sizeof(GLint));
+        if(!drawData.empty())
+            out.write((const char*)&drawData[0], drawData.size() * sizeof(CookedDrawData));
+        if(!materials.empty())
+            out.write((const char*)&materials[0], materials.size() * sizeof(CookedMaterial));
+        out.write(strings.data(), strings.size());
+
+        if(!out.good())
+        {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(temporaryPath.c_str(), cookedPath.c_str()) == 0;
+}
+
+CONTENT_ERROR_CODES OBJModel::CreateMaterials(const std::vector<MaterialDescription>& materialDescriptions
+                                              , ContentManager* contentManager)
+{
+    if(!contentManager->HasCreated("whiteTexture"))
+    {
+        Logger::LogLine(LOG_TYPE::FATAL, "whiteTexture needs to be created before OBJ is loaded");
+        return CONTENT_ERROR_CODES::COULDNT_OPEN_DEPENDENCY_FILE;
+    }
+
+    TextureCreationParameters parameters("whiteTexture");
+    whiteTexture = contentManager->Load<Texture>("", &parameters);
+
+    // Textures are decoded on the loader threads and uploaded by FinishAsyncLoads,
+    // the model can be drawn before they're done
+    for(const MaterialDescription& description : materialDescriptions)
+    {
+        Material newMaterial;
+        newMaterial.ambientColor = description.ambientColor;
+        newMaterial.specularExponent = description.specularExponent;
+        newMaterial.diffuseColor = description.diffuseColor;
+        newMaterial.opacity = description.opacity;
+        newMaterial.texture = nullptr;
+
+        if(!description.texturePath.empty())
+            newMaterial.pendingTexture = contentManager->LoadAsync<Texture>(description.texturePath);
+
+        materials.push_back(newMaterial);
+    }
 
     return CONTENT_ERROR_CODES::NONE;
 }
 
+void OBJModel::UpdateTextures()
+{
+    for(Material& material : materials)
+    {
+        if(material.pendingTexture.IsReady())
+        {
+            material.texture = material.pendingTexture.Get();
+            material.pendingTexture = ContentHandle<Texture>();
+        }
+    }
+}
+
+Texture* OBJModel::GetTexture(int materialIndex) const
+{
+    Texture* texture = materials[materialIndex].texture;
+
+    return texture != nullptr ? texture : whiteTexture;
+}
+
 void OBJModel::Unload(ContentManager* contentManager)
 {
 
@@ -271,8 +555,24 @@ DiskContent* OBJModel::CreateInstance() const
     return new OBJModel;
 }
 
+void OBJModel::DrawDepth()
+{
+    if(opaqueDrawData.empty())
+        return;
+
+    depthDrawBinds.Bind();
+
+    // Opaque meshes are placed first in the index buffer, so they can be drawn with a single call
+    const DrawData& lastData = opaqueDrawData.back();
+    depthDrawBinds.DrawElements(lastData.indexOffset + lastData.indexCount, 0);
+
+    depthDrawBinds.Unbind();
+}
+
 void OBJModel::DrawOpaque()
 {
+    UpdateTextures();
+
     drawBinds.Bind();
 
     auto materialIndex = drawBinds["materialIndex"];
@@ -281,7 +581,7 @@ void OBJModel::DrawOpaque()
     {
         materialIndex = data.materialIndex;
 
-        glBindTexture(GL_TEXTURE_2D, materials[data.materialIndex].texture->GetTexture());
+        glBindTexture(GL_TEXTURE_2D, GetTexture(data.materialIndex)->GetTexture());
         drawBinds.DrawElements(data.indexCount, data.indexOffset);
     }
 
@@ -290,6 +590,8 @@ void OBJModel::DrawOpaque()
 
 void OBJModel::DrawTransparent(const glm::vec3 cameraPosition)
 {
+    UpdateTextures();
+
     drawBinds.Bind();
 
     auto materialIndex = drawBinds["materialIndex"];
@@ -315,7 +617,7 @@ void OBJModel::DrawTransparent(const glm::vec3 cameraPosition)
     {
         materialIndex = data.materialIndex;
 
-        glBindTexture(GL_TEXTURE_2D, materials[data.materialIndex].texture->GetTexture());
+        glBindTexture(GL_TEXTURE_2D, GetTexture(data.materialIndex)->GetTexture());
         drawBinds.DrawElements(data.indexCount, data.indexOffset);
     }
 
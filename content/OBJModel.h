@@ -1,7 +1,11 @@
 #ifndef OBJMODEL_H__
 #define OBJMODEL_H__
 
+#include <cstdint>
+
 #include "content.h"
+#include "contentHandle.h"
+#include "fileData.h"
 #include "../gl/glDrawBinds.h"
 
 class Texture;
@@ -12,6 +16,17 @@ struct OBJModelParameters
     std::string shaderPath;
 };
 
+/**
+* A model imported through assimp.
+*
+* The first load writes the imported data to "<filePath>.cooked", later loads
+* memory-map that instead of running the importer. The cooked file remembers
+* the source's write time and size and is rebuilt when either changes.
+*
+* Textures are loaded with ContentManager::LoadAsync and drawn as
+* whiteTexture until they are finished, so ContentManager::FinishAsyncLoads
+* has to be called every frame.
+*/
 class OBJModel
         : public DiskContent
 {
@@ -27,7 +42,9 @@ public:
 
     // FIXME
     GLDrawBinds drawBinds; // TODO
+    GLDrawBinds depthDrawBinds;
 
+    void DrawDepth();
     void DrawOpaque();
     void DrawTransparent(const glm::vec3 cameraPosition);
 
@@ -43,6 +60,10 @@ protected:
     DiskContent* CreateInstance() const override;
 
 private:
+    // Bump whenever Import or the cooked layout changes
+    const static uint32_t COOKED_VERSION = 1;
+    const static uint32_t COOKED_MAGIC = 0x4D4F4654; // "TFOM"
+
     struct Vertex
     {
         Vertex()
@@ -65,7 +86,9 @@ private:
         glm::vec3 diffuseColor; // Kd
         float opacity;
 
+        // nullptr while loading or if it couldn't be loaded, whiteTexture is drawn instead
         Texture* texture;
+        ContentHandle<Texture> pendingTexture;
     };
 
     struct GPUMaterial
@@ -95,14 +118,99 @@ private:
         float distanceToCamera;
     };
 
+    // A Material before its texture is loaded
+    struct MaterialDescription
+    {
+        glm::vec3 ambientColor;
+        float specularExponent;
+
+        glm::vec3 diffuseColor;
+        float opacity;
+
+        // Relative to the content root, empty for whiteTexture
+        std::string texturePath;
+    };
+
+    /**
+    * A cooked file is laid out as:
+    * CookedHeader
+    * Vertex[vertexCount]
+    * GLint[indexCount]
+    * CookedDrawData[opaqueDrawCount + transparentDrawCount]
+    * CookedMaterial[materialCount]
+    * char[stringsSize], every texture path without terminators
+    */
+    struct CookedHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+
+        // Source file's FileData when it was cooked
+        int64_t sourceWriteTime;
+        uint64_t sourceSize;
+
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t opaqueDrawCount;
+        uint32_t transparentDrawCount;
+        uint32_t materialCount;
+        uint32_t stringsSize;
+    };
+
+    struct CookedDrawData
+    {
+        int32_t materialIndex;
+        int32_t indexOffset;
+        int32_t indexCount;
+        glm::vec3 centerPosition;
+    };
+
+    struct CookedMaterial
+    {
+        glm::vec3 ambientColor;
+        float specularExponent;
+
+        glm::vec3 diffuseColor;
+        float opacity;
+
+        uint32_t texturePathOffset;
+        uint32_t texturePathLength;
+    };
+
     std::vector<DrawData> opaqueDrawData;
     std::vector<DrawData> transparentDrawData;
     std::vector<Material> materials;
+    Texture* whiteTexture;
 
     GLIndexBuffer indexBuffer;
     GLVertexBuffer vertexBuffer;
 
     glm::mat4 worldMatrix;
+
+    CONTENT_ERROR_CODES Import(const char* filePath
+                               , ContentManager* contentManager
+                               , std::vector<Vertex>& vertices
+                               , std::vector<GLint>& indices
+                               , std::vector<MaterialDescription>& materialDescriptions);
+    /**
+    * Fills in draw data and initializes the vertex and index buffers straight
+    * from the mapped file
+    *
+    * \returns false if the cooked file is missing, stale, or broken
+    */
+    bool LoadCooked(const std::string& cookedPath
+                    , const FileData& sourceFile
+                    , std::vector<MaterialDescription>& materialDescriptions);
+    bool WriteCooked(const std::string& cookedPath
+                     , const FileData& sourceFile
+                     , const std::vector<Vertex>& vertices
+                     , const std::vector<GLint>& indices
+                     , const std::vector<MaterialDescription>& materialDescriptions) const;
+    CONTENT_ERROR_CODES CreateMaterials(const std::vector<MaterialDescription>& materialDescriptions
+                                        , ContentManager* contentManager);
+    // Picks up textures that have finished loading
+    void UpdateTextures();
+    Texture* GetTexture(int materialIndex) const;
 };
 
 #endif // OBJMODEL_H__
@@ -0,0 +1,289 @@
+#include "bcEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// EXT_texture_compression_s3tc isn't core, so glcorearb.h might not have it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+    uint16_t To565(const uint8_t* color)
+    {
+        return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+    }
+
+    void From565(uint16_t color, int* out)
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+
+        // Replicate the top bits so that 31 becomes 255 rather than 248
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+    }
+}
+
+GLenum BCEncoder::GetGLFormat(BC_FORMAT format)
+{
+    switch(format)
+    {
+        case BC_FORMAT::BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BC_FORMAT::BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BC_FORMAT::BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+    }
+
+    return 0;
+}
+
+size_t BCEncoder::GetEncodedSize(BC_FORMAT format, unsigned int width, unsigned int height)
+{
+    size_t blockSize = format == BC_FORMAT::BC1 ? 8 : 16;
+
+    return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+bool BCEncoder::HasAlpha(const uint8_t* rgba, unsigned int width, unsigned int height)
+{
+    for(size_t i = 0, end = (size_t)width * height; i < end; ++i)
+    {
+        if(rgba[i * 4 + 3] != 255)
+            return true;
+    }
+
+    return false;
+}
+
+void BCEncoder::Encode(BC_FORMAT format, const uint8_t* rgba, unsigned int width, unsigned int height, uint8_t* out)
+{
+    uint8_t block[64];
+
+    for(unsigned int blockY = 0; blockY < height; blockY += 4)
+    {
+        for(unsigned int blockX = 0; blockX < width; blockX += 4)
+        {
+            for(unsigned int y = 0; y < 4; ++y)
+            {
+                unsigned int sourceY = std::min(blockY + y, height - 1);
+
+                for(unsigned int x = 0; x < 4; ++x)
+                {
+                    unsigned int sourceX = std::min(blockX + x, width - 1);
+                    std::memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sourceY * width + sourceX) * 4], 4);
+                }
+            }
+
+            switch(format)
+            {
+                case BC_FORMAT::BC1:
+                    EncodeBC1Block(block, out);
+                    out += 8;
+                    break;
+                case BC_FORMAT::BC3:
+                    EncodeBC4Block(block, 3, out);
+                    EncodeBC1Block(block, out + 8);
+                    out += 16;
+                    break;
+                case BC_FORMAT::BC5:
+                    EncodeBC4Block(block, 0, out);
+                    EncodeBC4Block(block, 1, out + 8);
+                    out += 16;
+                    break;
+            }
+        }
+    }
+}
+
+void BCEncoder::EncodeBC1Block(const uint8_t* block, uint8_t* out)
+{
+    uint8_t minColor[4];
+    uint8_t maxColor[4];
+
+#if defined(__SSE2__)
+    __m128i row0 = _mm_loadu_si128((const __m128i*)(block + 0));
+    __m128i row1 = _mm_loadu_si128((const __m128i*)(block + 16));
+    __m128i row2 = _mm_loadu_si128((const __m128i*)(block + 32));
+    __m128i row3 = _mm_loadu_si128((const __m128i*)(block + 48));
+
+    __m128i minRow = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+    __m128i maxRow = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+    // Reduce the four pixels left in each register to one
+    minRow = _mm_min_epu8(minRow, _mm_shuffle_epi32(minRow, _MM_SHUFFLE(1, 0, 3, 2)));
+    minRow = _mm_min_epu8(minRow, _mm_shuffle_epi32(minRow, _MM_SHUFFLE(2, 3, 0, 1)));
+    maxRow = _mm_max_epu8(maxRow, _mm_shuffle_epi32(maxRow, _MM_SHUFFLE(1, 0, 3, 2)));
+    maxRow = _mm_max_epu8(maxRow, _mm_shuffle_epi32(maxRow, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    int minPacked = _mm_cvtsi128_si32(minRow);
+    int maxPacked = _mm_cvtsi128_si32(maxRow);
+    std::memcpy(minColor, &minPacked, 4);
+    std::memcpy(maxColor, &maxPacked, 4);
+#else
+    std::memcpy(minColor, block, 4);
+    std::memcpy(maxColor, block, 4);
+
+    for(int i = 1; i < 16; ++i)
+    {
+        for(int channel = 0; channel < 4; ++channel)
+        {
+            minColor[channel] = std::min(minColor[channel], block[i * 4 + channel]);
+            maxColor[channel] = std::max(maxColor[channel], block[i * 4 + channel]);
+        }
+    }
+#endif
+
+    // Pull the endpoints in by 1/16 of the range, the extremes are rarely the best fit
+    for(int channel = 0; channel < 3; ++channel)
+    {
+        int inset = (maxColor[channel] - minColor[channel]) >> 4;
+
+        minColor[channel] = (uint8_t)(minColor[channel] + inset);
+        maxColor[channel] = (uint8_t)(maxColor[channel] - inset);
+    }
+
+    uint16_t color0 = To565(maxColor);
+    uint16_t color1 = To565(minColor);
+
+    // color0 > color1 selects the four colour mode
+    if(color0 < color1)
+        std::swap(color0, color1);
+
+    int palette[4][3];
+    From565(color0, palette[0]);
+    From565(color1, palette[1]);
+    for(int channel = 0; channel < 3; ++channel)
+    {
+        palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+        palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+    }
+
+    int indices[16];
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+    __m128i paletteColors[4];
+    for(int i = 0; i < 4; ++i)
+        paletteColors[i] = _mm_setr_epi16((short)palette[i][0], (short)palette[i][1], (short)palette[i][2], 0
+                                          , (short)palette[i][0], (short)palette[i][1], (short)palette[i][2], 0);
+
+    for(int row = 0; row < 4; ++row)
+    {
+        __m128i pixels = _mm_and_si128(_mm_loadu_si128((const __m128i*)(block + row * 16)), rgbMask);
+
+        // Two pixels per register as 16 bit r, g, b, 0
+        __m128i pixelsLow = _mm_unpacklo_epi8(pixels, zero);
+        __m128i pixelsHigh = _mm_unpackhi_epi8(pixels, zero);
+
+        __m128i bestDistance = _mm_set1_epi32(0x7FFFFFFF);
+        __m128i bestIndex = _mm_setzero_si128();
+
+        for(int i = 0; i < 4; ++i)
+        {
+            __m128i differenceLow = _mm_sub_epi16(pixelsLow, paletteColors[i]);
+            __m128i differenceHigh = _mm_sub_epi16(pixelsHigh, paletteColors[i]);
+
+            // r*r + g*g and b*b + 0 for every pixel, then add each pair
+            __m128i distanceLow = _mm_madd_epi16(differenceLow, differenceLow);
+            __m128i distanceHigh = _mm_madd_epi16(differenceHigh, differenceHigh);
+            distanceLow = _mm_add_epi32(distanceLow, _mm_srli_epi64(distanceLow, 32));
+            distanceHigh = _mm_add_epi32(distanceHigh, _mm_srli_epi64(distanceHigh, 32));
+
+            // Lanes 0 and 2 of each hold a pixel's distance
+            __m128i distance = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(distanceLow)
+                                                               , _mm_castsi128_ps(distanceHigh)
+                                                               , _MM_SHUFFLE(2, 0, 2, 0)));
+
+            __m128i closer = _mm_cmplt_epi32(distance, bestDistance);
+            bestDistance = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, bestDistance));
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)), _mm_andnot_si128(closer, bestIndex));
+        }
+
+        _mm_storeu_si128((__m128i*)&indices[row * 4], bestIndex);
+    }
+#else
+    for(int pixel = 0; pixel < 16; ++pixel)
+    {
+        int bestDistance = 0x7FFFFFFF;
+
+        for(int i = 0; i < 4; ++i)
+        {
+            int distance = 0;
+            for(int channel = 0; channel < 3; ++channel)
+            {
+                int difference = block[pixel * 4 + channel] - palette[i][channel];
+                distance += difference * difference;
+            }
+
+            if(distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[pixel] = i;
+            }
+        }
+    }
+#endif
+
+    uint32_t packedIndices = 0;
+    if(color0 != color1)
+    {
+        for(int pixel = 0; pixel < 16; ++pixel)
+            packedIndices |= (uint32_t)indices[pixel] << (pixel * 2);
+    }
+
+    out[0] = (uint8_t)(color0 & 0xFF);
+    out[1] = (uint8_t)(color0 >> 8);
+    out[2] = (uint8_t)(color1 & 0xFF);
+    out[3] = (uint8_t)(color1 >> 8);
+    for(int i = 0; i < 4; ++i)
+        out[4 + i] = (uint8_t)(packedIndices >> (i * 8));
+}
+
+void BCEncoder::EncodeBC4Block(const uint8_t* block, int channel, uint8_t* out)
+{
+    int minValue = 255;
+    int maxValue = 0;
+
+    for(int pixel = 0; pixel < 16; ++pixel)
+    {
+        minValue = std::min(minValue, (int)block[pixel * 4 + channel]);
+        maxValue = std::max(maxValue, (int)block[pixel * 4 + channel]);
+    }
+
+    // maxValue > minValue selects the eight value mode, which interpolates from max to min
+    out[0] = (uint8_t)maxValue;
+    out[1] = (uint8_t)minValue;
+
+    uint64_t packedIndices = 0;
+    if(maxValue != minValue)
+    {
+        int range = maxValue - minValue;
+
+        for(int pixel = 0; pixel < 16; ++pixel)
+        {
+            // Steps from max towards min, 0 is max and 7 is min
+            int step = ((maxValue - block[pixel * 4 + channel]) * 7 + range / 2) / range;
+            uint64_t index = (uint64_t)(step == 0 ? 0 : (step == 7 ? 1 : step + 1));
+
+            packedIndices |= index << (pixel * 3);
+        }
+    }
+
+    for(int i = 0; i < 6; ++i)
+        out[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+}
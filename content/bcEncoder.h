@@ -0,0 +1,50 @@
+#ifndef BCENCODER_H__
+#define BCENCODER_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/gl3w.h>
+
+enum class BC_FORMAT
+        : uint32_t
+{
+    BC1 = 0 // RGB, 4 bits per pixel
+    , BC3 // RGBA, 8 bits per pixel
+    , BC5 // RG, 8 bits per pixel. For normal maps
+};
+
+/**
+* A block compression encoder fast enough to run at load time.
+*
+* Every 4x4 block picks its endpoints from the bounding box of its colours
+* (inset slightly, see "Real-Time DXT Compression" by J.M.P. van Waveren) and
+* then maps every pixel to the closest palette entry. The BC1 part is SSE2.
+* Quality is a bit lower than an offline encoder that searches for endpoints.
+*
+* Input is always tightly packed RGBA8. Sizes that aren't a multiple of 4 are
+* padded by repeating the last row/column.
+*/
+class BCEncoder
+{
+public:
+    static GLenum GetGLFormat(BC_FORMAT format);
+    static size_t GetEncodedSize(BC_FORMAT format, unsigned int width, unsigned int height);
+
+    /**
+    * \returns whether any pixel isn't fully opaque, i.e. if BC3 is needed over BC1
+    */
+    static bool HasAlpha(const uint8_t* rgba, unsigned int width, unsigned int height);
+
+    /**
+    * \param out at least GetEncodedSize(format, width, height) bytes
+    */
+    static void Encode(BC_FORMAT format, const uint8_t* rgba, unsigned int width, unsigned int height, uint8_t* out);
+
+private:
+    // block is 4x4 RGBA8 pixels, row by row
+    static void EncodeBC1Block(const uint8_t* block, uint8_t* out);
+    static void EncodeBC4Block(const uint8_t* block, int channel, uint8_t* out);
+};
+
+#endif // BCENCODER_H__
@@ -2,46 +2,219 @@
 
 #include "../logger.h"
 #include "contentManager.h"
-#include "memoryTexture.h"
-#include "textureCreationParameters.h"
+#include "glyphAtlas.h"
 
-#include <map>
-#include <set>
-#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 #include <freetype2/ft2build.h>
 #include FT_FREETYPE_H
 
-#ifndef NDEBUG
-#include <assert.h>
-#endif // NDEBUG
+namespace
+{
+	uint64_t HashRun(const char* text, size_t length, int maxWidth)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+
+		for(size_t i = 0; i < length; ++i)
+		{
+			hash ^= (uint64_t)(unsigned char)text[i];
+			hash *= 1099511628211ull;
+		}
+
+		hash ^= (uint64_t)(uint32_t)maxWidth;
+		hash *= 1099511628211ull;
+
+		return hash;
+	}
+}
 
 CharacterSet::CharacterSet()
-	: fontSize(0)
+	: characterLookup()
+	, fontSize(0)
 	, lineHeight((unsigned int)-1)
 	, spaceXAdvance((unsigned int)-1)
-	, texture(nullptr)
+	, baselineOffset(0)
+	, ftLibrary(nullptr)
+	, face(nullptr)
+	, atlas(nullptr)
+	, contentManager(nullptr)
 {
 }
 
 const Character* CharacterSet::GetCharacter(unsigned int id) const
 {
-	auto iter = characters.find(id);
+	if(id < LOOKUP_TABLE_SIZE)
+	{
+		if(characterLookup[id] == nullptr)
+			characterLookup[id] = FindCharacter(id);
+
+		return characterLookup[id];
+	}
+
+	return FindCharacter(id);
+}
+
+void CharacterSet::LayoutRun(const char* text, size_t length, int maxWidth, TextRun& out) const
+{
+	out.glyphs.clear();
+	out.glyphs.reserve(length);
+	out.advance = 0.0f;
+
+	if(atlas == nullptr)
+		return;
+
+	int currentWidth = 0;
+	for(size_t i = 0; i < length; ++i)
+	{
+		const Character* character = GetCharacter(text[i]);
+
+		if(character->xAdvance > maxWidth - currentWidth)
+			break;
+
+		GlyphQuad glyph;
+		glyph.positionMin = glm::vec2(currentWidth + character->xOffset, (int)lineHeight - character->yOffset);
+		glyph.positionMax = glyph.positionMin + glm::vec2(character->width, character->height);
+		glyph.texCoordsMin = glm::vec2(character->x, character->y);
+		glyph.texCoordsMax = glm::vec2(character->x + character->width, character->y + character->height);
+		glyph.penX = (float)currentWidth;
+
+		out.glyphs.push_back(glyph);
+
+		currentWidth += character->xAdvance;
+	}
+
+	out.advance = (float)currentWidth;
+}
 
+const TextRun& CharacterSet::GetCachedRun(const char* text, size_t length, int maxWidth /*= NO_MAX_WIDTH*/) const
+{
+	uint64_t hash = HashRun(text, length, maxWidth);
+
+	auto matches = [&](const CachedRun& cachedRun)
+	{
+		return cachedRun.maxWidth == maxWidth
+			   && cachedRun.text.size() == length
+			   && cachedRun.text.compare(0, length, text, length) == 0;
+	};
+
+	auto iter = cachedRuns.find(hash);
+	if(iter != cachedRuns.end() && matches(iter->second))
+		return iter->second.run;
+
+	if(cachedRuns.size() >= MAX_CACHED_RUNS)
+	{
+		previousCachedRuns = std::move(cachedRuns);
+		cachedRuns.clear();
+	}
+
+	CachedRun& cachedRun = cachedRuns[hash];
+
+	auto previousIter = previousCachedRuns.find(hash);
+	if(previousIter != previousCachedRuns.end() && matches(previousIter->second))
+	{
+		cachedRun = std::move(previousIter->second);
+		previousCachedRuns.erase(previousIter);
+	}
+	else
+	{
+		cachedRun.text.assign(text, length);
+		cachedRun.maxWidth = maxWidth;
+		LayoutRun(text, length, maxWidth, cachedRun.run);
+	}
+
+	return cachedRun.run;
+}
+
+const Character* CharacterSet::FindCharacter(unsigned int id) const
+{
+	auto iter = characters.find(id);
 	if(iter != characters.end())
 		return &iter->second;
-	else
+
+	const Character* character = RasterizeCharacter(id);
+	if(character != nullptr)
+		return character;
+
+	iter = characters.find(errorCharacterID);
+	if(iter != characters.end())
 	{
-		iter = characters.find(errorCharacterID);
+		// Store the error character as id so it isn't rasterized again
+		Character errorCharacter = iter->second;
+		errorCharacter.id = (int)id;
 
-		if(iter != characters.end())
-			return &iter->second;
-		else
+		return &characters.emplace(id, errorCharacter).first->second;
+	}
+
+	Logger::LogLine(LOG_TYPE::WARNING, "CharacterSet::errorCharacterID set to a non-existing character (make sure CharacterSet is loaded)");
+	return &characters.begin()->second;
+}
+
+const Character* CharacterSet::RasterizeCharacter(unsigned int id) const
+{
+	if(face == nullptr
+	   || atlas == nullptr
+	   || id > MAX_CODE_POINT
+	   || FT_Get_Char_Index(face, id) == 0)
+		return nullptr;
+
+	if(FT_Load_Char(face, id, FT_LOAD_RENDER) != 0)
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Couldn't render character with ID ", id, " with size ", fontSize);
+		return nullptr;
+	}
+
+	FT_GlyphSlot slot = face->glyph;
+	const FT_Bitmap& bitmap = slot->bitmap;
+
+	int width = (int)bitmap.width;
+	int height = (int)bitmap.rows;
+
+#ifndef NDEBUG
+	if(width > std::numeric_limits<unsigned char>().max())
+		Logger::LogLine(LOG_TYPE::WARNING, "Character width is greater than max value of an unsigned char");
+	if(height > std::numeric_limits<unsigned char>().max())
+		Logger::LogLine(LOG_TYPE::WARNING, "Character height is greater than max value of an unsigned char");
+#endif // NDEBUG
+
+	Character character((int)id
+						, 0
+						, 0
+						, static_cast<unsigned char>(width)
+						, static_cast<unsigned char>(height)
+						, static_cast<char>(slot->bitmap_left)
+						, static_cast<char>(slot->bitmap_top - baselineOffset)
+						, static_cast<unsigned short>(slot->advance.x >> 6));
+
+	if(width > 0 && height > 0)
+	{
+		// The atlas wants tightly packed rows
+		std::vector<uint8_t> packedPixels;
+		const uint8_t* pixels = bitmap.buffer;
+		if(bitmap.pitch != width)
 		{
-			Logger::LogLine(LOG_TYPE::WARNING, "CharacterSet::errorCharacterID set to a non-existing character (make sure CharacterSet is loaded)");
-			return &characters.begin()->second;
+			packedPixels.resize((size_t)width * height);
+			for(int y = 0; y < height; ++y)
+				std::memcpy(&packedPixels[(size_t)y * width], bitmap.buffer + y * bitmap.pitch, (size_t)width);
+
+			pixels = packedPixels.data();
+		}
+
+		int x;
+		int y;
+		if(!atlas->Add(width, height, pixels, x, y))
+		{
+			Logger::LogLine(LOG_TYPE::WARNING, "Glyph atlas is full, character with ID ", id, " with size ", fontSize, " will be drawn as the error character");
+			return nullptr;
 		}
+
+		character.x = (unsigned short)x;
+		character.y = (unsigned short)y;
 	}
+
+	return &characters.emplace(id, character).first->second;
 }
 
 unsigned int CharacterSet::GetFontSize() const
@@ -51,29 +224,96 @@ unsigned int CharacterSet::GetFontSize() const
 
 Texture* CharacterSet::GetTexture() const
 {
-	return texture;
+	return atlas;
 }
 
 CONTENT_ERROR_CODES CharacterSet::Load(const char* filePath, ContentManager* contentManager /*= nullptr*/, ContentParameters* contentParameters /*= nullptr*/)
 {
-	unsigned int width;
-	unsigned int height;
+	if(!OpenFace(filePath))
+		return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
 
-	std::vector<uint8_t> buffer = CreateBuffer(filePath, width, height);
+	atlas = GlyphAtlas::LoadShared(contentManager);
+	if(atlas == nullptr)
+	{
+		CloseFace();
+		return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
+	}
 
-	//Needed to fix some crash...?
-	std::string uniqueID(filePath);
-	uniqueID += "Texture";
+	this->contentManager = contentManager;
 
-	TextureCreationParameters textureParameters(uniqueID.c_str(), width, height, GLEnums::INTERNAL_FORMAT::RGBA8, GLEnums::FORMAT::RGBA, GLEnums::TYPE::UNSIGNED_BYTE, &buffer[0]);
-	this->texture = contentManager->Load<MemoryTexture>("", &textureParameters);
+	// Everything else is rasterized when it's first used
+	GetCharacter(errorCharacterID);
+	spaceXAdvance = (unsigned int)GetCharacter(SPACE_CHARACTER)->xAdvance;
 
 	return CONTENT_ERROR_CODES::NONE;
 }
 
 void CharacterSet::Unload(ContentManager* contentManager)
 {
-	contentManager->Unload(texture);
+	CloseFace();
+
+	if(atlas != nullptr)
+		contentManager->Unload(atlas);
+
+	atlas = nullptr;
+}
+
+bool CharacterSet::OpenFace(const char* filePath)
+{
+	auto error = FT_Init_FreeType(&ftLibrary);
+	if(error)
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Couldn't initialize FreeType. No fonts will be available");
+		ftLibrary = nullptr;
+		return false;
+	}
+
+	std::string filePathString(filePath);
+
+	auto nameAndSize = GetFontNameAndSize(filePathString);
+
+	error = FT_New_Face(ftLibrary, nameAndSize.first.c_str(), 0, &face);
+
+	if(error == FT_Err_Unknown_File_Format)
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Font file at " + filePathString + ", (" + nameAndSize.first + ")" + " is unsupported");
+		face = nullptr;
+		CloseFace();
+		return false;
+	}
+	else if(error)
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Font file at " + filePathString + ", (" + nameAndSize.first + ")" + " couldn't be created");
+		face = nullptr;
+		CloseFace();
+		return false;
+	}
+
+	fontSize = (unsigned int)nameAndSize.second;
+	error = FT_Set_Pixel_Sizes(face, 0, fontSize);
+	if(error)
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Couldn't set pixel sizes");
+		CloseFace();
+		return false;
+	}
+
+	lineHeight = (unsigned int)(face->size->metrics.height >> 6);
+	baselineOffset = (int)(face->size->metrics.descender >> 6);
+
+	return true;
+}
+
+void CharacterSet::CloseFace()
+{
+	if(face != nullptr)
+		FT_Done_Face(face);
+
+	if(ftLibrary != nullptr)
+		FT_Done_FreeType(ftLibrary);
+
+	face = nullptr;
+	ftLibrary = nullptr;
 }
 
 std::pair<std::string, int> CharacterSet::GetFontNameAndSize(const std::string& path) const
@@ -136,224 +376,6 @@ std::pair<std::string, int> CharacterSet::GetFontNameAndSize(const std::string&
 	return std::make_pair(fontName + extension, size);
 }
 
-std::vector<uint8_t> CharacterSet::CreateBuffer(const char* filePath, unsigned int& width, unsigned int& height)
-{
-	std::vector<uint8_t> returnVector;
-
-	//////////////////////////////////////////////////
-	//Init FreeType
-	//////////////////////////////////////////////////
-	static FT_Library ftLibrary;
-
-	auto error = FT_Init_FreeType(&ftLibrary);
-	if(error)
-	{
-		Logger::LogLine(LOG_TYPE::WARNING, "Couldn't initialize FreeType. No fonts will be available");
-		return returnVector;
-	}
-
-	FT_Face face;
-
-	std::string filePathString(filePath);
-
-	auto nameAndSize = GetFontNameAndSize(filePathString);
-
-	error = FT_New_Face(ftLibrary, nameAndSize.first.c_str(), 0, &face);
-
-	if(error == FT_Err_Unknown_File_Format)
-	{
-		Logger::LogLine(LOG_TYPE::WARNING, "Font file at " + filePathString + ", (" + nameAndSize.first + ")" + " is unsupported");
-		FT_Done_FreeType(ftLibrary);
-		return returnVector;
-	}
-	else if(error)
-	{
-		Logger::LogLine(LOG_TYPE::WARNING, "Font file at " + filePathString + ", (" + nameAndSize.first + ")" + " couldn't be created");
-		FT_Done_FreeType(ftLibrary);
-		return returnVector;
-	}
-
-	fontSize = (unsigned int)nameAndSize.second;
-	error = FT_Set_Pixel_Sizes(face, 0, fontSize);
-	if(error)
-	{
-		Logger::LogLine(LOG_TYPE::WARNING, "Couldn't set pixel sizes");
-		FT_Done_Face(face);
-		FT_Done_FreeType(ftLibrary);
-		return returnVector;
-	}
-
-	FT_GlyphSlot slot = face->glyph;
-
-	//////////////////////////////////////////////////
-	//Get all characters
-	//////////////////////////////////////////////////
-	//Sort characters by width when inserting into set
-	struct CharacterComparison
-	{
-		bool operator()(const Character& lhs, const Character& rhs) const
-		{
-			return lhs.width > rhs.width;
-		}
-	};
-
-    // Used to offset every character so that all characters are placed within the correct bounds.
-    // Otherwise, _ could be below the line since it's under the baseline
-    int baselineOffset = 0;
-
-	std::multiset<Character, CharacterComparison> tempCharacters;
-    for(int i = 32; i <= 126; ++i)
-	{
-		error = FT_Load_Char(face, i, FT_LOAD_DEFAULT);
-		if(error)
-		{
-			Logger::LogLine(LOG_TYPE::WARNING, "Couldn't load character with ID ", i, " when trying to load font ", nameAndSize.first, " with size ", fontSize, ". Character will be ignored");
-			continue;
-		}
-
-#ifndef NDEBUG
-		if(slot->metrics.width >> 6 > std::numeric_limits<unsigned char>().max())
-			Logger::LogLine(LOG_TYPE::WARNING, "Character width is greater than max value of an unsigned char");
-		if(slot->metrics.height >> 6 > std::numeric_limits<unsigned char>().max())
-			Logger::LogLine(LOG_TYPE::WARNING, "Character height is greater than max value of an unsigned char");
-		if(slot->metrics.horiBearingX >> 6 > std::numeric_limits<char>().max())
-			Logger::LogLine(LOG_TYPE::WARNING, "Character x bearing is greater than max value of a char");
-		if(slot->metrics.horiBearingY >> 6 < std::numeric_limits<char>().min())
-			Logger::LogLine(LOG_TYPE::WARNING, "Character y bearing is less than min value of a char");
-		if(slot->advance.x >> 6 > std::numeric_limits<unsigned char>().max())
-			Logger::LogLine(LOG_TYPE::WARNING, "Character x-advance is greater than min value of a char");
-#endif // NDEBUG
-
-        tempCharacters.insert(Character(i
-                                        , (unsigned short)-1 // Assigned later (below)
-                                        , (unsigned short)-1 // Assigned later (below)
-                                        , static_cast<unsigned char>(slot->metrics.width >> 6)
-                                        , static_cast<unsigned char>(slot->metrics.height >> 6)
-                                        , static_cast<char>(slot->metrics.horiBearingX >> 6)
-                                        , static_cast<char>(slot->metrics.horiBearingY >> 6)
-                                        , static_cast<unsigned short>(slot->advance.x >> 6)));
-
-        baselineOffset = std::min(baselineOffset, (int)((slot->metrics.horiBearingY >> 6) - (slot->metrics.height >> 6)));
-	}
-
-	lineHeight = (unsigned int)(face->size->metrics.height >> 6);
-
-	//////////////////////////////////////////////////
-	//Pack characters
-	//////////////////////////////////////////////////
-	//Simple biggest to smallest (width-wise) packing
-	//From top left to bottom right
-	int posX = 0;
-	int posY = 0;
-
-	//Very simple and probably not well-fitting since not all characters are the same size
-	int dimension = static_cast<int>(std::ceil(std::sqrt(tempCharacters.size())));
-
-	width = (unsigned int)(dimension * tempCharacters.begin()->width);
-
-	// Round to next power of two to create a texture of that size
-	--width;
-	width |= width >> 1;
-	width |= width >> 2;
-	width |= width >> 4;
-	width |= width >> 8;
-	width |= width >> 16;
-	++width;
-
-#ifndef NDEBUG
-        std::set<int> removedCharacters;
-#endif // NDEBUG
-
-	for(auto iter = tempCharacters.begin(), end = tempCharacters.end(); iter != end; ++iter)
-	{
-		if(static_cast<uint32_t>(posX + iter->width) > width)
-		{
-			//Fit smaller characters until it's not possible anymore.
-			//Characters are sorted after width, so lower_bound will
-			//always return an element after iter
-			auto tempIter = tempCharacters.lower_bound(Character(0, 0, 0, (unsigned char)(width - posX), 0, 0, 0, 0));
-			while(tempIter != tempCharacters.end())
-			{
-				Character character = *tempIter;
-				character.x = (unsigned short)posX;
-				character.y = (unsigned short)posY;
-
-#ifndef NDEBUG
-				assert(removedCharacters.find(character.id) == removedCharacters.end());
-				assert(static_cast<uint32_t>(character.x + character.width) <= width);
-				removedCharacters.insert(character.id);
-#endif // NDEBUG
-
-				characters.insert(std::make_pair(character.id, character));
-
-				tempCharacters.erase(tempIter);
-
-				posX += character.width;
-				tempIter = tempCharacters.lower_bound(Character(0, 0, 0, (unsigned char)(width - posX), 0, 0, 0, 0));
-			}
-
-			posX = 0;
-			posY += lineHeight;
-		}
-
-		Character character = *iter;
-		character.x = (unsigned short)posX;
-		character.y = (unsigned short)posY;
-
-#ifndef NDEBUG
-		assert(removedCharacters.find(character.id) == removedCharacters.end());
-		assert(static_cast<uint32_t>(character.x + character.width) <= width);
-#endif // NDEBUG
-
-		posX += character.width;
-
-		characters.insert(std::make_pair(character.id, character));
-	}
-
-	height = posY + lineHeight;
-
-	--height;
-	height |= height >> 1;
-	height |= height >> 2;
-	height |= height >> 4;
-	height |= height >> 8;
-	height |= height >> 16;
-	++height;
-
-	returnVector.resize(width * height * 4, 0);
-	for(auto& character : characters)
-	{
-		error = FT_Load_Char(face, character.first, FT_LOAD_RENDER);
-		if(error)
-		{
-			Logger::LogLine(LOG_TYPE::WARNING, "Couldn't render character with ID ", character.first, " when trying to load font ", nameAndSize.first, " with size ", fontSize, ". Character will be ignored");
-			characters.erase(character.first);
-			continue;
-		}
-
-        //TODO: Implement swizzling
-		for(int y = static_cast<int>(character.second.height) - 1; y >= 0; --y)
-        {
-            for(int x = 0, endX = static_cast<int>(character.second.width); x < endX; ++x)
-            {
-                returnVector[(character.second.y + y) * width * 4 + (character.second.x + x) * 4] = 255;
-                returnVector[(character.second.y + y) * width * 4 + (character.second.x + x) * 4 + 1] = 255;
-                returnVector[(character.second.y + y) * width * 4 + (character.second.x + x) * 4 + 2] = 255;
-                returnVector[(character.second.y + y) * width * 4 + (character.second.x + x) * 4 + 3] = slot->bitmap.buffer[y * slot->bitmap.width + x];
-            }
-        }
-
-        character.second.yOffset -= baselineOffset;
-	}
-
-	FT_Done_Face(face);
-	FT_Done_FreeType(ftLibrary);
-
-    spaceXAdvance = (unsigned int)GetCharacter(SPACE_CHARACTER)->xAdvance;
-
-	return returnVector;
-}
-
 int CharacterSet::GetStaticVRAMUsage() const
 {
 	return 0;
@@ -403,11 +425,33 @@ bool CharacterSet::Apply(Content* content)
 	if(other == nullptr)
 		return false;
 
+	// Release what this set owned before taking over other's
+	CloseFace();
+
+	if(atlas != nullptr)
+		contentManager->Unload(atlas);
+
 	this->characters = std::move(other->characters);
 	this->fontSize = other->fontSize;
 	this->lineHeight = other->lineHeight;
 	this->spaceXAdvance = other->spaceXAdvance;
-    this->texture = other->texture;
+	this->baselineOffset = other->baselineOffset;
+	this->ftLibrary = other->ftLibrary;
+	this->face = other->face;
+	this->atlas = other->atlas;
+	this->contentManager = other->contentManager;
+
+	// This set owns them now
+	other->ftLibrary = nullptr;
+	other->face = nullptr;
+	other->atlas = nullptr;
+	other->contentManager = nullptr;
+
+	std::fill(std::begin(characterLookup), std::end(characterLookup), nullptr);
+
+	// Laid out with the old metrics
+	cachedRuns.clear();
+	previousCachedRuns.clear();
 
 	return true;
 }
@@ -6,12 +6,60 @@
 #include "content.h"
 #include "characterBlock.h"
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <glm/vec2.hpp>
+
 class ContentManager;
+class GlyphAtlas;
 class Texture;
 
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+/**
+* A glyph laid out by CharacterSet::LayoutRun, relative to the origin of the run
+*/
+struct GlyphQuad
+{
+	glm::vec2 positionMin;
+	glm::vec2 positionMax;
+
+	// In texels, since the atlas can grow and move every normalized coordinate
+	glm::vec2 texCoordsMin;
+	glm::vec2 texCoordsMax;
+
+	// Pen position before this glyph
+	float penX;
+};
+
+/**
+* A whole string laid out in one pass. Has one glyph per character, until
+* the run was cut off by its max width
+*/
+struct TextRun
+{
+	std::vector<GlyphQuad> glyphs;
+
+	// Pen position after the last glyph
+	float advance = 0.0f;
+
+	/**
+	* Same as CharacterSet::GetWidthAtIndex, without walking the string again
+	*/
+	float GetWidthAtIndex(size_t index) const
+	{
+		return index < glyphs.size() ? glyphs[index].penX : advance;
+	}
+};
+
+/**
+* A font at one size. Glyphs are rasterized with FreeType the first time
+* they're used and packed into the GlyphAtlas shared by every CharacterSet
+*/
 class CharacterSet
 	: public DiskContent
 {
@@ -20,6 +68,7 @@ public:
 	~CharacterSet() = default;
 
 	const static int SPACE_CHARACTER = ' '; //Change this if needed. Should correspond to your desired value for a blankspace
+	const static int NO_MAX_WIDTH = 0x7FFFFFFF;
 
 	unsigned int GetFontSize() const;
 	Texture* GetTexture() const;
@@ -42,6 +91,18 @@ public:
     unsigned int GetRowsAtWidth(const char* text, unsigned int width) const;
     unsigned int GetWidthAtMaxWidth(const char* text, unsigned int maxWidth) const;
 
+    /**
+    * Lays out length characters of text, stopping before the first one that
+    * would make the run wider than maxWidth
+    */
+    void LayoutRun(const char* text, size_t length, int maxWidth, TextRun& out) const;
+    /**
+    * Same as LayoutRun, but reuses the run if the same text was laid out with
+    * the same maxWidth recently. The returned run is only valid until the
+    * next call
+    */
+    const TextRun& GetCachedRun(const char* text, size_t length, int maxWidth = NO_MAX_WIDTH) const;
+
     std::vector<CharacterBlock> Split(const char* text) const;
     std::vector<CharacterBlock> Split(const char* text, const std::string& separators, const bool keepSeparators) const;
 
@@ -62,6 +123,18 @@ protected:
 private:
 	const unsigned int errorCharacterID = 0x3F; //0x3F = "?"
 
+	const static unsigned int LOOKUP_TABLE_SIZE = 128;
+	const static unsigned int MAX_CODE_POINT = 0x10FFFF;
+	const static size_t MAX_CACHED_RUNS = 512;
+
+	struct CachedRun
+	{
+		std::string text;
+		int maxWidth;
+
+		TextRun run;
+	};
+
 	CONTENT_ERROR_CODES Load(const char* filePath, ContentManager* contentManager = nullptr, ContentParameters* contentParameters = nullptr) override;
 	void Unload(ContentManager* contentManager = nullptr) override;
 
@@ -70,16 +143,40 @@ private:
 	std::vector<std::string> SplitAt(std::string line, char delimiter);*/
 
 	//std::string name;
-	std::unordered_map<unsigned int, Character> characters;
+	// Filled as characters are used
+	mutable std::unordered_map<unsigned int, Character> characters;
+	// Points into characters, so ASCII doesn't need a map lookup
+	mutable const Character* characterLookup[LOOKUP_TABLE_SIZE];
+
+	// Runs are moved to previousCachedRuns when cachedRuns fills up, and
+	// back if they are used again before the next time it fills up
+	mutable std::unordered_map<uint64_t, CachedRun> cachedRuns;
+	mutable std::unordered_map<uint64_t, CachedRun> previousCachedRuns;
 
 	unsigned int fontSize;
 	unsigned int lineHeight;
 	unsigned int spaceXAdvance;
+	// Moves every glyph up so descenders stay within the line
+	int baselineOffset;
+
+	FT_LibraryRec_* ftLibrary;
+	FT_FaceRec_* face;
 
-	Texture* texture;
+	GlyphAtlas* atlas;
+	// Loaded atlas, so it can be unloaded when another set is applied
+	ContentManager* contentManager;
 
 	std::pair<std::string, int> GetFontNameAndSize(const std::string& path) const;
-	std::vector<uint8_t> CreateBuffer(const char* filePath, unsigned int& width, unsigned int& height);
+	const Character* FindCharacter(unsigned int id) const;
+	/**
+	* Renders id into the atlas and adds it to characters
+	*
+	* \returns nullptr if the font doesn't have the character or the atlas is full
+	*/
+	const Character* RasterizeCharacter(unsigned int id) const;
+
+	bool OpenFace(const char* filePath);
+	void CloseFace();
 };
 
 #endif // CharacterSet_h__
\ No newline at end of file
@@ -3,8 +3,10 @@
 #ifndef Content_h__
 #define Content_h__
 
+#include <atomic>
 #include <string>
 #include <typeinfo>
+#include <vector>
 
 enum class CONTENT_ERROR_CODES
 {
@@ -62,6 +64,7 @@ class ContentManager;
 class Content
 {
     friend class ContentManager;
+    friend class ContentMap;
 public:
 	Content();
 	/**
@@ -109,7 +112,7 @@ protected:
 
 	void SetPath(const char* path);
 
-	int refCount; //If Unload is called and refCount == 0 it's safe to fully unload this content
+	std::atomic<int> refCount; //If Unload is called and refCount == 0 it's safe to fully unload this content
 
 private:
 	std::string path; //TODO: Use something else for faster hashing/access?
@@ -195,6 +198,14 @@ protected:
 	*/
 	virtual DiskContent* CreateInstance() const = 0;
 
+	/**
+	* Used for hot reloading, adds every file other than this content's own
+	* file that it was loaded from, e.g. included files. A change to any of
+	* them hot reloads this content too
+	*/
+	virtual void GetFileDependencies(std::vector<std::string>& filePaths) const
+	{ }
+
 };
 
 #endif // Content_h__
@@ -0,0 +1,52 @@
+#ifndef ContentHandle_h__
+#define ContentHandle_h__
+
+#include <chrono>
+#include <future>
+
+class Content;
+
+/**
+* Returned by ContentManager::LoadAsync, refers to content that might not be
+* loaded yet.
+*
+* The content is finished on the main thread by
+* ContentManager::FinishAsyncLoads, so never wait for a handle on the main
+* thread. Poll IsReady instead. Once ready, Get returns the same pointer
+* ContentManager::Load would have, and it must be unloaded the same way.
+*/
+template<typename T>
+class ContentHandle
+{
+public:
+	ContentHandle() = default;
+	explicit ContentHandle(std::shared_future<Content*> future)
+		: future(std::move(future))
+	{ }
+
+	bool IsValid() const
+	{
+		return future.valid();
+	}
+
+	bool IsReady() const
+	{
+		return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	/**
+	* \returns nullptr until the handle is ready, or if the content couldn't be loaded
+	*/
+	T* Get() const
+	{
+		if(!IsReady())
+			return nullptr;
+
+		return static_cast<T*>(future.get());
+	}
+
+private:
+	std::shared_future<Content*> future;
+};
+
+#endif // ContentHandle_h__
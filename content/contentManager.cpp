@@ -1,28 +1,35 @@
 #include "contentManager.h"
 
 #include "content.h"
+#include "../profiler.h"
+#include "../timer.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <thread>
 #include <algorithm>
+#include <experimental/filesystem>
 
 #ifndef _WIN32
 #include <sys/inotify.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <poll.h>
 #endif
 
 ContentManager::ContentManager(const std::string& contentRootDirectory /*= ""*/, bool watchDirectory /*= true*/)
 	: contentRootDirectory(contentRootDirectory.empty() ? std::experimental::filesystem::current_path().string() : contentRootDirectory)
+	, stopAsyncLoads(false)
 	, watchDirectory(watchDirectory)
 	, uniqueID(0)
 	, contentToHotReload(false)
+	, contentDependenciesChanged(false)
+	, dependencyIndex(std::make_shared<DependencyIndex>())
 {
-	//if(watchDirectory)
-		//WatchForFileChanges(contentRootDirectory);
+	if(watchDirectory)
+		WatchForFileChanges(this->contentRootDirectory);
 }
 
 ContentManager::~ContentManager()
@@ -33,66 +40,212 @@ ContentManager::~ContentManager()
 		directoryWatchThread->join();
 	}
 
+	StopAsyncLoads();
+
 	Unload();
 }
 
-void ContentManager::ForceHotReload(DiskContent* content)
+void ContentManager::FinishAsyncLoads(float timeBudget)
 {
-    std::lock_guard<std::mutex> vectorGuard(forcedHotReloadsMutex);
+	PROFILE_ZONE("ContentManager::FinishAsyncLoads");
+
+	if(pendingAsyncLoads.empty())
+		return;
+
+	Timer timer;
+	timer.Start();
+
+	do
+	{
+		AsyncLoad* asyncLoad = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(asyncLoadMutex);
+
+			if(finishedAsyncLoads.empty())
+				return;
+
+			asyncLoad = finishedAsyncLoads.front();
+			finishedAsyncLoads.pop_front();
+		}
+
+		pendingAsyncLoads.erase(asyncLoad->path);
+
+		Content* content = nullptr;
+		int missingReferences = asyncLoad->requestCount;
+
+		// Someone might have called Load for the same path while this was being read
+		Content* existingContent = ContentAlreadyLoaded(asyncLoad->path, nullptr);
+		if(existingContent != nullptr)
+		{
+			delete asyncLoad->content;
+
+			content = existingContent;
+			--missingReferences;
+		}
+		else if(asyncLoad->errorCode == CONTENT_ERROR_CODES::NONE
+				&& asyncLoad->content->ApplyHotReload())
+		{
+			++uniqueID;
+
+			content = asyncLoad->content;
+			AddToMap(ContentKey(contentRootDirectory, asyncLoad->path), content);
+		}
+		else
+		{
+			if(asyncLoad->errorCode == CONTENT_ERROR_CODES::NONE)
+				asyncLoad->content->Unload(this);
+			delete asyncLoad->content;
+
+			// Also logs errors and creates default content
+			content = asyncLoad->loadSynchronous();
+			if(content != nullptr)
+				--missingReferences;
+		}
+
+		if(content != nullptr)
+			content->refCount += missingReferences;
 
-    forcedHotReloads.push_back(content);
+		asyncLoad->promise.set_value(content);
+		delete asyncLoad;
+	} while(timer.GetTimeMillisecondsFraction() < timeBudget);
 }
 
-void ContentManager::ForceHotReload(std::vector<DiskContent*> content)
+bool ContentManager::HasPendingAsyncLoads() const
 {
-    std::lock_guard<std::mutex> vectorGuard(forcedHotReloadsMutex);
+	return !pendingAsyncLoads.empty();
+}
+
+void ContentManager::QueueAsyncLoad(AsyncLoad* asyncLoad)
+{
+	pendingAsyncLoads[asyncLoad->path] = asyncLoad;
+
+	{
+		std::lock_guard<std::mutex> lock(asyncLoadMutex);
+
+		asyncLoadQueue.push_back(asyncLoad);
+
+		if(asyncLoadThreads.empty())
+		{
+			int threadCount = std::min(std::max((int)std::thread::hardware_concurrency() - 1, 1), (int)MAX_ASYNC_LOAD_THREADS);
+
+			for(int i = 0; i < threadCount; ++i)
+				asyncLoadThreads.emplace_back(&ContentManager::AsyncLoadMain, this);
+		}
+	}
 
-    forcedHotReloads.insert(forcedHotReloads.end(), content.begin(), content.end());
+	asyncLoadCondition.notify_one();
 }
 
-void ContentManager::Unload()
+void ContentManager::AsyncLoadMain()
 {
-	for(auto& iter : contentMap)
+	while(true)
 	{
-		if(iter.second->IsLoaded())
+		AsyncLoad* asyncLoad = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(asyncLoadMutex);
+			asyncLoadCondition.wait(lock, [this]() { return stopAsyncLoads || !asyncLoadQueue.empty(); });
+
+			if(stopAsyncLoads)
+				return;
+
+			asyncLoad = asyncLoadQueue.front();
+			asyncLoadQueue.pop_front();
+		}
+
 		{
-			iter.second->Unload(this);
+			PROFILE_ZONE("ContentManager::AsyncLoad");
+
+			// Same as hot reloading, the content can't use this to load other content
+			std::string filePath = contentRootDirectory + "/" + asyncLoad->path;
+			asyncLoad->content->SetPath(filePath.c_str());
+			asyncLoad->errorCode = asyncLoad->content->BeginHotReload(filePath.c_str(), this);
 		}
+
+		std::lock_guard<std::mutex> lock(asyncLoadMutex);
+		finishedAsyncLoads.push_back(asyncLoad);
 	}
+}
 
-	for(auto& iter : contentMap)
+void ContentManager::StopAsyncLoads()
+{
 	{
-		delete iter.second;
-		iter.second = nullptr;
+		std::lock_guard<std::mutex> lock(asyncLoadMutex);
+		stopAsyncLoads = true;
 	}
 
-	contentMap.clear();
+	asyncLoadCondition.notify_all();
+
+	for(std::thread& thread : asyncLoadThreads)
+		thread.join();
+
+	asyncLoadThreads.clear();
+
+	// Anything still in the queues is only referenced from here
+	for(auto& pair : pendingAsyncLoads)
+	{
+		delete pair.second->content;
+
+		pair.second->promise.set_value(nullptr);
+		delete pair.second;
+	}
+
+	pendingAsyncLoads.clear();
+	asyncLoadQueue.clear();
+	finishedAsyncLoads.clear();
 }
 
-void ContentManager::Unload(const std::string& path)
+void ContentManager::ForceHotReload(DiskContent* content)
 {
-	auto iter = contentMap.find(path);
-	if(iter->second == nullptr)
-		return; //Already unloaded
+    ForceHotReload(std::vector<DiskContent*>{ content });
+}
 
-	if(!iter->second->IsLoaded())
-		return;
+void ContentManager::ForceHotReload(std::vector<DiskContent*> content)
+{
+    std::lock_guard<std::mutex> vectorGuard(forcedHotReloadsMutex);
+
+    // The watcher thread reads these later, the reference keeps them alive until HotReload gives it back
+    for(DiskContent* diskContent : content)
+    {
+        if(diskContent != nullptr && contentMap.Acquire(ContentKey(diskContent->path)) != nullptr)
+            forcedHotReloads.push_back(diskContent);
+    }
+}
 
-	if(iter == contentMap.end())
+void ContentManager::Unload()
+{
+	// Removed from the map first, so content that unloads its dependencies through this doesn't delete them twice
+	std::vector<Content*> contents = contentMap.Clear();
+
+	contentDependencies.clear();
+	contentDependenciesChanged = true;
+
+	for(Content* content : contents)
 	{
-		Logger::LogLine(LOG_TYPE::WARNING, "Trying to unload conten that has already been unloaded or hasn't been loaded at all");
-		return;
+		if(content->IsLoaded())
+			content->Unload(this);
 	}
 
-	iter->second->refCount--;
-	if(iter->second->refCount > 0)
+	for(Content* content : contents)
+		delete content;
+}
+
+void ContentManager::Unload(const std::string& path)
+{
+	ContentKey key(path);
+
+	if(!contentMap.Contains(key))
+	{
+		Logger::LogLine(LOG_TYPE::WARNING, "Trying to unload conten that has already been unloaded or hasn't been loaded at all");
 		return;
+	}
 
-	iter->second->Unload(this);
-	iter->second = nullptr;
-	delete iter->second;
+	Content* content = contentMap.Release(key);
+	if(content == nullptr)
+		return; //This content is used somewhere else
 
-	contentMap.erase(iter->first);
+	RemoveFileDependencies(content);
+	content->Unload(this);
+	delete content;
 }
 
 void ContentManager::Unload(Content* content)
@@ -100,29 +253,19 @@ void ContentManager::Unload(Content* content)
 	if(content == nullptr)
 		return;
 
-	std::string path = content->path;
-
-	if(path == "") //"Local" content, it's not in contentMap
+	if(content->path.empty()) //"Local" content, it's not in contentMap
 	{
 		delete content;
 		return;
 	}
 
-	auto iter = contentMap.find(path);
-	if(iter == contentMap.end())
-		return;
-
-	if(iter->second == nullptr)
-		return; //Already unloaded
-
-	iter->second->refCount--;
-	if(iter->second->refCount > 0)
-		return; //This content is used somewhere else
-
-	iter->second->Unload(this);
-	delete contentMap.at(iter->first);
+	Content* removedContent = contentMap.Release(ContentKey(content->path));
+	if(removedContent == nullptr)
+		return; //Not in the map or used somewhere else
 
-	contentMap.erase(path);
+	RemoveFileDependencies(removedContent);
+	removedContent->Unload(this);
+	delete removedContent;
 }
 
 void ContentManager::IncreaseRefCount(Content* content) const
@@ -139,8 +282,10 @@ int ContentManager::GetRAMUsage() const
 {
 	int ramUsage = 0;
 
-	for(const auto& pair : contentMap)
-		ramUsage += pair.second->GetRAMUsage();
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		ramUsage += content->GetRAMUsage();
+	});
 
 	return ramUsage;
 }
@@ -149,8 +294,10 @@ int ContentManager::GetDynamicVRAMUsage() const
 {
 	int vramUsage = 0;
 
-	for(const auto& pair : contentMap)
-		vramUsage += pair.second->GetDynamicVRAMUsage();
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		vramUsage += content->GetDynamicVRAMUsage();
+	});
 
 	return vramUsage;
 }
@@ -159,31 +306,39 @@ int ContentManager::GetStaticVRAMUsage() const
 {
 	int vramUsage = 0;
 
-	for(const auto& pair : contentMap)
-		vramUsage += pair.second->GetStaticVRAMUsage();
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		vramUsage += content->GetStaticVRAMUsage();
+	});
 
 	return vramUsage;
 }
 
 void ContentManager::GetRAMAllocators(std::vector<std::pair<const char*, int>>& outData) const
 {
-	for(const auto& pair : contentMap)
-		if(pair.second->GetRAMUsage() > 0)
-			outData.emplace_back(pair.first.c_str(), pair.second->GetRAMUsage());
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		if(content->GetRAMUsage() > 0)
+			outData.emplace_back(path.c_str(), content->GetRAMUsage());
+	});
 }
 
 void ContentManager::GetDynamicVRAMAllocators(std::vector<std::pair<const char*, int>>& outData) const
 {
-	for(const auto& pair : contentMap)
-		if(pair.second->GetDynamicVRAMUsage() > 0)
-			outData.emplace_back(pair.first.c_str(), pair.second->GetDynamicVRAMUsage());
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		if(content->GetDynamicVRAMUsage() > 0)
+			outData.emplace_back(path.c_str(), content->GetDynamicVRAMUsage());
+	});
 }
 
 void ContentManager::GetStaticVRAMAllocators(std::vector<std::pair<const char*, int>>* outData) const
 {
-	for(const auto& pair : contentMap)
-		if(pair.second->GetStaticVRAMUsage() > 0)
-			outData->emplace_back(pair.first.c_str(), pair.second->GetStaticVRAMUsage());
+	contentMap.ForEach([&](const std::string& path, Content* content)
+	{
+		if(content->GetStaticVRAMUsage() > 0)
+			outData->emplace_back(path.c_str(), content->GetStaticVRAMUsage());
+	});
 }
 
 bool ContentManager::HasContentToHotReload() const
@@ -193,7 +348,11 @@ bool ContentManager::HasContentToHotReload() const
 
 void ContentManager::HotReload()
 {
-	if(reloadMap.empty())
+	PROFILE_ZONE("ContentManager::HotReload");
+
+	PublishFileDependencies();
+
+	if(!contentToHotReload)
 		return;
 
 	std::lock_guard<std::mutex> lock(reloadMapMutex);
@@ -201,12 +360,21 @@ void ContentManager::HotReload()
 	for(auto& pair : reloadMap)
 	{
 		// pair.second is always DiskContent*, so this is fine
-		DiskContent* currentPointer = static_cast<DiskContent*>(contentMap[pair.first]);
+		DiskContent* currentPointer = static_cast<DiskContent*>(contentMap.Find(ContentKey(pair.first)));
+
+		if(currentPointer == nullptr) // Unloaded since the reload began
+		{
+			delete pair.second;
+			continue;
+		}
 
         if(pair.second->ApplyHotReload())
         {
             currentPointer->Unload(this);
             currentPointer->Apply(pair.second);
+
+            // Includes might have changed
+            UpdateFileDependencies(currentPointer);
         }
         else
             pair.second->Unload(this);
@@ -216,32 +384,76 @@ void ContentManager::HotReload()
 
 	reloadMap.clear();
 
+	// Content that was unloaded while the watcher held it is deleted here
+	for(Content* content : hotReloadReferences)
+		Unload(content);
+
+	hotReloadReferences.clear();
+
 	contentToHotReload = false;
 }
 
-Content* ContentManager::Exists(const std::string& path)
+Content* ContentManager::Exists(const ContentKey& key)
+{
+	return contentMap.Acquire(key);
+}
+
+void ContentManager::AddToMap(const ContentKey& key, Content* content)
+{
+	const std::string* path = contentMap.Insert(key, content);
+	if(path == nullptr)
+		Logger::LogLine(LOG_TYPE::WARNING, "Content at \"" + key.ToString() + "\" was added to the content map twice");
+
+	content->isLoaded = true;
+	content->SetPath(path != nullptr ? path->c_str() : key.ToString().c_str());
+
+	UpdateFileDependencies(content);
+}
+
+void ContentManager::UpdateFileDependencies(Content* content)
 {
-	auto iter = contentMap.find(path);
+	DiskContent* diskContent = dynamic_cast<DiskContent*>(content);
+	if(diskContent == nullptr)
+		return;
+
+	std::vector<std::string> dependencies;
+	diskContent->GetFileDependencies(dependencies);
 
-	if(iter != contentMap.end())
+	for(std::string& dependency : dependencies)
+		std::replace(dependency.begin(), dependency.end(), '\\', '/');
+
+	std::vector<std::string>& storedDependencies = contentDependencies[content->GetPath()];
+	if(storedDependencies != dependencies)
 	{
-		iter->second->refCount++;
-		return iter->second;
+		storedDependencies = std::move(dependencies);
+		contentDependenciesChanged = true;
 	}
+}
 
-	return nullptr;
+void ContentManager::RemoveFileDependencies(Content* content)
+{
+	if(contentDependencies.erase(content->GetPath()) > 0)
+		contentDependenciesChanged = true;
 }
 
-void ContentManager::AddToMap(const std::string& path, Content* content)
+void ContentManager::PublishFileDependencies()
 {
-	std::string stringPath = path;
+	if(!contentDependenciesChanged)
+		return;
 
-	std::replace(stringPath.begin(), stringPath.end(), '\\', '/');
+	std::shared_ptr<DependencyIndex> newIndex = std::make_shared<DependencyIndex>();
+	for(const auto& pair : contentDependencies)
+	{
+		for(const std::string& dependency : pair.second)
+			(*newIndex)[dependency].push_back(pair.first);
+	}
 
-	contentMap.insert(std::pair<std::string, Content*>(stringPath, content));
+	{
+		std::lock_guard<std::mutex> lock(dependencyIndexMutex);
+		dependencyIndex = std::move(newIndex);
+	}
 
-	content->isLoaded = true;
-	content->SetPath(stringPath.c_str());
+	contentDependenciesChanged = false;
 }
 
 void ContentManager::WatchForFileChanges(const std::string& path)
@@ -267,21 +479,28 @@ void ContentManager::WatchForFileChanges(const std::string& path)
 		}
 	}
 #else
-    int fileDescriptor = inotify_init();
-    watchDescriptor = -1;
+    int fileDescriptor = inotify_init1(IN_NONBLOCK);
 
     if(fileDescriptor == -1)
     {
         success = false;
-        Logger::LogLine(LOG_TYPE::WARNING, "inotify_init failed");
+        Logger::LogLine(LOG_TYPE::WARNING, "inotify_init1 failed");
     }
     else
-        watchDescriptor = inotify_add_watch(fileDescriptor, contentRootDirectory.c_str(), IN_CLOSE_WRITE); // TODO: Error handling, remove watch
+    {
+        AddWatches(fileDescriptor, path);
+
+        if(watchedDirectories.empty())
+        {
+            success = false;
+            close(fileDescriptor);
+            Logger::LogLine(LOG_TYPE::WARNING, "Couldn't watch \"" + path + "\" for changes");
+        }
+    }
 #endif
 
 	if(success)
 	{
-		fileManager.Init(contentRootDirectory);
 		directoryWatchThread.reset(new std::thread(&ContentManager::WaitForFileChanges, this
 #ifndef _WIN32
         , fileDescriptor
@@ -299,10 +518,9 @@ void ContentManager::WaitForFileChanges(
 {
     const static size_t POLL_TIMEOUT = 250;
 
-#ifndef _WIN32
-    const static auto BUFFER_LENGTH = (sizeof(inotify_event) + 16) * 1024;
-    unsigned char buffer[BUFFER_LENGTH];
+	std::unordered_set<std::string> changedFiles;
 
+#ifndef _WIN32
 	struct pollfd pfd = { fileDescriptor, POLLIN, 0 };
 #endif
 
@@ -331,99 +549,191 @@ void ContentManager::WaitForFileChanges(
 				break;
 		}
 #else
-		bool update = false;
-
         int pollValue = poll(&pfd, 1, POLL_TIMEOUT);
 
-        if(pollValue < 0)
-            Logger::LogLine(LOG_TYPE::INFO, "pollValue < 0"); // TODO: Remove
-        else if(pollValue > 0) // pollValue == 0 => timeout
+        if(pollValue > 0) // pollValue == 0 => timeout
         {
-            ssize_t length = read(fileDescriptor, buffer, BUFFER_LENGTH);
+            ReadFileChanges(fileDescriptor, changedFiles);
 
-            if(length < 0)
-                Logger::LogLine(LOG_TYPE::INFO, "length < 0"); // TODO: Remove
-            else
-				update = true;
+            // Editors often write several files, or the same file several times, in a row
+            while(watchDirectory && poll(&pfd, 1, HOT_RELOAD_DEBOUNCE_TIME) > 0)
+                ReadFileChanges(fileDescriptor, changedFiles);
         }
 #endif
 
-        if(forcedHotReloads.size() != 0)
+        std::vector<DiskContent*> forcedContent;
         {
-            // Sleep in case of multiple updates
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-
             std::lock_guard<std::mutex> vectorGuard(forcedHotReloadsMutex);
-            std::lock_guard<std::mutex> mapGuard(reloadMapMutex);
+            forcedContent.swap(forcedHotReloads);
+        }
 
-            for(DiskContent* content : forcedHotReloads)
-            {
-                DiskContent* reloadContent = content->CreateInstance();
-                reloadContent->SetPath(content->GetPath());
+        if(!changedFiles.empty() || !forcedContent.empty())
+        {
+            QueueHotReloads(changedFiles, forcedContent);
+            changedFiles.clear();
+        }
+	}
 
-                // TODO: ContentManager isn't thread safe, shouldn't send this!
-                if(reloadContent->BeginHotReload(std::string(content->GetPath()).c_str(), this) == CONTENT_ERROR_CODES::NONE) // TODO: More error handling?
-                    reloadMap.insert(std::make_pair(content->GetPath(), reloadContent));
-            }
+#ifndef _WIN32
+	for(const auto& pair : watchedDirectories)
+		inotify_rm_watch(fileDescriptor, pair.first);
+	watchedDirectories.clear();
 
-            contentToHotReload = true;
+	close(fileDescriptor);
+#endif
+}
 
-            forcedHotReloads.clear();
-        }
+#ifndef _WIN32
+void ContentManager::AddWatches(int fileDescriptor, const std::string& directory)
+{
+	const static uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
 
-		if(update)
+	std::vector<std::string> directories(1, directory);
+
+	std::error_code error;
+	for(std::experimental::filesystem::recursive_directory_iterator iter(directory, error), end; !error && iter != end; iter.increment(error))
+	{
+		if(std::experimental::filesystem::is_directory(iter->status()))
+			directories.push_back(iter->path().string());
+	}
+
+	for(std::string& path : directories)
+	{
+		std::replace(path.begin(), path.end(), '\\', '/');
+
+		int watchDescriptor = inotify_add_watch(fileDescriptor, path.c_str(), WATCH_MASK);
+		if(watchDescriptor == -1)
+			Logger::LogLine(LOG_TYPE::WARNING, "Couldn't watch \"" + path + "\" for changes");
+		else
+			watchedDirectories[watchDescriptor] = path;
+	}
+}
+
+void ContentManager::ReadFileChanges(int fileDescriptor, std::unordered_set<std::string>& changedFiles)
+{
+	const static size_t BUFFER_LENGTH = (sizeof(inotify_event) + NAME_MAX + 1) * 64;
+	alignas(inotify_event) char buffer[BUFFER_LENGTH];
+
+	while(true)
+	{
+		ssize_t length = read(fileDescriptor, buffer, BUFFER_LENGTH);
+		if(length <= 0)
+			return; // EAGAIN once everything has been read
+
+		for(char* eventPointer = buffer; eventPointer < buffer + length; )
 		{
-            // Sleep in case of multiple updates
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(eventPointer);
+			eventPointer += sizeof(inotify_event) + event->len;
+
+			auto iter = watchedDirectories.find(event->wd);
+			if(iter == watchedDirectories.end())
+				continue;
+
+			if(event->mask & IN_IGNORED)
+			{
+				watchedDirectories.erase(iter);
+				continue;
+			}
 
-			//<new, modified, removed>
-			auto tuple = fileManager.Rebuild();
+			if(event->len == 0)
+				continue;
 
-			std::lock_guard<std::mutex> guard(reloadMapMutex);
+			std::string path = iter->second + "/" + event->name;
 
-			for(const auto& filePath : std::get<1>(tuple))
+			if(event->mask & IN_ISDIR)
 			{
-				std::string filePathString = filePath.string();
-
-				std::replace(filePathString.begin(), filePathString.end(), '\\', '/');
-
-				if(contentMap.count(filePathString) > 0)
-				{
-					Content* content = contentMap[filePathString];
-
-					DiskContent* diskContent = dynamic_cast<DiskContent*>(content);
-					if(diskContent != nullptr)
-					{
-                        // Make a copy of the content, load it from disk in this thread and then update the "real"
-                        // version when HotReload is called
-						DiskContent* reloadContent = diskContent->CreateInstance();
-						reloadContent->SetPath(filePathString.c_str());
-
-						if(reloadContent->BeginHotReload(filePathString.c_str(), this) == CONTENT_ERROR_CODES::NONE) // TODO: More error handling?
-						    reloadMap.insert(std::make_pair(content->GetPath(), reloadContent));
-					}
-				}
+				if(event->mask & (IN_CREATE | IN_MOVED_TO))
+					AddWatches(fileDescriptor, path);
 			}
+			else if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				changedFiles.insert(path);
+		}
+	}
+}
+#endif
+
+void ContentManager::QueueHotReloads(const std::unordered_set<std::string>& changedFiles, const std::vector<DiskContent*>& forcedContent)
+{
+	std::lock_guard<std::mutex> guard(reloadMapMutex);
 
-			if(!reloadMap.empty())
-				contentToHotReload = true;
+	// Ordered and without duplicates, so a file shared by several changes is only read once
+	std::vector<DiskContent*> contentToReload;
+	std::unordered_set<DiskContent*> addedContent;
 
-			// TODO: Do I really need to do this every time...?
-			inotify_rm_watch(fileDescriptor, watchDescriptor);
-			close(fileDescriptor);
-			fileDescriptor = inotify_init();
-			watchDescriptor = inotify_add_watch(fileDescriptor, contentRootDirectory.c_str(), IN_CLOSE_WRITE); // TODO: Error handling, remove watch
+	// Every content used here holds a reference, HotReload releases them on the main thread
+	auto addContent = [&](Content* content)
+	{
+		if(content == nullptr)
+			return;
+
+		hotReloadReferences.push_back(content);
+
+		DiskContent* diskContent = dynamic_cast<DiskContent*>(content);
+		if(diskContent != nullptr && addedContent.insert(diskContent).second)
+			contentToReload.push_back(diskContent);
+	};
+
+	for(DiskContent* content : forcedContent)
+		addContent(content);
+
+	for(const std::string& filePath : changedFiles)
+		addContent(contentMap.Acquire(ContentKey(filePath)));
+
+	if(!changedFiles.empty())
+	{
+		// The main thread only ever replaces the index, so it's safe to read without the lock
+		std::shared_ptr<const DependencyIndex> index;
+		{
+			std::lock_guard<std::mutex> lock(dependencyIndexMutex);
+			index = dependencyIndex;
+		}
+
+		for(const std::string& filePath : changedFiles)
+		{
+			auto iter = index->find(filePath);
+			if(iter == index->end())
+				continue;
+
+			for(const std::string& contentPath : iter->second)
+				addContent(contentMap.Acquire(ContentKey(contentPath)));
 		}
 	}
 
-	inotify_rm_watch(fileDescriptor, watchDescriptor);
-	close(fileDescriptor);
+	for(DiskContent* content : contentToReload)
+	{
+		std::string path = content->GetPath();
+
+		// Make a copy of the content, load it from disk in this thread and then update the "real"
+		// version when HotReload is called
+		DiskContent* reloadContent = content->CreateInstance();
+		reloadContent->SetPath(path.c_str());
+
+		// TODO: ContentManager isn't thread safe, shouldn't send this!
+		if(reloadContent->BeginHotReload(path.c_str(), this) != CONTENT_ERROR_CODES::NONE) // TODO: More error handling?
+		{
+			delete reloadContent;
+			continue;
+		}
+
+		// A reload that hasn't been applied yet is out of date now
+		auto iter = reloadMap.find(path);
+		if(iter != reloadMap.end())
+		{
+			delete iter->second;
+			iter->second = reloadContent;
+		}
+		else
+			reloadMap.insert(std::make_pair(path, reloadContent));
+	}
+
+	if(!reloadMap.empty() || !hotReloadReferences.empty())
+		contentToHotReload = true;
 }
 
 Content* ContentManager::ContentAlreadyLoaded(const std::string path, ContentParameters* contentParameters)
 {
 	if(!path.empty())
-		return Exists(contentRootDirectory + "/" + path);
+		return Exists(ContentKey(contentRootDirectory, path));
 	else
 	{
 		//Check if content with the given unique ID already exists
@@ -433,7 +743,7 @@ Content* ContentManager::ContentAlreadyLoaded(const std::string path, ContentPar
 		   && creationParameters->uniqueID != nullptr
 		   && creationParameters->uniqueID[0] != '\0')
 		{
-			return Exists(creationParameters->uniqueID);
+			return Exists(ContentKey(creationParameters->uniqueID));
 		}
 	}
 
@@ -455,7 +765,7 @@ bool ContentManager::Load(Content* newContent, const std::string path, ContentPa
 		++newContent->refCount;
 
 		if(!path.empty())
-			AddToMap(contentRootDirectory + "/" + path, newContent);
+			AddToMap(ContentKey(contentRootDirectory, path), newContent);
 		else
 		{
 			ContentCreationParameters* creationParameters = dynamic_cast<ContentCreationParameters*>(contentParameters);
@@ -473,7 +783,7 @@ bool ContentManager::Load(Content* newContent, const std::string path, ContentPa
 				return false;
 			}
 
-			AddToMap(creationParameters->uniqueID, newContent);
+			AddToMap(ContentKey(creationParameters->uniqueID), newContent);
 		}
 
 		return true;
@@ -531,12 +841,12 @@ bool ContentManager::LoadTemporary(Content* newContent, const std::string path,
 
 bool ContentManager::HasLoaded(const std::string& path) const
 {
-    return contentMap.find(contentRootDirectory + "/" + path) != contentMap.end();
+    return contentMap.Contains(ContentKey(contentRootDirectory, path));
 }
 
 bool ContentManager::HasCreated(const std::string& path) const
 {
-    return contentMap.find(path) != contentMap.end();
+    return contentMap.Contains(ContentKey(path));
 }
 
 const char* ContentManager::GetRootDir() const
@@ -5,13 +5,21 @@
 #include <unordered_map>
 
 #include "content.h"
+#include "contentHandle.h"
+#include "contentMap.h"
 #include "../logger.h"
-#include "fileManager.h"
 
 #include <string>
 #include <thread>
 #include <mutex>
 #include <vector>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
 
 /**
 * Loads and manages memory of stuff loaded from disc
@@ -75,7 +83,7 @@ public:
 					newContent = nullptr;
 				}
 				else
-					AddToMap(contentRootDirectory + "/" + path, newContent);
+					AddToMap(ContentKey(contentRootDirectory, path), newContent);
 			}
 			else
 			{
@@ -94,6 +102,73 @@ public:
 		return static_cast<T*>(newContent);
 	}
 
+	/**
+	* Starts loading content on a background thread and returns right away.
+	*
+	* The file is read with DiskContent::BeginHotReload on a loader thread and
+	* finished with DiskContent::ApplyHotReload from FinishAsyncLoads, which
+	* has to be called every frame from the main thread. Content that doesn't
+	* support hot reloading is loaded with Load from FinishAsyncLoads instead,
+	* so it still doesn't block the caller but isn't any faster.
+	*
+	* Several requests for the same path share one load and each hold a
+	* reference, like calling Load that many times. Content may call LoadAsync
+	* for its dependencies from Load, OBJModel does so for its textures.
+	*
+	* Example:
+	* \code
+	* ContentHandle<Texture> handle = contentManager.LoadAsync<Texture>("textures/someTexture.png");
+	*
+	* // Every frame
+	* contentManager.FinishAsyncLoads(2.0f);
+	* if(handle.IsReady())
+	*     texture = handle.Get();
+	* \endcode
+	*
+	* \param path path to content, creating content from memory isn't supported
+	* \param contentParameters only used if the content is finished with Load, has to stay valid until the handle is ready
+	*/
+	template<typename T>
+	ContentHandle<T> LoadAsync(const std::string& path, ContentParameters* contentParameters = nullptr)
+	{
+		static_assert(std::is_base_of<DiskContent, T>::value, "Only DiskContent can be loaded asynchronously");
+
+		Content* existingContent = ContentAlreadyLoaded(path, contentParameters);
+		if(existingContent != nullptr)
+		{
+			std::promise<Content*> promise;
+			promise.set_value(existingContent);
+
+			return ContentHandle<T>(promise.get_future().share());
+		}
+
+		auto iter = pendingAsyncLoads.find(path);
+		if(iter != pendingAsyncLoads.end())
+		{
+			++iter->second->requestCount;
+			return ContentHandle<T>(iter->second->future);
+		}
+
+		AsyncLoad* asyncLoad = new AsyncLoad;
+		asyncLoad->path = path;
+		asyncLoad->content = new T;
+		asyncLoad->loadSynchronous = [this, path, contentParameters]() -> Content* { return Load<T>(path, contentParameters); };
+		asyncLoad->future = asyncLoad->promise.get_future().share();
+
+		QueueAsyncLoad(asyncLoad);
+
+		return ContentHandle<T>(asyncLoad->future);
+	}
+
+	/**
+	* Finishes content loaded by LoadAsync that has been read from disk. Must
+	* be called from the main thread. Keeps going until \p timeBudget
+	* milliseconds have passed, but always finishes at least one
+	*/
+	void FinishAsyncLoads(float timeBudget);
+
+	bool HasPendingAsyncLoads() const;
+
 	/**
 	* Same as Load, but doesn't get added to the map, and doesn't need any ID
 	*/
@@ -134,7 +209,7 @@ public:
 	template<typename T>
 	T* GetLoadedContent(const std::string& path)
 	{
-		Content* ptr = Exists(path);
+		Content* ptr = Exists(ContentKey(path));
 
 		if(ptr != nullptr)
 			return static_cast<T*>(ptr);
@@ -150,7 +225,7 @@ public:
 	{
 		if(path != "")
 		{
-			Content* content = Exists(path);
+			Content* content = Exists(ContentKey(path));
 
 			if(content != nullptr)
 			{
@@ -175,7 +250,7 @@ public:
 				return nullptr;
 			}
 
-			Content* content = Exists(parameters->uniqueID);
+			Content* content = Exists(ContentKey(parameters->uniqueID));
 
 			if(content != nullptr)
 			{
@@ -197,7 +272,7 @@ public:
 		Content* originalContent = nullptr;
 		
 		if(path != "")
-			originalContent = Exists(path);
+			originalContent = Exists(ContentKey(path));
 		else
 		{
 			ContentCreationParameters* creationParameters = dynamic_cast<ContentCreationParameters*>(contentParameters);
@@ -208,11 +283,11 @@ public:
 				return nullptr;
 			}
 
-			originalContent = Exists(creationParameters->uniqueID);
+			originalContent = Exists(ContentKey(creationParameters->uniqueID));
 		}
 
 		if(originalContent != nullptr)
-			contentMap.erase(originalContent->GetPath());
+			contentMap.Erase(ContentKey(originalContent->GetPath()));
 
 		T* newContent = Load<T>(path, contentParameters);
 
@@ -228,7 +303,8 @@ public:
 		}
 		else
 		{
-			AddToMap(path, originalContent);
+			if(originalContent != nullptr)
+				AddToMap(ContentKey(originalContent->GetPath()), originalContent);
 			return static_cast<T*>(originalContent);
 		}
 	}
@@ -303,33 +379,97 @@ public:
     bool HasCreated(const std::string& path) const;
 
 	const char* GetRootDir() const;
+
 private:
 	std::string contentRootDirectory;
 
+	struct AsyncLoad
+	{
+		// Relative to contentRootDirectory
+		std::string path;
+
+		// Read on a loader thread, not in contentMap until it's finished
+		DiskContent* content = nullptr;
+		CONTENT_ERROR_CODES errorCode = CONTENT_ERROR_CODES::UNKNOWN;
+
+		// Fallback for content that can't be finished with ApplyHotReload
+		std::function<Content*()> loadSynchronous;
+
+		int requestCount = 1;
+
+		std::promise<Content*> promise;
+		std::shared_future<Content*> future;
+	};
+
+	const static int MAX_ASYNC_LOAD_THREADS = 4;
+
+	// Only touched from the main thread
+	std::unordered_map<std::string, AsyncLoad*> pendingAsyncLoads;
+
+	std::vector<std::thread> asyncLoadThreads;
+	std::mutex asyncLoadMutex;
+	std::condition_variable asyncLoadCondition;
+	std::deque<AsyncLoad*> asyncLoadQueue;
+	std::deque<AsyncLoad*> finishedAsyncLoads;
+	bool stopAsyncLoads;
+
+	void QueueAsyncLoad(AsyncLoad* asyncLoad);
+	void AsyncLoadMain();
+	void StopAsyncLoads();
+
 	//Hot reloading
 	bool watchDirectory;
 #ifdef _WIN32
 	std::vector<HANDLE> changeHandles;
 #else
-    int watchDescriptor;
+	// Watch descriptor to the directory it watches. Only used by directoryWatchThread once that is started
+	std::unordered_map<int, std::string> watchedDirectories;
 #endif
 	std::unique_ptr<std::thread> directoryWatchThread;
 
-	FileManager fileManager;
+	// Changes are collected until nothing has changed for this long, so saving several files reloads once
+	const static int HOT_RELOAD_DEBOUNCE_TIME = 150; // Milliseconds
 
 	//Simply counts up whenever content is loaded
 	uint64_t uniqueID;
 
-	Content* Exists(const std::string& path);
-	void AddToMap(const std::string& path, Content* content);
+	/**
+	* \returns the content at key and adds a reference to it, or nullptr
+	*/
+	Content* Exists(const ContentKey& key);
+	void AddToMap(const ContentKey& key, Content* content);
 
-	std::unordered_map<std::string, Content*> contentMap; //Use map if there are memory issues
+	ContentMap contentMap;
 	std::unordered_map<std::string, DiskContent*> reloadMap; //Use map if there are memory issues
+	// References the watcher thread holds so the content isn't deleted while it's being read.
+	// Guarded by reloadMapMutex, released by HotReload on the main thread
+	std::vector<Content*> hotReloadReferences;
+	// Each one holds a reference, taken by ForceHotReload
     std::vector<DiskContent*> forcedHotReloads;
     std::mutex reloadMapMutex;
     std::mutex forcedHotReloadsMutex;
-	bool contentToHotReload;
+	std::atomic<bool> contentToHotReload;
+
+	// Content path to the files it was loaded from besides its own, see DiskContent::GetFileDependencies.
+	// Only touched from the main thread
+	std::unordered_map<std::string, std::vector<std::string>> contentDependencies;
+	bool contentDependenciesChanged;
 
+	// File path to the paths of every content that depends on it. Rebuilt from contentDependencies
+	// on the main thread and replaced as a whole, the watcher thread only reads it
+	typedef std::unordered_map<std::string, std::vector<std::string>> DependencyIndex;
+	std::shared_ptr<const DependencyIndex> dependencyIndex;
+	std::mutex dependencyIndexMutex;
+
+	/**
+	* Records which files content depends on, call whenever it's added to contentMap or reloaded
+	*/
+	void UpdateFileDependencies(Content* content);
+	void RemoveFileDependencies(Content* content);
+	/**
+	* Gives the watcher thread a new dependencyIndex if anything changed since the last call
+	*/
+	void PublishFileDependencies();
 
 	/**
 	* Watches for file changes and reloads content as needed
@@ -344,6 +484,23 @@ private:
 #endif
 	);
 
+#ifndef _WIN32
+	/**
+	* Watches directory and every directory below it
+	*/
+	void AddWatches(int fileDescriptor, const std::string& directory);
+	/**
+	* Reads every pending event from fileDescriptor and adds the files that
+	* were written to changedFiles
+	*/
+	void ReadFileChanges(int fileDescriptor, std::unordered_set<std::string>& changedFiles);
+#endif
+	/**
+	* Calls BeginHotReload on every changed content, and everything that depends
+	* on a changed file, once. The results are applied in HotReload
+	*/
+	void QueueHotReloads(const std::unordered_set<std::string>& changedFiles, const std::vector<DiskContent*>& forcedContent);
+
 	Content* ContentAlreadyLoaded(const std::string path, ContentParameters* contentParameters);
 	bool Load(Content* newContent, const std::string path, ContentParameters* contentParameters);
 	bool LoadTemporary(Content* newContent, const std::string path, ContentParameters* contentParameters);
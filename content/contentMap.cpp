@@ -0,0 +1,247 @@
+#include "contentMap.h"
+
+#include <cstring>
+
+#include "content.h"
+
+namespace
+{
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    char Normalize(char character)
+    {
+        return character == '\\' ? '/' : character;
+    }
+
+    uint64_t HashAppend(uint64_t hash, const char* string, size_t length)
+    {
+        for(size_t i = 0; i < length; ++i)
+        {
+            hash ^= (uint64_t)(unsigned char)Normalize(string[i]);
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    bool EqualNormalized(const char* lhs, const char* rhs, size_t length)
+    {
+        for(size_t i = 0; i < length; ++i)
+        {
+            if(Normalize(lhs[i]) != rhs[i])
+                return false;
+        }
+
+        return true;
+    }
+}
+
+ContentKey::ContentKey(const std::string& path)
+    : prefix(nullptr)
+    , prefixLength(0)
+    , path(path.c_str())
+    , pathLength(path.size())
+{
+    hash = HashAppend(FNV_OFFSET_BASIS, this->path, pathLength);
+}
+
+ContentKey::ContentKey(const char* path)
+    : prefix(nullptr)
+    , prefixLength(0)
+    , path(path)
+    , pathLength(std::strlen(path))
+{
+    hash = HashAppend(FNV_OFFSET_BASIS, this->path, pathLength);
+}
+
+ContentKey::ContentKey(const std::string& rootDirectory, const std::string& path)
+    : prefix(rootDirectory.c_str())
+    , prefixLength(rootDirectory.size())
+    , path(path.c_str())
+    , pathLength(path.size())
+{
+    hash = HashAppend(FNV_OFFSET_BASIS, prefix, prefixLength);
+    hash = HashAppend(hash, "/", 1);
+    hash = HashAppend(hash, this->path, pathLength);
+}
+
+bool ContentKey::Matches(const std::string& normalizedPath) const
+{
+    if(prefix == nullptr)
+    {
+        return normalizedPath.size() == pathLength
+               && EqualNormalized(path, normalizedPath.c_str(), pathLength);
+    }
+
+    return normalizedPath.size() == prefixLength + 1 + pathLength
+           && EqualNormalized(prefix, normalizedPath.c_str(), prefixLength)
+           && normalizedPath[prefixLength] == '/'
+           && EqualNormalized(path, normalizedPath.c_str() + prefixLength + 1, pathLength);
+}
+
+std::string ContentKey::ToString() const
+{
+    std::string string;
+    string.reserve(prefixLength + 1 + pathLength);
+
+    if(prefix != nullptr)
+    {
+        string.append(prefix, prefixLength);
+        string += '/';
+    }
+
+    string.append(path, pathLength);
+
+    for(char& character : string)
+        character = Normalize(character);
+
+    return string;
+}
+
+Content* ContentMap::Find(const ContentKey& key) const
+{
+    const Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto iter = Find(shard, key);
+    if(iter == shard.entries.end())
+        return nullptr;
+
+    return iter->second.content;
+}
+
+Content* ContentMap::Acquire(const ContentKey& key)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto iter = Find(shard, key);
+    if(iter == shard.entries.end())
+        return nullptr;
+
+    ++iter->second.content->refCount;
+
+    return iter->second.content;
+}
+
+Content* ContentMap::Release(const ContentKey& key)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto iter = Find(shard, key);
+    if(iter == shard.entries.end())
+        return nullptr;
+
+    Content* content = iter->second.content;
+    if(--content->refCount > 0)
+        return nullptr; // This content is used somewhere else
+
+    shard.entries.erase(iter);
+
+    return content;
+}
+
+bool ContentMap::Contains(const ContentKey& key) const
+{
+    const Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    return Find(shard, key) != shard.entries.end();
+}
+
+const std::string* ContentMap::Insert(const ContentKey& key, Content* content)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if(Find(shard, key) != shard.entries.end())
+        return nullptr;
+
+    Entry entry;
+    entry.path = key.ToString();
+    entry.content = content;
+
+    auto iter = shard.entries.emplace(key.hash, std::move(entry));
+
+    return &iter->second.path;
+}
+
+Content* ContentMap::Erase(const ContentKey& key)
+{
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto iter = Find(shard, key);
+    if(iter == shard.entries.end())
+        return nullptr;
+
+    Content* content = iter->second.content;
+    shard.entries.erase(iter);
+
+    return content;
+}
+
+std::vector<Content*> ContentMap::Clear()
+{
+    std::vector<Content*> contents;
+
+    for(Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for(auto& pair : shard.entries)
+            contents.push_back(pair.second.content);
+
+        shard.entries.clear();
+    }
+
+    return contents;
+}
+
+void ContentMap::ForEach(const std::function<void(const std::string&, Content*)>& function) const
+{
+    for(const Shard& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for(const auto& pair : shard.entries)
+            function(pair.second.path, pair.second.content);
+    }
+}
+
+ContentMap::Shard& ContentMap::GetShard(const ContentKey& key)
+{
+    // The low bits pick the bucket inside the shard, so use the high ones here
+    return shards[(key.hash >> 60) % SHARD_COUNT];
+}
+
+const ContentMap::Shard& ContentMap::GetShard(const ContentKey& key) const
+{
+    return shards[(key.hash >> 60) % SHARD_COUNT];
+}
+
+std::unordered_multimap<uint64_t, ContentMap::Entry, ContentMap::IdentityHash>::iterator ContentMap::Find(Shard& shard, const ContentKey& key)
+{
+    auto range = shard.entries.equal_range(key.hash);
+    for(auto iter = range.first; iter != range.second; ++iter)
+    {
+        if(key.Matches(iter->second.path))
+            return iter;
+    }
+
+    return shard.entries.end();
+}
+
+std::unordered_multimap<uint64_t, ContentMap::Entry, ContentMap::IdentityHash>::const_iterator ContentMap::Find(const Shard& shard, const ContentKey& key)
+{
+    auto range = shard.entries.equal_range(key.hash);
+    for(auto iter = range.first; iter != range.second; ++iter)
+    {
+        if(key.Matches(iter->second.path))
+            return iter;
+    }
+
+    return shard.entries.end();
+}
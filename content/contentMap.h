@@ -0,0 +1,134 @@
+#ifndef CONTENTMAP_H__
+#define CONTENTMAP_H__
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Content;
+
+/**
+* A content path that is hashed once when it's created.
+*
+* It only points to the strings it's made from, so those have to outlive it,
+* and it never allocates. Backslashes are treated as forward slashes, so
+* "a\\b" and "a/b" are the same key.
+*/
+struct ContentKey
+{
+    explicit ContentKey(const std::string& path);
+    explicit ContentKey(const char* path);
+    /**
+    * Same as ContentKey(rootDirectory + "/" + path), without building the string
+    */
+    ContentKey(const std::string& rootDirectory, const std::string& path);
+
+    uint64_t hash;
+
+    const char* prefix;
+    size_t prefixLength;
+    const char* path;
+    size_t pathLength;
+
+    bool Matches(const std::string& normalizedPath) const;
+    std::string ToString() const;
+};
+
+/**
+* Maps content paths to content for ContentManager.
+*
+* The map is split into shards by the key's hash, each with its own lock, so
+* lookups from loader threads rarely wait on each other or on the main
+* thread. Every path is stored once per entry, normalized, and its string
+* stays valid until the entry is removed.
+*
+* Reference counts are changed while holding the shard's lock, so content
+* can't be removed between being found and being referenced.
+*/
+class ContentMap
+{
+public:
+    ContentMap() = default;
+    ~ContentMap() = default;
+
+    ContentMap(const ContentMap& other) = delete;
+    ContentMap& operator=(const ContentMap& rhs) = delete;
+
+    /**
+    * \returns the content without adding a reference, or nullptr. Only safe if
+    * nothing can release the content meanwhile
+    */
+    Content* Find(const ContentKey& key) const;
+    /**
+    * \returns the content and adds a reference to it, or nullptr
+    */
+    Content* Acquire(const ContentKey& key);
+    /**
+    * Removes a reference from the content at key.
+    *
+    * \returns the content if that was the last reference. It has then been
+    * removed from the map and should be unloaded and deleted by the caller
+    */
+    Content* Release(const ContentKey& key);
+
+    bool Contains(const ContentKey& key) const;
+
+    /**
+    * \returns the stored, normalized path, or nullptr if the key was already in the map
+    */
+    const std::string* Insert(const ContentKey& key, Content* content);
+    /**
+    * \returns the removed content, or nullptr
+    */
+    Content* Erase(const ContentKey& key);
+    /**
+    * Removes everything
+    *
+    * \returns all the removed content
+    */
+    std::vector<Content*> Clear();
+
+    /**
+    * Calls function for every entry. Locks one shard at a time, so function
+    * must not use the map
+    */
+    void ForEach(const std::function<void(const std::string&, Content*)>& function) const;
+
+private:
+    const static int SHARD_COUNT = 16;
+
+    struct Entry
+    {
+        std::string path;
+        Content* content;
+    };
+
+    // The keys are already hashes
+    struct IdentityHash
+    {
+        size_t operator()(uint64_t hash) const
+        {
+            return (size_t)hash;
+        }
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_multimap<uint64_t, Entry, IdentityHash> entries;
+    };
+
+    Shard shards[SHARD_COUNT];
+
+    Shard& GetShard(const ContentKey& key);
+    const Shard& GetShard(const ContentKey& key) const;
+
+    // Caller holds shard.mutex
+    static std::unordered_multimap<uint64_t, Entry, IdentityHash>::iterator Find(Shard& shard, const ContentKey& key);
+    static std::unordered_multimap<uint64_t, Entry, IdentityHash>::const_iterator Find(const Shard& shard, const ContentKey& key);
+};
+
+#endif // CONTENTMAP_H__
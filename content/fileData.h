@@ -15,6 +15,25 @@ struct FileData
 	std::experimental::filesystem::file_time_type lastWriteDate;
 	std::uintmax_t size;
 
+	/**
+	* Reads the current write date and size of the file at path. A file that
+	* can't be read gets a size of 0
+	*/
+	static FileData FromPath(const std::experimental::filesystem::path& path)
+	{
+		FileData fileData;
+		fileData.path = path;
+
+		std::error_code error;
+		fileData.lastWriteDate = std::experimental::filesystem::last_write_time(fileData.path, error);
+		if(!error)
+			fileData.size = std::experimental::filesystem::file_size(fileData.path, error);
+		if(error)
+			fileData.size = 0;
+
+		return fileData;
+	}
+
 	bool operator==(const FileData& rhs) const
 	{
 		return path == rhs.path
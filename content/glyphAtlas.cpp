@@ -0,0 +1,204 @@
+#include "glyphAtlas.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "contentManager.h"
+#include "../logger.h"
+
+const char* const GlyphAtlas::SHARED_ID = "sharedGlyphAtlas";
+
+GlyphAtlas::GlyphAtlas()
+{
+    // Texture leaves it uninitialized, but CreateStorage needs to know if it exists
+    texture = 0;
+}
+
+GlyphAtlas* GlyphAtlas::LoadShared(ContentManager* contentManager)
+{
+    ContentCreationParameters parameters(SHARED_ID);
+
+    return contentManager->Load<GlyphAtlas>("", &parameters);
+}
+
+bool GlyphAtlas::Add(int width, int height, const uint8_t* pixels, int& x, int& y)
+{
+    while(!Allocate(width, height, x, y))
+    {
+        if(!Grow())
+            return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Rows of a single channel texture aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+bool GlyphAtlas::CreateDefaultContent(const char* filePath, ContentManager* contentManager)
+{
+    return false;
+}
+
+CONTENT_ERROR_CODES GlyphAtlas::Load(const char* filePath, ContentManager* contentManager /*= nullptr*/, ContentParameters* contentParameters /*= nullptr*/)
+{
+    CreateStorage(INITIAL_SIZE, INITIAL_SIZE);
+
+    skyline.clear();
+    skyline.push_back({ 0, 0, INITIAL_SIZE });
+
+    return CONTENT_ERROR_CODES::NONE;
+}
+
+bool GlyphAtlas::Allocate(int width, int height, int& x, int& y)
+{
+    int paddedWidth = width + PADDING;
+    int paddedHeight = height + PADDING;
+
+    // Bottom-left: lowest top edge first, then the narrowest node to waste less
+    int bestIndex = -1;
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for(size_t i = 0; i < skyline.size(); ++i)
+    {
+        int fitY = Fit(i, paddedWidth, paddedHeight);
+        if(fitY == -1)
+            continue;
+
+        if(fitY + paddedHeight < bestTop
+           || (fitY + paddedHeight == bestTop && skyline[i].width < bestWidth))
+        {
+            bestIndex = (int)i;
+            bestTop = fitY + paddedHeight;
+            bestWidth = skyline[i].width;
+        }
+    }
+
+    if(bestIndex == -1)
+        return false;
+
+    x = skyline[bestIndex].x;
+    y = bestTop - paddedHeight;
+
+    skyline.insert(skyline.begin() + bestIndex, { x, bestTop, paddedWidth });
+
+    // Cut away what the new node covers from the nodes after it
+    for(size_t i = (size_t)bestIndex + 1; i < skyline.size();)
+    {
+        const SkylineNode& previous = skyline[i - 1];
+        int overlap = previous.x + previous.width - skyline[i].x;
+        if(overlap <= 0)
+            break;
+
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+
+        if(skyline[i].width > 0)
+            break;
+
+        skyline.erase(skyline.begin() + i);
+    }
+
+    for(size_t i = 0; i + 1 < skyline.size();)
+    {
+        if(skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+            ++i;
+    }
+
+    return true;
+}
+
+int GlyphAtlas::Fit(size_t index, int width, int height) const
+{
+    if(skyline[index].x + width > (int)this->width)
+        return -1;
+
+    int y = 0;
+    int widthLeft = width;
+    for(size_t i = index; widthLeft > 0 && i < skyline.size(); ++i)
+    {
+        y = std::max(y, skyline[i].y);
+        if(y + height > (int)this->height)
+            return -1;
+
+        widthLeft -= skyline[i].width;
+    }
+
+    return y;
+}
+
+bool GlyphAtlas::Grow()
+{
+    int oldWidth = (int)width;
+    int oldHeight = (int)height;
+
+    if(oldWidth >= MAX_SIZE)
+        return false;
+
+    // The texture name stays the same, so queued sprite batches that use it draw from the grown
+    // texture. Their texel coordinates still point at the same glyphs
+    GLuint oldContents;
+    glGenTextures(1, &oldContents);
+    glBindTexture(GL_TEXTURE_2D, oldContents);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, oldWidth, oldHeight, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glCopyImageSubData(texture, GL_TEXTURE_2D, 0, 0, 0, 0
+                       , oldContents, GL_TEXTURE_2D, 0, 0, 0, 0
+                       , oldWidth, oldHeight, 1);
+
+    CreateStorage(oldWidth * 2, oldHeight * 2);
+
+    glCopyImageSubData(oldContents, GL_TEXTURE_2D, 0, 0, 0, 0
+                       , texture, GL_TEXTURE_2D, 0, 0, 0, 0
+                       , oldWidth, oldHeight, 1);
+    glDeleteTextures(1, &oldContents);
+
+    // The new area to the right is empty all the way down
+    skyline.push_back({ oldWidth, 0, oldWidth });
+
+    Logger::LogLine(LOG_TYPE::INFO, "Glyph atlas grown to ", width, "x", height);
+
+    return true;
+}
+
+void GlyphAtlas::CreateStorage(int width, int height)
+{
+    if(texture == 0)
+        glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    // Sample as white with the glyph's coverage as alpha
+    GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Padding has to be empty, otherwise it bleeds into glyphs next to it
+    glClearTexImage(texture, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+    this->width = (unsigned int)width;
+    this->height = (unsigned int)height;
+
+    predivWidth = 1.0f / width;
+    predivHeight = 1.0f / height;
+}
@@ -0,0 +1,77 @@
+#ifndef GLYPHATLAS_H__
+#define GLYPHATLAS_H__
+
+#include "texture.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+* A single channel texture that every CharacterSet rasterizes its glyphs
+* into on first use, whatever its size.
+*
+* Space is handed out with a skyline packer and glyphs are uploaded with
+* glTexSubImage2D. Sampling returns (1, 1, 1, coverage), so text is drawn
+* exactly like an RGBA atlas with white glyphs.
+*
+* The atlas starts small and doubles when it's full. Glyphs keep their
+* pixel positions, but normalized texture coordinates change, which is why
+* SpriteRenderer and TextRun use texels. Space isn't given back when a
+* CharacterSet is unloaded.
+*/
+class GlyphAtlas
+    : public Texture
+{
+public:
+    GlyphAtlas();
+    ~GlyphAtlas() = default;
+
+    const static char* const SHARED_ID;
+
+    const static int INITIAL_SIZE = 256;
+    const static int MAX_SIZE = 4096;
+
+    /**
+    * Loads the atlas shared by every CharacterSet through contentManager.
+    * Unload it with ContentManager::Unload like any other content
+    */
+    static GlyphAtlas* LoadShared(ContentManager* contentManager);
+
+    /**
+    * Finds space for a width x height glyph and copies pixels to it
+    *
+    * \param pixels tightly packed, one byte per pixel
+    * \returns false if the atlas is full and can't grow anymore
+    */
+    bool Add(int width, int height, const uint8_t* pixels, int& x, int& y);
+
+    bool CreateDefaultContent(const char* filePath, ContentManager* contentManager) override;
+
+protected:
+    CONTENT_ERROR_CODES Load(const char* filePath, ContentManager* contentManager = nullptr, ContentParameters* contentParameters = nullptr) override;
+
+private:
+    // Empty pixels around every glyph, so linear filtering doesn't bleed
+    const static int PADDING = 1;
+
+    struct SkylineNode
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    std::vector<SkylineNode> skyline;
+
+    bool Allocate(int width, int height, int& x, int& y);
+    /**
+    * \returns the lowest y a width wide rectangle fits at when placed at
+    * skyline[index], or -1 if it doesn't fit
+    */
+    int Fit(size_t index, int width, int height) const;
+    bool Grow();
+
+    void CreateStorage(int width, int height);
+};
+
+#endif // GLYPHATLAS_H__
@@ -2,7 +2,7 @@
 #include <fstream>
 #include <cstring>
 
-#include <IL/il.h>
+#include <png.h>
 
 #include "content.h"
 
@@ -16,49 +16,28 @@
 
 CONTENT_ERROR_CODES LoadContent(const char* filePath, unsigned char* data)
 {
-    ilInit();
-    ilEnable(IL_ORIGIN_SET);
-    //ilOriginFunc(IL_ORIGIN_UPPER_LEFT);
+    // libpng's simplified API keeps all of its state in image, so several
+    // textures can be decoded at once on different threads (DevIL can't)
+    png_image image;
+    memset(&image, 0, sizeof(png_image));
+    image.version = PNG_IMAGE_VERSION;
 
-    ILuint image;
-    ilGenImages(1, &image);
-    ilBindImage(image);
-
-    ILenum error = ilGetError();
-    if(error != IL_NO_ERROR)
-        return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
-
-    ilLoadImage(filePath);
-
-    error = ilGetError();
-    if(error != IL_NO_ERROR)
+    if(!png_image_begin_read_from_file(&image, filePath))
         return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
 
-    ILubyte* ilData = ilGetData();
-
-    int bitsPerPixel = ilGetInteger(IL_IMAGE_BPP);
+    // Converts any bit depth and palette to RGBA8, missing alpha becomes 255
+    image.format = PNG_FORMAT_RGBA;
 
-    const ILint width = ilGetInteger(IL_IMAGE_WIDTH);
-    const ILint height = ilGetInteger(IL_IMAGE_HEIGHT);
+    // Negative stride stores the bottom row first, which is the origin GL expects
+    png_int_32 rowStride = -(png_int_32)PNG_IMAGE_ROW_STRIDE(image);
 
-    if(bitsPerPixel == 4)
-        memcpy(data, ilData, (size_t)(width * height * 4));
-    else
+    if(!png_image_finish_read(&image, nullptr, data, rowStride, nullptr))
     {
-        for(int i = 0; i < width * height; ++i)
-        {
-            memcpy(data + i * 4, ilData + i * bitsPerPixel, bitsPerPixel);
-            memset(data + i * 4 + bitsPerPixel, 255, (size_t)(4 - bitsPerPixel));
-        }
+        png_image_free(&image);
+        return CONTENT_ERROR_CODES::CREATE_FROM_MEMORY;
     }
 
-    ilDeleteImage(image);
-
-    error = ilGetError();
-    if(error != IL_NO_ERROR)
-        return CONTENT_ERROR_CODES::UNKNOWN;
-    else
-        return CONTENT_ERROR_CODES::NONE;
+    return CONTENT_ERROR_CODES::NONE;
 }
 
 bool Dimensions(const char* filePath, uint32_t& width, uint32_t& height)
@@ -5,6 +5,8 @@
 
 #include "texture.h"
 
+#include <algorithm>
+
 #include "textureCreationParameters.h"
 
 #include "contentManager.h"
@@ -73,11 +75,18 @@ bool Texture::Apply(Content* content)
 
 CONTENT_ERROR_CODES Texture::Load(const char* filePath, ContentManager* contentManager /*= nullptr*/, ContentParameters* contentParameters /*= nullptr*/)
 {
-    CONTENT_ERROR_CODES error = ReadData(filePath);
-	if(error != CONTENT_ERROR_CODES::NONE)
+    DecodedTextureParameters* decoded = dynamic_cast<DecodedTextureParameters*>(contentParameters);
+    if(decoded != nullptr && (decoded->data != nullptr || decoded->compressed.levelCount > 0))
+        TakeData(*decoded);
+    else
     {
-        data.reset(nullptr);
-        return error;
+        CONTENT_ERROR_CODES error = ReadData(filePath);
+        if(error != CONTENT_ERROR_CODES::NONE)
+        {
+            data.reset(nullptr);
+            compressedData = CompressedTextureData();
+            return error;
+        }
     }
 
     ApplyHotReload();
@@ -91,6 +100,61 @@ CONTENT_ERROR_CODES Texture::BeginHotReload(const char* filePath, ContentManager
 }
 
 CONTENT_ERROR_CODES Texture::ReadData(const char* filePath)
+{
+    DecodedTextureParameters parameters;
+
+    CONTENT_ERROR_CODES error = ReadFile(filePath, parameters);
+    if(error != CONTENT_ERROR_CODES::NONE)
+        return error;
+
+    TakeData(parameters);
+
+    return CONTENT_ERROR_CODES::NONE;
+}
+
+void Texture::TakeData(DecodedTextureParameters& parameters)
+{
+    if(parameters.compressed.levelCount > 0)
+    {
+        width = parameters.compressed.width;
+        height = parameters.compressed.height;
+        compressedData = std::move(parameters.compressed);
+        data.reset(nullptr);
+    }
+    else
+    {
+        width = parameters.width;
+        height = parameters.height;
+        data = std::move(parameters.data);
+        compressedData = CompressedTextureData();
+    }
+}
+
+CONTENT_ERROR_CODES Texture::ReadFile(const char* filePath, DecodedTextureParameters& out)
+{
+    if(TextureCache::Read(filePath, out.compressed))
+        return CONTENT_ERROR_CODES::NONE;
+
+    CONTENT_ERROR_CODES error = DecodeFile(filePath, out.width, out.height, out.data);
+    if(error != CONTENT_ERROR_CODES::NONE)
+        return error;
+
+    if(out.data == nullptr || out.width == 0 || out.height == 0)
+        return CONTENT_ERROR_CODES::NONE;
+
+    // BC5 is only for normal maps, which have to ask for it
+    BC_FORMAT format = BCEncoder::HasAlpha(out.data.get(), out.width, out.height) ? BC_FORMAT::BC3 : BC_FORMAT::BC1;
+    TextureCache::Compress(out.data.get(), out.width, out.height, format, out.compressed);
+
+    // The texture is still usable if this fails, it's just compressed again next time
+    TextureCache::Write(filePath, out.compressed);
+
+    out.data.reset(nullptr);
+
+    return CONTENT_ERROR_CODES::NONE;
+}
+
+CONTENT_ERROR_CODES Texture::DecodeFile(const char* filePath, unsigned int& width, unsigned int& height, std::unique_ptr<unsigned char>& data)
 {
     const std::string filePathString(filePath);
     const std::string fileExtension = filePathString.substr(filePathString.find_last_of('.') + 1);
@@ -191,9 +255,33 @@ bool Texture::ApplyHotReload()
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.get());
+    if(compressedData.levelCount > 0)
+    {
+        GLenum format = BCEncoder::GetGLFormat(compressedData.format);
+
+        for(int level = 0; level < compressedData.levelCount; ++level)
+        {
+            GLsizei levelWidth = std::max(width >> level, 1u);
+            GLsizei levelHeight = std::max(height >> level, 1u);
+
+            glCompressedTexImage2D(GL_TEXTURE_2D
+                                   , level
+                                   , format
+                                   , levelWidth
+                                   , levelHeight
+                                   , 0
+                                   , (GLsizei)TextureCache::GetLevelSize(compressedData, level)
+                                   , &compressedData.data[TextureCache::GetLevelOffset(compressedData, level)]);
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, compressedData.levelCount - 1);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.get());
 
-    glGenerateMipmap(GL_TEXTURE_2D);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -211,6 +299,7 @@ bool Texture::ApplyHotReload()
     predivHeight = 1.0f / height;
 
     data.reset(nullptr); // TODO: I don't like this
+    compressedData = CompressedTextureData();
 
 	return true;
 }
@@ -2,6 +2,7 @@
 #define texture_h__
 
 #include "content.h"
+#include "textureCache.h"
 
 #include <memory>
 #include <string>
@@ -9,6 +10,24 @@
 #include <GL/gl3w.h>
 #include <GL/glext.h>
 
+/**
+* Pass to ContentManager::Load<Texture> to upload pixels that were already
+* read, e.g. on another thread through Texture::ReadFile, instead of reading
+* the file again
+*/
+struct DecodedTextureParameters
+	: ContentParameters
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+
+	// RGBA8, the texture takes ownership when loaded
+	std::unique_ptr<unsigned char> data;
+
+	// Used over data when it has any levels
+	CompressedTextureData compressed;
+};
+
 class Texture
 	: public DiskContent
 {
@@ -33,10 +52,25 @@ public:
 
 	GLuint GetTexture() const;
 
+	/**
+	* Decodes filePath into RGBA8 without touching GL, so it can be called
+	* from any thread
+	*/
+	static CONTENT_ERROR_CODES DecodeFile(const char* filePath, unsigned int& width, unsigned int& height, std::unique_ptr<unsigned char>& data);
+
+	/**
+	* Reads filePath as a block compressed mip chain from the TextureCache,
+	* decoding, compressing and caching it first if needed. Falls back to
+	* plain RGBA8 in out.data if the pixels can't be compressed. Doesn't touch
+	* GL, so it can be called from any thread
+	*/
+	static CONTENT_ERROR_CODES ReadFile(const char* filePath, DecodedTextureParameters& out);
+
 protected:
 	GLuint texture;
 
 	std::unique_ptr<unsigned char> data;
+	CompressedTextureData compressedData;
 
 	unsigned int width;
 	unsigned int height;
@@ -52,6 +86,7 @@ protected:
     virtual bool Apply(Content* other);
 
 	CONTENT_ERROR_CODES ReadData(const char* filePath);
+	void TakeData(DecodedTextureParameters& parameters);
 
 	DiskContent* CreateInstance() const override;
 };
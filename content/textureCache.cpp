@@ -0,0 +1,197 @@
+#include "textureCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "fileData.h"
+#include "../profiler.h"
+
+void TextureCache::Compress(const uint8_t* rgba, unsigned int width, unsigned int height, BC_FORMAT format, CompressedTextureData& out)
+{
+    PROFILE_ZONE("TextureCache::Compress");
+
+    out.format = format;
+    out.width = width;
+    out.height = height;
+    out.levelCount = 1;
+
+    unsigned int largestSide = std::max(width, height);
+    while(largestSide > 1)
+    {
+        largestSide /= 2;
+        ++out.levelCount;
+    }
+
+    size_t totalSize = 0;
+    for(int level = 0; level < out.levelCount; ++level)
+        totalSize += GetLevelSize(out, level);
+
+    out.data.resize(totalSize);
+
+    std::vector<uint8_t> currentLevel(rgba, rgba + (size_t)width * height * 4);
+    std::vector<uint8_t> nextLevel;
+
+    unsigned int levelWidth = width;
+    unsigned int levelHeight = height;
+    for(int level = 0; level < out.levelCount; ++level)
+    {
+        BCEncoder::Encode(format, &currentLevel[0], levelWidth, levelHeight, &out.data[GetLevelOffset(out, level)]);
+
+        if(level == out.levelCount - 1)
+            break;
+
+        // 2x2 box filter, odd sizes repeat their last row/column
+        unsigned int nextWidth = std::max(levelWidth / 2, 1u);
+        unsigned int nextHeight = std::max(levelHeight / 2, 1u);
+        nextLevel.resize((size_t)nextWidth * nextHeight * 4);
+
+        for(unsigned int y = 0; y < nextHeight; ++y)
+        {
+            unsigned int y0 = std::min(y * 2, levelHeight - 1);
+            unsigned int y1 = std::min(y * 2 + 1, levelHeight - 1);
+
+            for(unsigned int x = 0; x < nextWidth; ++x)
+            {
+                unsigned int x0 = std::min(x * 2, levelWidth - 1);
+                unsigned int x1 = std::min(x * 2 + 1, levelWidth - 1);
+
+                const uint8_t* topLeft = &currentLevel[((size_t)y0 * levelWidth + x0) * 4];
+                const uint8_t* topRight = &currentLevel[((size_t)y0 * levelWidth + x1) * 4];
+                const uint8_t* bottomLeft = &currentLevel[((size_t)y1 * levelWidth + x0) * 4];
+                const uint8_t* bottomRight = &currentLevel[((size_t)y1 * levelWidth + x1) * 4];
+
+                uint8_t* pixel = &nextLevel[((size_t)y * nextWidth + x) * 4];
+                for(int channel = 0; channel < 4; ++channel)
+                    pixel[channel] = (uint8_t)((topLeft[channel] + topRight[channel] + bottomLeft[channel] + bottomRight[channel] + 2) / 4);
+            }
+        }
+
+        currentLevel.swap(nextLevel);
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+}
+
+bool TextureCache::Read(const std::string& sourcePath, CompressedTextureData& out)
+{
+    PROFILE_ZONE("TextureCache::Read");
+
+    FileData sourceFile = FileData::FromPath(sourcePath);
+    if(sourceFile.size == 0)
+        return false;
+
+    std::ifstream in(GetCachePath(sourcePath), std::ios::binary);
+    if(!in.is_open())
+        return false;
+
+    CacheHeader header;
+    if(!in.read((char*)&header, sizeof(CacheHeader)))
+        return false;
+
+    FileData cachedSource;
+    cachedSource.path = sourceFile.path;
+    cachedSource.lastWriteDate = std::experimental::filesystem::file_time_type(std::experimental::filesystem::file_time_type::duration(header.sourceWriteTime));
+    cachedSource.size = header.sourceSize;
+
+    if(header.magic != CACHE_MAGIC
+       || header.version != CACHE_VERSION
+       || cachedSource != sourceFile
+       || header.format > (uint32_t)BC_FORMAT::BC5
+       || header.width == 0
+       || header.height == 0
+       || header.levelCount == 0)
+        return false;
+
+    // A full mip chain ends at 1x1
+    uint32_t maxLevelCount = 1;
+    for(uint32_t size = std::max(header.width, header.height); size > 1; size /= 2)
+        ++maxLevelCount;
+
+    if(header.levelCount > maxLevelCount)
+        return false;
+
+    CompressedTextureData cached;
+    cached.format = (BC_FORMAT)header.format;
+    cached.width = header.width;
+    cached.height = header.height;
+    cached.levelCount = (int)header.levelCount;
+
+    // The levels have to fill the rest of the file exactly, don't trust the header's size before allocating
+    std::streampos payloadStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff remainingSize = in.tellg() - payloadStart;
+    in.seekg(payloadStart);
+
+    size_t payloadSize = GetLevelOffset(cached, cached.levelCount);
+    if(remainingSize < 0 || (uint64_t)remainingSize != (uint64_t)payloadSize)
+        return false;
+
+    cached.data.resize(payloadSize);
+    if(!in.read((char*)&cached.data[0], cached.data.size()))
+        return false;
+
+    out = std::move(cached);
+
+    return true;
+}
+
+bool TextureCache::Write(const std::string& sourcePath, const CompressedTextureData& data)
+{
+    FileData sourceFile = FileData::FromPath(sourcePath);
+    if(sourceFile.size == 0 || data.data.empty())
+        return false;
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.sourceWriteTime = (int64_t)sourceFile.lastWriteDate.time_since_epoch().count();
+    header.sourceSize = (uint64_t)sourceFile.size;
+    header.format = (uint32_t)data.format;
+    header.width = data.width;
+    header.height = data.height;
+    header.levelCount = (uint32_t)data.levelCount;
+
+    // Write to a temporary file first so a half written file is never loaded
+    std::string cachePath = GetCachePath(sourcePath);
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!out.is_open())
+            return false;
+
+        out.write((const char*)&header, sizeof(CacheHeader));
+        out.write((const char*)&data.data[0], data.data.size());
+
+        if(!out.good())
+        {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+}
+
+std::string TextureCache::GetCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".bctex";
+}
+
+size_t TextureCache::GetLevelOffset(const CompressedTextureData& data, int level)
+{
+    size_t offset = 0;
+    for(int i = 0; i < level; ++i)
+        offset += GetLevelSize(data, i);
+
+    return offset;
+}
+
+size_t TextureCache::GetLevelSize(const CompressedTextureData& data, int level)
+{
+    unsigned int width = std::max(data.width >> level, 1u);
+    unsigned int height = std::max(data.height >> level, 1u);
+
+    return BCEncoder::GetEncodedSize(data.format, width, height);
+}
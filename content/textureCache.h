@@ -0,0 +1,77 @@
+#ifndef TEXTURECACHE_H__
+#define TEXTURECACHE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bcEncoder.h"
+
+/**
+* A block compressed texture with its full mip chain
+*/
+struct CompressedTextureData
+{
+    BC_FORMAT format = BC_FORMAT::BC1;
+
+    // Of level 0
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    int levelCount = 0;
+
+    // Every level back to back, largest first
+    std::vector<uint8_t> data;
+};
+
+/**
+* Keeps compressed textures in a cache file next to their source
+* ("<source>.bctex") so they only have to be decoded and encoded once.
+*
+* The cache stores the write date and size of the source it was made from and
+* is ignored once they don't match anymore. None of the functions touch GL or
+* the Logger, so they can be called from worker threads.
+*/
+class TextureCache
+{
+public:
+    /**
+    * Builds a mip chain from tightly packed RGBA8 pixels with a box filter
+    * and encodes every level as format
+    */
+    static void Compress(const uint8_t* rgba, unsigned int width, unsigned int height, BC_FORMAT format, CompressedTextureData& out);
+
+    /**
+    * \returns false if there is no cache for sourcePath or it is out of date
+    */
+    static bool Read(const std::string& sourcePath, CompressedTextureData& out);
+    static bool Write(const std::string& sourcePath, const CompressedTextureData& data);
+
+    static std::string GetCachePath(const std::string& sourcePath);
+
+    /**
+    * \returns the offset of level in CompressedTextureData::data
+    */
+    static size_t GetLevelOffset(const CompressedTextureData& data, int level);
+    static size_t GetLevelSize(const CompressedTextureData& data, int level);
+
+private:
+    const static uint32_t CACHE_MAGIC = 0x58544654; // "TFTX"
+    const static uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+
+        int64_t sourceWriteTime;
+        uint64_t sourceSize;
+
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+    };
+};
+
+#endif // TEXTURECACHE_H__
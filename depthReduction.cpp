@@ -0,0 +1,184 @@
+#include "depthReduction.h"
+
+#include <cstring>
+
+DepthReduction::DepthReduction()
+        : screenWidth(0)
+          , screenHeight(0)
+{}
+
+DepthReduction::~DepthReduction()
+{}
+
+bool DepthReduction::Init(ContentManager& contentManager, int screenWidth, int screenHeight)
+{
+    this->screenWidth = screenWidth;
+    this->screenHeight = screenHeight;
+
+    ////////////////////////////////////////////////////////////
+    // Depth buffer -> last level
+    reductionDrawBinds.AddUniform("projectionInverseMatrix", glm::mat4());
+    reductionDrawBinds.AddUniform("screenSize", glm::ivec2(screenWidth, screenHeight));
+    reductionDrawBinds.AddUniform("sampleCount", 0);
+    reductionDrawBinds.AddShaders(contentManager, GLEnums::SHADER_TYPE::COMPUTE, "rendering/depthReduction.comp");
+    if(!reductionDrawBinds.Init())
+        return false;
+
+    reductionDrawBinds["TileDepth"] = std::vector<glm::vec2>((unsigned long)GetTileCount(), glm::vec2(0.0f));
+
+    ////////////////////////////////////////////////////////////
+    // Level n + 1 -> level n
+    downsampleDrawBinds.AddUniform("level", 0);
+    downsampleDrawBinds.AddShaders(contentManager, GLEnums::SHADER_TYPE::COMPUTE, "rendering/depthDownsample.comp");
+    if(!downsampleDrawBinds.Init())
+        return false;
+
+    downsampleDrawBinds["TileDepth"] = reductionDrawBinds["TileDepth"];
+
+    return true;
+}
+
+void DepthReduction::Reduce(GLuint depthTexture, int sampleCount, glm::mat4 projectionMatrixInverse)
+{
+    const int lastLevel = LEVEL_COUNT - 1;
+    const GLuint tilesPerSide = 1u << lastLevel;
+
+    reductionDrawBinds["projectionInverseMatrix"] = projectionMatrixInverse;
+    reductionDrawBinds["screenSize"] = glm::ivec2(screenWidth, screenHeight);
+    reductionDrawBinds["sampleCount"] = sampleCount;
+
+    // Sampler bindings are set in the shader, 0 is sampler2D and 1 is sampler2DMS
+    GLenum textureTarget = sampleCount == 0 ? GL_TEXTURE_2D : GL_TEXTURE_2D_MULTISAMPLE;
+    glActiveTexture(sampleCount == 0 ? GL_TEXTURE0 : GL_TEXTURE1);
+    glBindTexture(textureTarget, depthTexture);
+
+    reductionDrawBinds.Bind();
+    glDispatchCompute(tilesPerSide / THREADS_PER_GROUP, tilesPerSide / THREADS_PER_GROUP, 1);
+    reductionDrawBinds.Unbind();
+
+    glBindTexture(textureTarget, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    downsampleDrawBinds.Bind();
+    for(int level = lastLevel - 1; level >= 0; --level)
+    {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        downsampleDrawBinds["level"] = level;
+
+        GLuint groupCount = ((1u << level) + THREADS_PER_GROUP - 1) / THREADS_PER_GROUP;
+        glDispatchCompute(groupCount, groupCount, 1);
+    }
+    downsampleDrawBinds.Unbind();
+
+    // Light culling reads the result
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void DepthReduction::ReduceCPU(const std::vector<float>& depth
+                               , int width
+                               , int height
+                               , int sampleCount
+                               , glm::mat4 projectionMatrixInverse
+                               , std::vector<glm::vec2>& tileDepth)
+{
+    const int lastLevel = LEVEL_COUNT - 1;
+    const int tilesPerSide = 1 << lastLevel;
+    const int samples = std::max(sampleCount, 1);
+
+    tileDepth.resize((unsigned long)GetTileCount());
+
+    // Same rounding as depthReduction.comp
+    glm::ivec2 tileSize = glm::max(glm::ivec2((width + tilesPerSide - 1) / tilesPerSide, (height + tilesPerSide - 1) / tilesPerSide), glm::ivec2(1));
+
+    for(int tileY = 0; tileY < tilesPerSide; ++tileY)
+    {
+        for(int tileX = 0; tileX < tilesPerSide; ++tileX)
+        {
+            float minDepth = 1.0f;
+            float maxDepth = 0.0f;
+
+            int endX = std::min((tileX + 1) * tileSize.x, width);
+            int endY = std::min((tileY + 1) * tileSize.y, height);
+
+            for(int y = tileY * tileSize.y; y < endY; ++y)
+            {
+                for(int x = tileX * tileSize.x; x < endX; ++x)
+                {
+                    for(int i = 0; i < samples; ++i)
+                    {
+                        float sample = depth[(y * width + x) * samples + i];
+
+                        minDepth = std::min(minDepth, sample);
+                        maxDepth = std::max(maxDepth, sample);
+                    }
+                }
+            }
+
+            float first = ToViewDepth(minDepth, projectionMatrixInverse);
+            float second = ToViewDepth(maxDepth, projectionMatrixInverse);
+
+            tileDepth[GetTileIndex(tileX, tileY, lastLevel)] = glm::vec2(std::min(first, second), std::max(first, second));
+        }
+    }
+
+    for(int level = lastLevel - 1; level >= 0; --level)
+    {
+        for(int y = 0; y < (1 << level); ++y)
+        {
+            for(int x = 0; x < (1 << level); ++x)
+            {
+                glm::vec2 bottomLeft = tileDepth[GetTileIndex(x * 2, y * 2, level + 1)];
+                glm::vec2 bottomRight = tileDepth[GetTileIndex(x * 2 + 1, y * 2, level + 1)];
+                glm::vec2 topLeft = tileDepth[GetTileIndex(x * 2, y * 2 + 1, level + 1)];
+                glm::vec2 topRight = tileDepth[GetTileIndex(x * 2 + 1, y * 2 + 1, level + 1)];
+
+                tileDepth[GetTileIndex(x, y, level)] = glm::vec2(
+                        std::min(std::min(bottomLeft.x, bottomRight.x), std::min(topLeft.x, topRight.x))
+                        , std::max(std::max(bottomLeft.y, bottomRight.y), std::max(topLeft.y, topRight.y)));
+            }
+        }
+    }
+}
+
+float DepthReduction::ToViewDepth(float depth, const glm::mat4& projectionMatrixInverse)
+{
+    // Depth range is reversed (glDepthRange(1.0, 0.0)), so NDC z is 1 - depth. Same as ToViewDepth in depthReduction.comp
+    glm::vec4 unprojected = projectionMatrixInverse * glm::vec4(0.0f, 0.0f, 1.0f - depth, 1.0f);
+    return unprojected.z / unprojected.w;
+}
+
+void DepthReduction::GetTileDepth(std::vector<glm::vec2>& tileDepth)
+{
+    tileDepth.resize((unsigned long)GetTileCount());
+
+    auto data = reductionDrawBinds.GetSSBO("TileDepth")->GetData();
+    std::memcpy(&tileDepth[0], data.get(), sizeof(glm::vec2) * tileDepth.size());
+}
+
+void DepthReduction::SetDrawBindData(GLDrawBinds& binds)
+{
+    binds["TileDepth"] = reductionDrawBinds["TileDepth"];
+}
+
+void DepthReduction::ResolutionChanged(int newWidth, int newHeight)
+{
+    this->screenWidth = newWidth;
+    this->screenHeight = newHeight;
+}
+
+int DepthReduction::GetLevelOffset(int level)
+{
+    // 4^0 + 4^1 + ... + 4^(level - 1)
+    return ((1 << (2 * level)) - 1) / 3;
+}
+
+int DepthReduction::GetTileIndex(int x, int y, int level)
+{
+    return GetLevelOffset(level) + y * (1 << level) + x;
+}
+
+int DepthReduction::GetTileCount()
+{
+    return GetLevelOffset(LEVEL_COUNT);
+}
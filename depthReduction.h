@@ -0,0 +1,65 @@
+#ifndef DEPTHREDUCTION_H__
+#define DEPTHREDUCTION_H__
+
+#include "gl/glDrawBinds.h"
+
+/**
+ * Reduces the depth prepass into min/max view space depth per tile.
+ *
+ * The result is stored as a pyramid in the "TileDepth" buffer where level 0
+ * covers the whole screen and every following level halves the tile size.
+ * The last level has the same tile count as LightCullNormal. See tileDepth.glsl
+ */
+class DepthReduction
+{
+public:
+    DepthReduction();
+    ~DepthReduction();
+
+    const static int LEVEL_COUNT = 9;
+
+    bool Init(ContentManager& contentManager, int screenWidth, int screenHeight);
+
+    /**
+     * Reduces \p depthTexture. If \p sampleCount is 0 \p depthTexture is expected to be a GL_TEXTURE_2D,
+     * otherwise a GL_TEXTURE_2D_MULTISAMPLE
+     */
+    void Reduce(GLuint depthTexture, int sampleCount, glm::mat4 projectionMatrixInverse);
+
+    /**
+     * CPU reference of Reduce. Doesn't use any GL calls.
+     *
+     * \param depth depth buffer values, row-major starting at the bottom row (same as glReadPixels).
+     *              Each pixel has \p sampleCount consecutive samples
+     * \param tileDepth output, resized to GetTileCount()
+     */
+    static void ReduceCPU(const std::vector<float>& depth
+                          , int width
+                          , int height
+                          , int sampleCount
+                          , glm::mat4 projectionMatrixInverse
+                          , std::vector<glm::vec2>& tileDepth);
+
+    // Copies the GPU result to \p tileDepth
+    void GetTileDepth(std::vector<glm::vec2>& tileDepth);
+
+    void SetDrawBindData(GLDrawBinds& binds);
+    void ResolutionChanged(int newWidth, int newHeight);
+
+    static int GetLevelOffset(int level);
+    static int GetTileIndex(int x, int y, int level);
+    static int GetTileCount();
+
+    GLDrawBinds reductionDrawBinds;
+    GLDrawBinds downsampleDrawBinds;
+protected:
+private:
+    const static int THREADS_PER_GROUP = 8;
+
+    int screenWidth;
+    int screenHeight;
+
+    static float ToViewDepth(float depth, const glm::mat4& projectionMatrixInverse);
+};
+
+#endif // DEPTHREDUCTION_H__
@@ -0,0 +1,53 @@
+#ifndef FASTRANDOM_H__
+#define FASTRANDOM_H__
+
+#include <cstdint>
+
+/**
+* A small xorshift64* generator, much cheaper than rand() and without any
+* shared state. Give every thread its own instance.
+*/
+class FastRandom
+{
+public:
+    FastRandom(uint64_t seed = 1)
+    {
+        Seed(seed);
+    }
+
+    void Seed(uint64_t seed)
+    {
+        // splitmix64 so that nearby seeds (0, 1, 2, ...) give unrelated sequences
+        seed += 0x9E3779B97F4A7C15ull;
+        seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+        seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+        state = seed ^ (seed >> 31);
+
+        // xorshift gets stuck at 0
+        if(state == 0)
+            state = 0x9E3779B97F4A7C15ull;
+    }
+
+    uint64_t Next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    /**
+    * \returns a float in [0, 1)
+    */
+    float NextFloat()
+    {
+        // 24 bits fit exactly in a float's mantissa
+        return (Next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+private:
+    uint64_t state;
+};
+
+#endif // FASTRANDOM_H__
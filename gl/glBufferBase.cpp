@@ -76,6 +76,11 @@ bool GLBufferBase::IsBound() const
     return isBound;
 }
 
+size_t GLBufferBase::GetSize() const
+{
+    return size;
+}
+
 GLBufferLock::GLBufferLock(GLBufferBase* buffer)
     : buffer(buffer)
 {
@@ -69,6 +69,7 @@ public:
     virtual void Update(const void* data, size_t size) = 0;
 
     bool IsBound() const;
+    size_t GetSize() const;
 
 protected:
     GLuint buffer;
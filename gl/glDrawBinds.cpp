@@ -10,6 +10,7 @@
 
 GLDrawBinds::GLDrawBinds()
         : bound(false)
+          , needsRelink(false)
           , shaderProgram(0)
           , vao(0)
           , indexBuffer(nullptr)
@@ -560,6 +561,12 @@ void GLDrawBinds::Bind()
     {
         bound = true;
 
+        if(needsRelink)
+        {
+            needsRelink = false;
+            RelinkShaders();
+        }
+
         glBindVertexArray(vao);
         glUseProgram(shaderProgram);
 
@@ -698,6 +705,34 @@ void GLDrawBinds::DrawElements(GLsizei count, GLsizei offset, GLEnums::DRAW_MODE
     glDrawElements((GLenum)drawMode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)));
 }
 
+void GLDrawBinds::DrawElementsBaseVertex(GLsizei count, GLsizei offset, GLint baseVertex, GLEnums::DRAW_MODE drawMode /*= GLEnums::DRAW_MODE::TRIANGLES*/)
+{
+#ifndef NDEBUG
+    if(indexBuffer == nullptr)
+    {
+        LogWithName(LOG_TYPE::FATAL, "DrawElementsBaseVertex called without an blockIndex buffer set");
+        return;
+    }
+
+    // Appended indicies aren't counted, so check against the size of the buffer instead
+    GLsizei capacity = (GLsizei)(indexBuffer->GetSize() / sizeof(GLuint));
+    if(offset + count > capacity)
+    {
+        LogWithName(LOG_TYPE::WARNING, "offset + count is bigger than the index buffer ("
+                                       + std::to_string(offset)
+                                       + " + "
+                                       + std::to_string(count)
+                                       + " > "
+                                       + std::to_string(capacity)
+                                       + "). count will be clamped");
+
+        count = capacity - offset;
+    }
+#endif // NDEBUG
+
+    glDrawElementsBaseVertex((GLenum)drawMode, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(GLuint)), baseVertex);
+}
+
 void GLDrawBinds::DrawElementsInstanced(int instances, GLEnums::DRAW_MODE drawMode /*= GLEnums::DRAW_MODE::TRIANGLES*/)
 {
 #ifndef NDEBUG
@@ -711,6 +746,30 @@ void GLDrawBinds::DrawElementsInstanced(int instances, GLEnums::DRAW_MODE drawMo
     glDrawElementsInstanced((GLenum)drawMode, indexBuffer->GetIndiciesCount(), GL_UNSIGNED_INT, (void*)0, instances);
 }
 
+void GLDrawBinds::DrawElementsInstanced(GLsizei count, int instances, GLuint baseInstance, GLEnums::DRAW_MODE drawMode /*= GLEnums::DRAW_MODE::TRIANGLES*/)
+{
+#ifndef NDEBUG
+    if(indexBuffer == nullptr)
+    {
+        LogWithName(LOG_TYPE::FATAL, "DrawElementsInstanced called without an blockIndex buffer set");
+        return;
+    }
+
+    if(count > indexBuffer->GetIndiciesCount())
+    {
+        LogWithName(LOG_TYPE::WARNING, "count is bigger than number of indicies in buffer (" +
+                                     std::to_string(count) +
+                                     " > " +
+                                     std::to_string(indexBuffer->GetIndiciesCount()) +
+                                     "). count will be clamped");
+
+        count = indexBuffer->GetIndiciesCount();
+    }
+#endif // NDEBUG
+
+    glDrawElementsInstancedBaseInstance((GLenum)drawMode, count, GL_UNSIGNED_INT, (void*)0, instances, baseInstance);
+}
+
 void GLDrawBinds::AddBuffer(GLVertexBuffer* vertexBuffer)
 {
     vertexBuffers.push_back(vertexBuffer);
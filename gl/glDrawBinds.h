@@ -173,7 +173,16 @@ public:
     void DrawElements(GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
     void DrawElements(GLsizei count, GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
     void DrawElements(GLsizei count, GLsizei offset, GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
+    /**
+     * Draws count indicies starting at offset, with baseVertex added to every index.
+     * Used with GLIndexBuffer::Append and GLVertexBuffer::Append
+     */
+    void DrawElementsBaseVertex(GLsizei count, GLsizei offset, GLint baseVertex, GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
     void DrawElementsInstanced(int instances, GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
+    /**
+     * Draws the first count indicies instances times. Per instance attributes start at baseInstance
+     */
+    void DrawElementsInstanced(GLsizei count, int instances, GLuint baseInstance, GLEnums::DRAW_MODE drawMode = GLEnums::DRAW_MODE::TRIANGLES);
 
     GLVariable operator[](const std::string& name);
 
@@ -196,6 +205,8 @@ private:
     };
 
     bool bound;
+    // Set by hot reloaded shaders, so a program is only relinked once however many of its shaders changed
+    bool needsRelink;
 
     GLuint shaderProgram;
     GLuint vao;
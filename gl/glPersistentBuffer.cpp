@@ -0,0 +1,182 @@
+#include "glPersistentBuffer.h"
+
+#include <algorithm>
+
+#include "../logger.h"
+
+GLPersistentBuffer::GLPersistentBuffer()
+        : target(GL_SHADER_STORAGE_BUFFER)
+          , buffer(0)
+          , mappedData(nullptr)
+          , sliceSize(0)
+          , writtenSize(0)
+          , currentSlice(0)
+{}
+
+GLPersistentBuffer::~GLPersistentBuffer()
+{
+    Destroy();
+}
+
+bool GLPersistentBuffer::Init(GLenum target, size_t sliceSize, int sliceCount)
+{
+    if(sliceCount < 1)
+        return false;
+
+    Destroy();
+
+    this->target = target;
+    fences.assign((unsigned long)sliceCount, nullptr);
+
+    return Create(sliceSize);
+}
+
+void* GLPersistentBuffer::BeginWrite(size_t size)
+{
+    if(buffer == 0)
+        return nullptr;
+
+    // Everything issued up until now may read from the current slice
+    if(fences[currentSlice] != nullptr)
+        glDeleteSync(fences[currentSlice]);
+    fences[currentSlice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if(size > sliceSize)
+    {
+        for(int i = 0; i < (int)fences.size(); ++i)
+            WaitForSlice(i);
+
+        if(!Create(size + size / 2))
+            return nullptr;
+    }
+
+    currentSlice = (currentSlice + 1) % (int)fences.size();
+    WaitForSlice(currentSlice);
+
+    writtenSize = size;
+
+    return mappedData + GetOffset();
+}
+
+GLuint GLPersistentBuffer::GetBuffer() const
+{
+    return buffer;
+}
+
+GLenum GLPersistentBuffer::GetTarget() const
+{
+    return target;
+}
+
+size_t GLPersistentBuffer::GetOffset() const
+{
+    return sliceSize * currentSlice;
+}
+
+size_t GLPersistentBuffer::GetWrittenSize() const
+{
+    return writtenSize;
+}
+
+size_t GLPersistentBuffer::GetSliceSize() const
+{
+    return sliceSize;
+}
+
+bool GLPersistentBuffer::Create(size_t sliceSize)
+{
+    if(buffer != 0)
+    {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    // Slices are bound with glBindBufferRange, so each offset has to be aligned
+    size_t alignment = GetOffsetAlignment();
+    this->sliceSize = (sliceSize + alignment - 1) / alignment * alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    size_t totalSize = this->sliceSize * fences.size();
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferStorage(target, totalSize, nullptr, flags);
+    mappedData = (char*)glMapBufferRange(target, 0, totalSize, flags);
+    glBindBuffer(target, 0);
+
+    if(mappedData == nullptr)
+    {
+        Logger::LogLine(LOG_TYPE::FATAL, "Couldn't map persistent buffer of size ", totalSize);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+
+        return false;
+    }
+
+    currentSlice = 0;
+    writtenSize = 0;
+
+    return true;
+}
+
+void GLPersistentBuffer::Destroy()
+{
+    for(GLsync& fence : fences)
+    {
+        if(fence != nullptr)
+            glDeleteSync(fence);
+
+        fence = nullptr;
+    }
+
+    if(buffer != 0)
+    {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        glDeleteBuffers(1, &buffer);
+
+        buffer = 0;
+        mappedData = nullptr;
+    }
+}
+
+void GLPersistentBuffer::WaitForSlice(int slice)
+{
+    if(fences[slice] == nullptr)
+        return;
+
+    // Flush on the first try, otherwise the fence might never be submitted
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(true)
+    {
+        GLenum result = glClientWaitSync(fences[slice], waitFlags, 1000000);
+
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            break;
+        else if(result == GL_WAIT_FAILED)
+        {
+            Logger::LogLine(LOG_TYPE::WARNING, "glClientWaitSync failed on persistent buffer slice ", slice);
+            break;
+        }
+
+        waitFlags = 0;
+    }
+
+    glDeleteSync(fences[slice]);
+    fences[slice] = nullptr;
+}
+
+size_t GLPersistentBuffer::GetOffsetAlignment() const
+{
+    GLint alignment = 1;
+
+    if(target == GL_SHADER_STORAGE_BUFFER)
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    else if(target == GL_UNIFORM_BUFFER)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    return (size_t)std::max(alignment, 1);
+}
@@ -0,0 +1,61 @@
+#ifndef GLPERSISTENTBUFFER_H__
+#define GLPERSISTENTBUFFER_H__
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+/**
+* A persistently and coherently mapped buffer split into a ring of slices.
+*
+* Every call to BeginWrite moves to the next slice and fences the previous
+* one, so the CPU only waits if it gets sliceCount frames ahead of the GPU.
+* The buffer is created with glBufferStorage, so growing it means creating a
+* new buffer; always ask for the buffer with GetBuffer instead of caching it.
+*/
+class GLPersistentBuffer
+{
+public:
+    GLPersistentBuffer();
+    ~GLPersistentBuffer();
+
+    GLPersistentBuffer(const GLPersistentBuffer& other) = delete;
+    GLPersistentBuffer& operator=(const GLPersistentBuffer& rhs) = delete;
+
+    const static int DEFAULT_SLICE_COUNT = 3;
+
+    bool Init(GLenum target, size_t sliceSize, int sliceCount = DEFAULT_SLICE_COUNT);
+
+    /**
+    * Moves to the next slice and returns a pointer to it.
+    *
+    * Waits for the GPU if the slice is still in use, and grows the buffer if
+    * size doesn't fit in a slice. The memory is write-combined, write it
+    * sequentially and don't read from it.
+    */
+    void* BeginWrite(size_t size);
+
+    GLuint GetBuffer() const;
+    GLenum GetTarget() const;
+    size_t GetOffset() const;
+    size_t GetWrittenSize() const;
+    size_t GetSliceSize() const;
+
+private:
+    GLenum target;
+    GLuint buffer;
+    char* mappedData;
+
+    size_t sliceSize;
+    size_t writtenSize;
+    int currentSlice;
+
+    std::vector<GLsync> fences;
+
+    bool Create(size_t sliceSize);
+    void Destroy();
+    void WaitForSlice(int slice);
+    size_t GetOffsetAlignment() const;
+};
+
+#endif // GLPERSISTENTBUFFER_H__
@@ -57,13 +57,15 @@ bool GLShader::Apply(Content* content)
 
     this->shader = shader->shader;
     this->shaderSource = std::move(shader->shaderSource);
+    this->includeFiles = std::move(shader->includeFiles);
 
     // TODO: Move?
     for(auto shaderProgram : shaderPrograms)
         glAttachShader(shaderProgram->GetShaderProgram(), this->shader);
 
+    // Relinked on their next Bind, after every other shader in this hot reload has been applied
     for(auto shaderProgram : shaderPrograms)
-        shaderProgram->RelinkShaders();
+        shaderProgram->needsRelink = true;
 
     //Parse(shaderSource, variables, nullptr); // TODO: Support this?
     shaderSource.resize(0);
@@ -87,6 +89,7 @@ CONTENT_ERROR_CODES GLShader::Load(const char* filePath
     if(shaderSource.empty())
         return CONTENT_ERROR_CODES::COULDNT_OPEN_CONTENT_FILE;
 
+    includeFiles.clear();
     Parse(shaderSource, parameters->variables, contentManager);
 
     if(!CompileFromSource(shaderSource))
@@ -115,6 +118,7 @@ CONTENT_ERROR_CODES GLShader::BeginHotReload(const char* filePath, ContentManage
 {
     shaderSource = ReadSourceFromFile(filePath);
 
+    includeFiles.clear();
     Parse(shaderSource, variables, nullptr);
 
     if(shaderSource.empty())
@@ -133,7 +137,15 @@ bool GLShader::ApplyHotReload()
 
 DiskContent* GLShader::CreateInstance() const
 {
-    return new GLShader(shaderType);
+    GLShader* instance = new GLShader(shaderType);
+    instance->variables = variables;
+
+    return instance;
+}
+
+void GLShader::GetFileDependencies(std::vector<std::string>& filePaths) const
+{
+    filePaths.insert(filePaths.end(), includeFiles.begin(), includeFiles.end());
 }
 
 bool GLShader::CompileFromSource(const std::string& source)
@@ -338,6 +350,8 @@ std::string GLShader::ParseInclude(const std::string& line, const std::vector<st
             shared->AddUsage(this);
     }
 
+    includeFiles.push_back(thisPath + name);
+
     std::string includeFileSource = ReadSourceFromFile(thisPath + name);
     if(includeFileSource.empty())
     {
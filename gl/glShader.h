@@ -41,6 +41,8 @@ protected:
     bool ApplyHotReload() override;
     bool Apply(Content* content) override;
 
+    void GetFileDependencies(std::vector<std::string>& filePaths) const override;
+
     DiskContent* CreateInstance() const override;
 
 private:
@@ -51,6 +53,7 @@ private:
 
     std::string shaderSource; //For hot reloading
     std::vector<GLDrawBinds*> shaderPrograms; //For hot reloading
+    std::vector<std::string> includeFiles; //For hot reloading
 
     std::vector<std::pair<std::string, std::string>> variables;
 
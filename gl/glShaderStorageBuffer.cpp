@@ -17,7 +17,14 @@ GLShaderStorageBuffer::~GLShaderStorageBuffer()
 
 void GLShaderStorageBuffer::Bind()
 {
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, bufferIndex);
+    if(persistentBuffer != nullptr && persistentBuffer->GetWrittenSize() > 0)
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER
+                          , bindingPoint
+                          , persistentBuffer->GetBuffer()
+                          , persistentBuffer->GetOffset()
+                          , persistentBuffer->GetWrittenSize());
+    else
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, GetBuffer());
 }
 
 void GLShaderStorageBuffer::Unbind()
@@ -35,6 +42,31 @@ bool GLShaderStorageBuffer::Init(bool bind)
     return true;
 }
 
+bool GLShaderStorageBuffer::InitPersistent(size_t sliceSize, int sliceCount)
+{
+    std::shared_ptr<GLPersistentBuffer> newBuffer = std::make_shared<GLPersistentBuffer>();
+    if(!newBuffer->Init(GL_SHADER_STORAGE_BUFFER, sliceSize, sliceCount))
+        return false;
+
+    persistentBuffer = std::move(newBuffer);
+    this->size = 0;
+
+    return true;
+}
+
+void* GLShaderStorageBuffer::MapPersistent(size_t dataSize)
+{
+    void* mappedData = persistentBuffer->BeginWrite(dataSize);
+    this->size = (GLint)dataSize;
+
+    return mappedData;
+}
+
+bool GLShaderStorageBuffer::IsPersistent() const
+{
+    return persistentBuffer != nullptr;
+}
+
 void GLShaderStorageBuffer::SetData(const void* data, size_t dataSize)
 {
     if(dataSize == 0)
@@ -43,6 +75,12 @@ void GLShaderStorageBuffer::SetData(const void* data, size_t dataSize)
         return;
     }
 
+    if(persistentBuffer != nullptr)
+    {
+        std::memcpy(MapPersistent(dataSize), data, dataSize);
+        return;
+    }
+
     if(dataSize > this->size)
     {
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferIndex);
@@ -63,6 +101,12 @@ void GLShaderStorageBuffer::SetData(const void* data, size_t dataSize)
 
 void GLShaderStorageBuffer::SetData(GLDynamicBuffer* buffer)
 {
+    if(persistentBuffer != nullptr)
+    {
+        buffer->UploadData(MapPersistent(buffer->GetTotalSize()));
+        return;
+    }
+
     if(buffer->GetTotalSize() != this->size)
     {
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferIndex);
@@ -81,6 +125,8 @@ void GLShaderStorageBuffer::SetData(GLDynamicBuffer* buffer)
 
 void GLShaderStorageBuffer::Share(GLShaderStorageBuffer* other)
 {
+    this->persistentBuffer = other->persistentBuffer;
+
     if(bufferIndex == other->bufferIndex)
         return;
 
@@ -99,6 +145,12 @@ void GLShaderStorageBuffer::Share(GLShaderStorageBuffer* other)
 
 void GLShaderStorageBuffer::UpdateData(const size_t offset, void* data, int dataSize)
 {
+    if(persistentBuffer != nullptr)
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "UpdateData isn't supported on persistent buffer \"" + name + "\"");
+        return;
+    }
+
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferIndex);
     void* mappedData = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, offset, dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
     std::memcpy(mappedData, data, dataSize);
@@ -108,6 +160,13 @@ void GLShaderStorageBuffer::UpdateData(const size_t offset, void* data, int data
 
 void GLShaderStorageBuffer::SetData(int value)
 {
+    if(persistentBuffer != nullptr)
+    {
+        size_t writtenSize = persistentBuffer->GetWrittenSize();
+        std::memset(MapPersistent(writtenSize), value, writtenSize);
+        return;
+    }
+
     void* data = malloc(size);
     std::memset(data, value, this->size);
 
@@ -120,7 +179,17 @@ void GLShaderStorageBuffer::SetData(int value)
 
 std::unique_ptr<void, UniquePtrFree> GLShaderStorageBuffer::GetData() const
 {
-    void* data = malloc((size_t)this->size);
+    void* data = malloc((size_t)GetSize());
+
+    // Persistently mapped memory is write-only, read it back through GL instead
+    if(persistentBuffer != nullptr)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, persistentBuffer->GetBuffer());
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, persistentBuffer->GetOffset(), GetSize(), data);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        return std::unique_ptr<void, UniquePtrFree>(data);
+    }
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferIndex);
     void* mappedData = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
@@ -134,9 +203,21 @@ std::unique_ptr<void, UniquePtrFree> GLShaderStorageBuffer::GetData() const
 
 int GLShaderStorageBuffer::GetSize() const
 {
+    // Buffers sharing a persistent buffer don't see each other's writes
+    if(persistentBuffer != nullptr)
+        return (int)persistentBuffer->GetWrittenSize();
+
     return size;
 }
 
+GLuint GLShaderStorageBuffer::GetBuffer() const
+{
+    if(persistentBuffer != nullptr)
+        return persistentBuffer->GetBuffer();
+
+    return bufferIndex;
+}
+
 /*void GLShaderStorageBuffer::Replace(GLShaderStorageBuffer* other)
 {
     assert(this->shaderProgram != -1
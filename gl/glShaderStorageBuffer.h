@@ -4,6 +4,7 @@
 #include <memory>
 #include "glBufferBase.h"
 #include "glDynamicBuffer.h"
+#include "glPersistentBuffer.h"
 
 struct UniquePtrFree
 {
@@ -21,6 +22,13 @@ public:
     ~GLShaderStorageBuffer();
 
     bool Init(bool bind = true);
+    /**
+    * Switches this buffer to a persistently mapped ring of sliceCount slices.
+    *
+    * Use MapPersistent to write a new frame's data, buffers sharing this one
+    * bind whatever slice was written last.
+    */
+    bool InitPersistent(size_t sliceSize, int sliceCount = GLPersistentBuffer::DEFAULT_SLICE_COUNT);
     void Bind();
     void Unbind();
 
@@ -30,9 +38,16 @@ public:
     void SetData(int value);
     void SetData(const void* data, size_t dataSize);
 
+    /**
+    * Moves to the next slice of a persistent buffer and returns a pointer to it
+    */
+    void* MapPersistent(size_t dataSize);
+    bool IsPersistent() const;
+
     std::unique_ptr<void, UniquePtrFree> GetData() const;
 
     int GetSize() const;
+    GLuint GetBuffer() const;
 
 protected:
 private:
@@ -46,6 +61,8 @@ private:
 
     bool deallocateOnShare;
 
+    std::shared_ptr<GLPersistentBuffer> persistentBuffer;
+
     void SetData(GLDynamicBuffer* buffer);
 };
 
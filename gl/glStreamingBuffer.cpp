@@ -2,29 +2,134 @@
 #include "glStreamingBuffer.h"
 
 GLStreamingBuffer::GLStreamingBuffer()
-        : currentOffset(0)
+        : writeOffset(0)
+        , firstWrittenSegment(-1)
+        , lastWrittenSegment(-1)
+        , segmentFences()
 {}
 
 GLStreamingBuffer::~GLStreamingBuffer()
-{}
+{
+    for(GLsync& fence : segmentFences)
+    {
+        if(fence != nullptr)
+            glDeleteSync(fence);
+
+        fence = nullptr;
+    }
+}
 
-void GLStreamingBuffer::Update(const void* data, size_t size)
+size_t GLStreamingBuffer::Append(GLBufferBase& buffer, GLenum bindType, const void* data, size_t size, size_t alignment)
 {
-#ifndef NDEBUG
-    if(size > this->size)
+    if(buffer.IsBound())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Trying to append to bound buffer, no action will be taken");
+        return INVALID_OFFSET;
+    }
+
+    size_t bufferSize = buffer.GetSize();
+    if(size == 0 || size > bufferSize)
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Can't append ", size, " bytes to streaming buffer of size ", bufferSize);
+        return INVALID_OFFSET;
+    }
+
+    // Everything issued up until now may read from what was appended last
+    if(firstWrittenSegment != -1)
+    {
+        for(int i = firstWrittenSegment; i <= lastWrittenSegment; ++i)
+            FenceSegment(i);
+    }
+
+    size_t offset = (writeOffset + alignment - 1) / alignment * alignment;
+    bool wrapped = offset + size > bufferSize;
+    if(wrapped)
+        offset = 0;
+
+    size_t segmentSize = (bufferSize + SEGMENT_COUNT - 1) / SEGMENT_COUNT;
+    int firstSegment = (int)(offset / segmentSize);
+    int lastSegment = (int)((offset + size - 1) / segmentSize);
+
+    // The segment the last append ended in is still ours, any other has to be
+    // done being read from before it's overwritten
+    int currentSegment = writeOffset == 0 ? -1 : (int)((writeOffset - 1) / segmentSize);
+    for(int i = firstSegment; i <= lastSegment; ++i)
+    {
+        if(wrapped || i != currentSegment)
+            WaitForSegment(i);
+    }
+
+    // Binding an index buffer changes the bound vertex array's element buffer,
+    // so map it with no vertex array bound
+    GLint boundVertexArray = 0;
+    if(bindType == GL_ELEMENT_ARRAY_BUFFER)
     {
-        Logger::LogLine(LOG_TYPE::WARNING, "Size too big when updating buffer: , size, " > ", this->size. Only enough data to fit in the buffer will be copied");
-        size = this->size;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &boundVertexArray);
+        if(boundVertexArray != 0)
+            glBindVertexArray(0);
     }
-#endif // NDEBUG
 
-    GLBufferLock(this);
+    void* mappedBuffer = nullptr;
+    {
+        GLBufferLock lock(buffer);
+
+        mappedBuffer = glMapBufferRange(bindType
+                                        , offset
+                                        , size
+                                        , GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if(mappedBuffer != nullptr)
+        {
+            memcpy(mappedBuffer, data, size);
+            glUnmapBuffer(bindType);
+        }
+    }
+
+    if(boundVertexArray != 0)
+        glBindVertexArray((GLuint)boundVertexArray);
+
+    if(mappedBuffer == nullptr)
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Couldn't map streaming buffer range ", offset, " + ", size);
+        return INVALID_OFFSET;
+    }
+
+    writeOffset = offset + size;
+    firstWrittenSegment = firstSegment;
+    lastWrittenSegment = lastSegment;
+
+    return offset;
+}
 
-    // Orphan if needed
-    if(currentOffset + size > this->size)
-        glBufferData(bindType, this->size, nullptr, GL_STREAM_DRAW);
+void GLStreamingBuffer::FenceSegment(int segment)
+{
+    if(segmentFences[segment] != nullptr)
+        glDeleteSync(segmentFences[segment]);
+
+    segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GLStreamingBuffer::WaitForSegment(int segment)
+{
+    if(segmentFences[segment] == nullptr)
+        return;
+
+    // Flush on the first try, otherwise the fence might never be submitted
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(true)
+    {
+        GLenum result = glClientWaitSync(segmentFences[segment], waitFlags, 1000000);
+
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            break;
+        else if(result == GL_WAIT_FAILED)
+        {
+            Logger::LogLine(LOG_TYPE::WARNING, "glClientWaitSync failed on streaming buffer segment ", segment);
+            break;
+        }
+
+        waitFlags = 0;
+    }
 
-    void* mappedBuffer = glMapBufferRange(bindType, currentOffset, size, GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_WRITE_BIT);
-    memcpy(mappedBuffer, data, size);
-    glUnmapBuffer(bindType);
+    glDeleteSync(segmentFences[segment]);
+    segmentFences[segment] = nullptr;
 }
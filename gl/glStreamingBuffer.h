@@ -3,17 +3,56 @@
 
 #include "glBufferBase.h"
 
+#include <GL/gl3w.h>
+
+/**
+* Bookkeeping for a buffer that is written to as an append-only ring, see
+* GLStreamingVertexBuffer and GLStreamingIndexBuffer.
+*
+* Every Append writes after the previous one and maps its range with
+* GL_MAP_UNSYNCHRONIZED_BIT, so the driver never has to orphan the buffer or
+* wait for draws that read from other parts of it. The ring is split into
+* segments, each with a fence that is placed once the GPU might read from
+* it. The CPU only waits when the write position comes back around to a
+* segment whose fence hasn't been signaled yet.
+*
+* Draws that read from an appended range should be issued before appending
+* to the same buffer again, otherwise the fence won't cover them.
+*/
 class GLStreamingBuffer
-        : public GLBufferBase
 {
 public:
+    GLStreamingBuffer(const GLStreamingBuffer& other) = delete;
+    GLStreamingBuffer& operator=(const GLStreamingBuffer& rhs) = delete;
+
+    const static size_t INVALID_OFFSET = ~(size_t)0;
+
+protected:
     GLStreamingBuffer();
     ~GLStreamingBuffer();
 
-    void Update(const void* data, size_t size) override;
+    /**
+    * Copies data to the next free range in buffer's ring
+    *
+    * \param alignment the returned offset will be a multiple of this
+    * \returns the byte offset data was written to, or INVALID_OFFSET if it
+    * doesn't fit in the buffer or the buffer is bound
+    */
+    size_t Append(GLBufferBase& buffer, GLenum bindType, const void* data, size_t size, size_t alignment);
 
 private:
-    GLint currentOffset;
+    const static int SEGMENT_COUNT = 4;
+
+    size_t writeOffset;
+
+    // Segments written to by the last call to Append, -1 if none
+    int firstWrittenSegment;
+    int lastWrittenSegment;
+
+    GLsync segmentFences[SEGMENT_COUNT];
+
+    void FenceSegment(int segment);
+    void WaitForSegment(int segment);
 };
 
 #endif // GLSTREAMINGBUFFER_H__
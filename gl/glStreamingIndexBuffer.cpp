@@ -0,0 +1,21 @@
+#include "glStreamingIndexBuffer.h"
+
+GLStreamingIndexBuffer::GLStreamingIndexBuffer()
+{}
+
+GLStreamingIndexBuffer::~GLStreamingIndexBuffer()
+{}
+
+GLsizei GLStreamingIndexBuffer::Append(const std::vector<GLuint>& indicies)
+{
+    size_t offset = GLStreamingBuffer::Append(*this, bindType, indicies.data(), indicies.size() * sizeof(GLuint), sizeof(GLuint));
+    if(offset == INVALID_OFFSET)
+        return -1;
+
+    return (GLsizei)(offset / sizeof(GLuint));
+}
+
+void GLStreamingIndexBuffer::Update(const void* data, size_t size)
+{
+    GLStreamingBuffer::Append(*this, bindType, data, size, sizeof(GLuint));
+}
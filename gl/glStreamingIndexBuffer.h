@@ -0,0 +1,33 @@
+#ifndef GLSTREAMINGINDEXBUFFER_H__
+#define GLSTREAMINGINDEXBUFFER_H__
+
+#include "glIndexBuffer.h"
+#include "glStreamingBuffer.h"
+
+/**
+* An index buffer that is written to every frame, see GLStreamingBuffer
+*/
+class GLStreamingIndexBuffer
+        : public GLIndexBuffer
+        , protected GLStreamingBuffer
+{
+public:
+    GLStreamingIndexBuffer();
+    ~GLStreamingIndexBuffer();
+
+    /**
+     * Appends indicies to the ring
+     *
+     * @return The offset of the first appended index, or -1 if they didn't fit
+     */
+    GLsizei Append(const std::vector<GLuint>& indicies);
+
+    /**
+     * Same as Append, the whole buffer is never replaced since the GPU might still read from it
+     */
+    void Update(const void* data, size_t size) override;
+    // Would replace the whole buffer, use Append
+    void Update(const std::vector<GLuint>& indicies) = delete;
+};
+
+#endif // GLSTREAMINGINDEXBUFFER_H__
@@ -0,0 +1,12 @@
+#include "glStreamingVertexBuffer.h"
+
+GLStreamingVertexBuffer::GLStreamingVertexBuffer()
+{}
+
+GLStreamingVertexBuffer::~GLStreamingVertexBuffer()
+{}
+
+void GLStreamingVertexBuffer::Update(const void* data, size_t size)
+{
+    GLStreamingBuffer::Append(*this, bindType, data, size, (size_t)GetStride());
+}
@@ -0,0 +1,41 @@
+#ifndef GLSTREAMINGVERTEXBUFFER_H__
+#define GLSTREAMINGVERTEXBUFFER_H__
+
+#include "glVertexBuffer.h"
+#include "glStreamingBuffer.h"
+
+/**
+* A vertex buffer that is written to every frame, see GLStreamingBuffer
+*/
+class GLStreamingVertexBuffer
+        : public GLVertexBuffer
+        , protected GLStreamingBuffer
+{
+public:
+    GLStreamingVertexBuffer();
+    ~GLStreamingVertexBuffer();
+
+    /**
+     * Appends whole vertices to the ring
+     *
+     * @return The base vertex to draw the appended vertices with, or -1 if they didn't fit
+     */
+    template<typename VectorType>
+    GLint Append(const std::vector<VectorType>& vertices)
+    {
+        GLsizei stride = GetStride();
+
+        size_t offset = GLStreamingBuffer::Append(*this, bindType, vertices.data(), vertices.size() * sizeof(VectorType), (size_t)stride);
+        if(offset == INVALID_OFFSET)
+            return -1;
+
+        return (GLint)(offset / stride);
+    }
+
+    /**
+     * Same as Append, the whole buffer is never replaced since the GPU might still read from it
+     */
+    void Update(const void* data, size_t size) override;
+};
+
+#endif // GLSTREAMINGVERTEXBUFFER_H__
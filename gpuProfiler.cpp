@@ -0,0 +1,141 @@
+#include "gpuProfiler.h"
+
+#include "logger.h"
+#include "profiler.h"
+
+bool GPUProfiler::initialized = false;
+int GPUProfiler::track = -1;
+
+GPUProfiler::Frame GPUProfiler::frames[FRAME_COUNT];
+int GPUProfiler::currentFrame = 0;
+std::vector<int> GPUProfiler::openZones;
+
+long long GPUProfiler::timeOffset = 0;
+int GPUProfiler::framesSinceCalibration = 0;
+
+void GPUProfiler::Init()
+{
+    if(initialized)
+        return;
+
+    track = Profiler::AddTrack("GPU");
+
+    Calibrate();
+
+    for(Frame& frame : frames)
+        frame.timeOffset = timeOffset;
+
+    initialized = true;
+}
+
+void GPUProfiler::BeginFrame()
+{
+    if(!initialized)
+        return;
+
+    if(!openZones.empty())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "GPUProfiler::BeginFrame called with ", (int)openZones.size(), " open zones");
+
+        // Their end queries were never written, reading them would never finish
+        Frame& frame = frames[currentFrame];
+        for(int zone : openZones)
+        {
+            if(zone >= 0)
+                glQueryCounter(frame.queries[zone * 2 + 1], GL_TIMESTAMP);
+        }
+
+        openZones.clear();
+    }
+
+    currentFrame = (currentFrame + 1) % FRAME_COUNT;
+
+    Frame& frame = frames[currentFrame];
+    ReadFrame(frame);
+    frame.zones.clear();
+
+    if(++framesSinceCalibration >= CALIBRATION_INTERVAL)
+        Calibrate();
+
+    frame.timeOffset = timeOffset;
+}
+
+void GPUProfiler::BeginZone(const char* name)
+{
+    if(!initialized)
+        return;
+
+    Frame& frame = frames[currentFrame];
+    if(frame.zones.size() >= MAX_ZONES_PER_FRAME)
+    {
+        openZones.push_back(-1);
+        return;
+    }
+
+    int zone = (int)frame.zones.size();
+    if(frame.queries.size() < (unsigned long)(zone + 1) * 2)
+    {
+        frame.queries.resize((unsigned long)(zone + 1) * 2);
+        glGenQueries(2, &frame.queries[zone * 2]);
+    }
+
+    PendingZone pendingZone;
+    pendingZone.name = name;
+    pendingZone.depth = (int)openZones.size();
+    frame.zones.push_back(pendingZone);
+
+    glQueryCounter(frame.queries[zone * 2], GL_TIMESTAMP);
+
+    openZones.push_back(zone);
+}
+
+void GPUProfiler::EndZone()
+{
+    if(!initialized)
+        return;
+
+    if(openZones.empty())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "GPUProfiler::EndZone called without a matching BeginZone");
+        return;
+    }
+
+    int zone = openZones.back();
+    openZones.pop_back();
+
+    if(zone >= 0)
+        glQueryCounter(frames[currentFrame].queries[zone * 2 + 1], GL_TIMESTAMP);
+}
+
+void GPUProfiler::Calibrate()
+{
+    // The GPU's time once every command so far has reached it, which is close enough to "now"
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+
+    timeOffset = Profiler::GetTime() - (long long)gpuTime;
+    framesSinceCalibration = 0;
+}
+
+void GPUProfiler::ReadFrame(Frame& frame)
+{
+    if(frame.zones.empty())
+        return;
+
+    std::vector<Profiler::Zone> zones(frame.zones.size());
+    for(int i = 0; i < (int)frame.zones.size(); ++i)
+    {
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+        Profiler::Zone& zone = zones[i];
+        zone.name = frame.zones[i].name;
+        zone.depth = frame.zones[i].depth;
+        zone.start = (long long)start + frame.timeOffset;
+        zone.end = (long long)end + frame.timeOffset;
+    }
+
+    Profiler::RecordZones(track, zones);
+}
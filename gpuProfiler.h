@@ -0,0 +1,95 @@
+#ifndef GPUPROFILER_H__
+#define GPUPROFILER_H__
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+#define GPU_PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define GPU_PROFILE_ZONE_CONCAT(a, b) GPU_PROFILE_ZONE_CONCAT_INNER(a, b)
+/**
+* Times the GL commands issued in the rest of the current scope. Same
+* restrictions on name as PROFILE_ZONE
+*/
+#define GPU_PROFILE_ZONE(name) GPUProfileZone GPU_PROFILE_ZONE_CONCAT(gpuProfileZone, __LINE__)(name)
+
+/**
+* Nested GPU zones timed with GL_TIMESTAMP query pairs.
+*
+* Unlike GPUTimer zones can be nested and there can be any number of them per
+* frame. Results are read FRAME_COUNT - 1 frames later and recorded on a "GPU"
+* track in Profiler. GPU timestamps are moved onto the profiler's timeline with
+* an offset measured through glGetInteger64v(GL_TIMESTAMP) every
+* CALIBRATION_INTERVAL frames, so GPU zones show up next to the CPU zones that
+* issued them (shifted by however far behind the GPU is).
+*
+* Everything has to be called from the thread that owns the GL context.
+*/
+class GPUProfiler
+{
+public:
+    const static int FRAME_COUNT = 4;
+    const static int MAX_ZONES_PER_FRAME = 256;
+    const static int CALIBRATION_INTERVAL = 64;
+
+    static void Init();
+
+    /**
+    * Reads back the frame issued FRAME_COUNT frames ago and starts a new one.
+    *
+    * Only blocks if the GPU is still working on that frame
+    */
+    static void BeginFrame();
+
+    static void BeginZone(const char* name);
+    static void EndZone();
+
+private:
+    struct PendingZone
+    {
+        const char* name;
+        int depth;
+    };
+
+    struct Frame
+    {
+        // Begin and end query for every zone
+        std::vector<GLuint> queries;
+        std::vector<PendingZone> zones;
+
+        // Added to GPU timestamps to get profiler time
+        long long timeOffset;
+    };
+
+    static bool initialized;
+    static int track;
+
+    static Frame frames[FRAME_COUNT];
+    static int currentFrame;
+    // Indices into the current frame's zones, -1 for zones past MAX_ZONES_PER_FRAME
+    static std::vector<int> openZones;
+
+    static long long timeOffset;
+    static int framesSinceCalibration;
+
+    static void Calibrate();
+    static void ReadFrame(Frame& frame);
+};
+
+class GPUProfileZone
+{
+public:
+    GPUProfileZone(const char* name)
+    {
+        GPUProfiler::BeginZone(name);
+    }
+    ~GPUProfileZone()
+    {
+        GPUProfiler::EndZone();
+    }
+
+    GPUProfileZone(const GPUProfileZone& other) = delete;
+    GPUProfileZone& operator=(const GPUProfileZone& rhs) = delete;
+};
+
+#endif // GPUPROFILER_H__
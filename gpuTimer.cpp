@@ -0,0 +1,105 @@
+#include "gpuTimer.h"
+
+GPUTimer::GPUTimer()
+        : writeIndex(0)
+          , readIndex(0)
+          , latestTime(0)
+{}
+
+GPUTimer::~GPUTimer()
+{
+    if(!queries.empty())
+        glDeleteQueries((GLsizei)queries.size(), &queries[0]);
+}
+
+bool GPUTimer::Init(int queryCount)
+{
+    if(queryCount < 1)
+        return false;
+
+    if(!queries.empty())
+        glDeleteQueries((GLsizei)queries.size(), &queries[0]);
+
+    queries.resize((unsigned long)queryCount);
+    pending.assign((unsigned long)queryCount, false);
+    frames.assign((unsigned long)queryCount, -1);
+    results.clear();
+    writeIndex = 0;
+    readIndex = 0;
+    latestTime = 0;
+
+    glGenQueries(queryCount, &queries[0]);
+
+    return true;
+}
+
+void GPUTimer::Start(int frame)
+{
+    GetTime();
+
+    // Every query is in flight, the oldest one has to be read before it can be reused
+    if(pending[writeIndex])
+        ReadResult();
+
+    frames[writeIndex] = frame;
+    glBeginQuery(GL_TIME_ELAPSED, queries[writeIndex]);
+}
+
+void GPUTimer::Stop()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+
+    pending[writeIndex] = true;
+    writeIndex = (writeIndex + 1) % (int)queries.size();
+}
+
+GLuint64 GPUTimer::GetTime()
+{
+    if(queries.empty())
+        return 0;
+
+    // Queries finish in order, so stop at the first one that isn't done
+    while(pending[readIndex])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[readIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if(!available)
+            break;
+
+        ReadResult();
+    }
+
+    return latestTime;
+}
+
+std::vector<GPUTimer::Result> GPUTimer::TakeResults()
+{
+    GetTime();
+
+    std::vector<Result> taken;
+    taken.swap(results);
+
+    return taken;
+}
+
+void GPUTimer::Finish()
+{
+    if(queries.empty())
+        return;
+
+    while(pending[readIndex])
+        ReadResult();
+}
+
+void GPUTimer::ReadResult()
+{
+    // Blocks if the result isn't available yet
+    glGetQueryObjectui64v(queries[readIndex], GL_QUERY_RESULT, &latestTime);
+
+    if(frames[readIndex] >= 0)
+        results.push_back({ frames[readIndex], latestTime });
+
+    pending[readIndex] = false;
+    readIndex = (readIndex + 1) % (int)queries.size();
+}
@@ -0,0 +1,72 @@
+#ifndef GPUTIMER_H__
+#define GPUTIMER_H__
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+/**
+* A GPU timer using a ring of GL_TIME_ELAPSED queries.
+*
+* Results are read back without waiting for the GPU, so the time returned by
+* GetTime is from a previous frame (at most queryCount - 1 frames old).
+* Timers can't be nested since only one GL_TIME_ELAPSED query can be active.
+*/
+class GPUTimer
+{
+public:
+    GPUTimer();
+    ~GPUTimer();
+
+    const static int DEFAULT_QUERY_COUNT = 4;
+
+    bool Init(int queryCount = DEFAULT_QUERY_COUNT);
+
+    struct Result
+    {
+        int frame;
+        GLuint64 time;
+    };
+
+    /**
+    * Begins timing the following GL commands.
+    *
+    * Only blocks if every query in the ring is still waiting for the GPU
+    *
+    * \param frame if not negative, the result is kept until TakeResults so it can be matched to the frame that issued it
+    */
+    void Start(int frame = -1);
+    void Stop();
+
+    /**
+    * Reads any finished queries without blocking
+    *
+    * \returns the latest available time in nanoseconds, 0 until the first query has finished
+    */
+    GLuint64 GetTime();
+
+    /**
+    * Reads any finished queries without blocking
+    *
+    * \returns every finished result that was started with a frame, oldest first
+    */
+    std::vector<Result> TakeResults();
+    // Blocks until every query in flight has finished
+    void Finish();
+
+private:
+    std::vector<GLuint> queries;
+    std::vector<bool> pending;
+    std::vector<int> frames;
+
+    std::vector<Result> results;
+
+    int writeIndex;
+    int readIndex;
+
+    GLuint64 latestTime;
+
+    void ReadResult();
+};
+
+#endif // GPUTIMER_H__
@@ -1,6 +1,7 @@
 #include "lightCull.h"
 
 LightCull::LightCull()
+        : timedFrame(-1)
 {}
 
 LightCull::~LightCull()
@@ -10,4 +11,19 @@ void LightCull::InitShaderConstants(int screenWidth, int screenHeight)
 {
     this->screenWidth = screenWidth;
     this->screenHeight = screenHeight;
-}
\ No newline at end of file
+}
+
+void LightCull::SetTimedFrame(int frame)
+{
+    timedFrame = frame;
+}
+
+std::vector<GPUTimer::Result> LightCull::TakeTimes()
+{
+    return gpuTimer.TakeResults();
+}
+
+void LightCull::FinishTimes()
+{
+    gpuTimer.Finish();
+}
@@ -6,6 +6,7 @@
 #include "content/contentManager.h"
 #include "console/console.h"
 #include "gl/glDrawBinds.h"
+#include "gpuTimer.h"
 
 class LightCull
 {
@@ -19,8 +20,22 @@ public:
     virtual void SetDrawBindData(GLDrawBinds& binds) = 0;
 
     virtual void Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) = 0;
+    /**
+     * Same as Draw but also returns the time (in nanoseconds) it took.
+     * GPU backends return the time from a few frames back, see GPUTimer
+     */
     virtual GLuint64 TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) = 0;
 
+    /**
+     * Tags the times of following TimedDraws with \p frame so they can be
+     * matched to it once they are available, -1 doesn't keep them
+     */
+    void SetTimedFrame(int frame);
+    // Every tagged time that is available, oldest first
+    virtual std::vector<GPUTimer::Result> TakeTimes();
+    // Blocks until every tagged time is available
+    virtual void FinishTimes();
+
     virtual void DrawLightCount(SpriteRenderer& spriteRenderer
                                 , CharacterSet* characterSetSmall
                                 , CharacterSet* characterSetBig) = 0;
@@ -33,7 +48,8 @@ protected:
     int screenWidth;
     int screenHeight;
 
-    GLuint timeQuery;
+    GPUTimer gpuTimer;
+    int timedFrame;
 
     const static int MAX_LIGHTS_PER_TILE = 512;
 };
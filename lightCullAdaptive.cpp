@@ -4,6 +4,9 @@
 #include "console/console.h"
 #include "console/commandGetSet.h"
 #include "gl/glCPPShared.h"
+#include "gpuProfiler.h"
+
+#include <algorithm>
 
 LightCullAdaptive::LightCullAdaptive()
 {}
@@ -27,6 +30,7 @@ bool LightCullAdaptive::Init(ContentManager& contentManager, Console& console)
                     std::make_pair("THREADS_PER_GROUP_X", "16")
                     , std::make_pair("THREADS_PER_GROUP_Y", "16")
                     , std::make_pair("MAX_LIGHTS_PER_TILE", std::to_string(GetMaxLightsPerTile()))
+                    , std::make_pair("MAX_REFINE_TILES", std::to_string(MAX_REFINE_TILES))
             };
     sharedParameters.outPath = std::string(contentManager.GetRootDir()) + "/lightCullAdaptive";
     sharedVariables = contentManager.Load<GLCPPShared>("lightCullAdaptive/shared.h", &sharedParameters);
@@ -34,6 +38,10 @@ bool LightCullAdaptive::Init(ContentManager& contentManager, Console& console)
     console.AddCommand(new CommandGetSet<int>("treeMaxDepth", &treeMaxDepth));
     console.AddCommand(new CommandGetSet<int>("treeStartDepth", &treeStartDepth));
 
+    depthZoneNames.clear();
+    for(int depth = 0; depth <= TREE_MAX_DEPTH; ++depth)
+        depthZoneNames.push_back("Tree depth " + std::to_string(depth));
+
     ////////////////////////////////////////////////////////////
     // Make sure there aren't too many lights per tile
 
@@ -61,6 +69,14 @@ bool LightCullAdaptive::Init(ContentManager& contentManager, Console& console)
     lightCullDrawBinds["TileLights"] = std::vector<int>(GetMaxNumberOfTiles() * 4 * 2, -1);
     lightCullDrawBinds["ScreenSize"] = glm::ivec2(screenWidth, screenHeight);
     lightCullDrawBinds["TreeDepthData"] = glm::ivec2(treeStartDepth, treeMaxDepth);
+    lightCullDrawBinds["Tree"] = std::vector<int>((unsigned long)GetMaxNumberOfTreeIndices(), -1);
+
+    // Offsets only depend on the buffer sizes, so every depth's offsets can be uploaded once.
+    // + 2 since the forward pass reads from treeMaxDepth + 1
+    std::vector<glm::ivec4> readWriteOffsets;
+    for(int depth = 0; depth < TREE_MAX_DEPTH + 2; ++depth)
+        readWriteOffsets.push_back(GetReadWriteOffsets(depth));
+    lightCullDrawBinds["ReadWriteOffsets"] = readWriteOffsets;
 
     ////////////////////////////////////////////////////////////
     // Light reduction
@@ -83,7 +99,27 @@ bool LightCullAdaptive::Init(ContentManager& contentManager, Console& console)
     lightReductionDrawBinds["ReadWriteOffsets"] = lightCullDrawBinds["ReadWriteOffsets"];
     lightReductionDrawBinds["TreeDepthData"] = lightCullDrawBinds["TreeDepthData"];
 
-    glGenQueries(1, &timeQuery);
+    ////////////////////////////////////////////////////////////
+    // Light compaction
+
+    lightCompactionDrawBinds.AddUniform("depth", 1);
+    lightCompactionDrawBinds.AddShaders(contentManager, GLEnums::SHADER_TYPE::COMPUTE, "lightCullAdaptive/lightCompaction.comp");
+    if(!lightCompactionDrawBinds.Init())
+        return false;
+
+    lightCompactionDrawBinds["RefineTiles"] = std::vector<glm::ivec2>((unsigned long)((TREE_MAX_DEPTH + 1) * MAX_REFINE_TILES), glm::ivec2(0));
+    lightCompactionDrawBinds["DispatchArgs"] = GetEmptyDispatchArgs();
+    lightCompactionDrawBinds["ScreenSize"] = lightCullDrawBinds["ScreenSize"];
+    lightCompactionDrawBinds["TileLights"] = lightCullDrawBinds["TileLights"];
+    lightCompactionDrawBinds["Tree"] = lightCullDrawBinds["Tree"];
+    lightCompactionDrawBinds["ReadWriteOffsets"] = lightCullDrawBinds["ReadWriteOffsets"];
+    lightCompactionDrawBinds["TreeDepthData"] = lightCullDrawBinds["TreeDepthData"];
+
+    lightReductionDrawBinds["RefineTiles"] = lightCompactionDrawBinds["RefineTiles"];
+    // lightCull.comp resets the arguments at the start of every frame
+    lightCullDrawBinds["DispatchArgs"] = lightCompactionDrawBinds["DispatchArgs"];
+
+    gpuTimer.Init();
 
     return true;
 }
@@ -99,33 +135,23 @@ void LightCullAdaptive::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInv
 
 GLuint64 LightCullAdaptive::TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
 {
-    GLuint64 lightCullTime;
-
     PreDraw(viewMatrix, projectionMatrixInverse);
 
-    glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+    gpuTimer.Start(timedFrame);
     Draw();
-    glEndQuery(GL_TIME_ELAPSED);
-
-    GLint timeAvailable = 0;
-    while(!timeAvailable)
-        glGetQueryObjectiv(timeQuery,  GL_QUERY_RESULT_AVAILABLE, &timeAvailable);
-
-    glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &lightCullTime);
+    gpuTimer.Stop();
 
     PostDraw();
 
-    return lightCullTime;
+    return gpuTimer.GetTime();
 }
 
 void LightCullAdaptive::PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
 {
     ////////////////////////////////////////////////////////////
     // Light culling
-    int zero = 0;
     lightCullDrawBinds.GetSSBO("TileLights")->SetData(-1);
-    //lightCullDrawBinds.GetSSBO("LightIndices")->SetData(-1);
-    //lightCullDrawBinds.GetSSBO("LightIndices")->UpdateData(0, &zero, sizeof(int));
+    lightCullDrawBinds.GetSSBO("Tree")->SetData(-1);
 
     lightCullDrawBinds["viewMatrix"] = viewMatrix;
     lightCullDrawBinds["projectionInverseMatrix"] = projectionMatrixInverse;
@@ -136,80 +162,57 @@ void LightCullAdaptive::PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix
     lightReductionDrawBinds["viewMatrix"] = viewMatrix;
     lightReductionDrawBinds["projectionInverseMatrix"] = projectionMatrixInverse;
 
-    int size = 0;
-    for(int i = 0; i < GetTreeMaxDepth(); ++i)
-        size += pow(2, i + 1) * pow(2, i + 1);
-    lightCullDrawBinds["Tree"] = std::vector<int>(size, -1);
-
-    glm::ivec4 readWriteOffsets(0);
-    lightCullDrawBinds["ReadWriteOffsets"] = readWriteOffsets;
-
     lightCullDrawBinds.Bind();
 }
 
 void LightCullAdaptive::Draw()
 {
+    // Everything is ordered on the GPU, per-level state is only uniforms and
+    // barriers so the CPU never has to wait here
     GLuint threadGroupCount = (GLuint)std::pow(2, treeStartDepth);
 
+    GPUProfiler::BeginZone(depthZoneNames[std::min(treeStartDepth, (int)TREE_MAX_DEPTH)].c_str());
     glDispatchCompute(threadGroupCount, threadGroupCount, 1);
+    GPUProfiler::EndZone();
 
     lightCullDrawBinds.Unbind();
 
-    GLsync writeSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-    auto val = glClientWaitSync(writeSync, 0, 1000000000);
-    if(val == GL_TIMEOUT_EXPIRED
-       || val == GL_WAIT_FAILED)
-    {
-        assert(false);
-    }
-    glDeleteSync(writeSync);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-
-    lightReductionDrawBinds.Bind();
-
-    int indexLength = ((lightReductionDrawBinds.GetSSBO("LightIndices")->GetSize()) / sizeof(int)) / 2;
-    int lightDataLength = (lightReductionDrawBinds.GetSSBO("TileLights")->GetSize() / (sizeof(int) * 4)) / 2;
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, lightCompactionDrawBinds.GetSSBO("DispatchArgs")->GetBuffer());
 
-    glm::ivec4 readWriteOffsets(0);
     for(int depth = treeStartDepth + 1; depth <= treeMaxDepth; ++depth)
     {
-        lightReductionDrawBinds["oldDepth"] = depth - 1;
-        lightReductionDrawBinds["newDepth"] = depth;
+        GPU_PROFILE_ZONE(depthZoneNames[std::min(depth, (int)TREE_MAX_DEPTH)].c_str());
 
-        readWriteOffsets.x = depth % 2 * indexLength;
-        readWriteOffsets.y = (depth + 1) % 2 * indexLength;
-        readWriteOffsets.z = depth % 2 * lightDataLength;
-        readWriteOffsets.w = (depth + 1) % 2 * lightDataLength;
-        lightCullDrawBinds["ReadWriteOffsets"] = readWriteOffsets;
-        lightCullDrawBinds.GetUBO("ReadWriteOffsets")->Update();
+        // Previous level's TileLights, LightIndices, and Tree writes
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-        threadGroupCount = (GLuint)std::pow(2, depth);
+        // Find which parents have any lights
+        int parentTileCount = (int)std::pow(2, depth - 1);
+        GLuint compactionGroupCount = (GLuint)((parentTileCount + COMPACTION_THREADS_PER_GROUP - 1) / COMPACTION_THREADS_PER_GROUP);
 
-        glDispatchCompute(threadGroupCount, threadGroupCount, 1);
+        lightCompactionDrawBinds.Bind();
+        lightCompactionDrawBinds["depth"] = depth - 1;
+        glDispatchCompute(compactionGroupCount, compactionGroupCount, 1);
+        lightCompactionDrawBinds.Unbind();
 
-        writeSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-        val = glClientWaitSync(writeSync, 0, 1000000000);
-        if(val == GL_TIMEOUT_EXPIRED
-            || val == GL_WAIT_FAILED)
-        {
-            assert(false);
-        }
-        glDeleteSync(writeSync);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+        // Only refine those parents
+        lightReductionDrawBinds.Bind();
+        lightReductionDrawBinds["oldDepth"] = depth - 1;
+        lightReductionDrawBinds["newDepth"] = depth;
+        glDispatchComputeIndirect((GLintptr)(GetDispatchArgsOffset(depth - 1) * sizeof(GLuint)));
+        lightReductionDrawBinds.Unbind();
     }
 
-    readWriteOffsets.x = (treeMaxDepth + 1) % 2 * indexLength;
-    readWriteOffsets.y = (treeMaxDepth + 2) % 2 * indexLength;
-    readWriteOffsets.z = (treeMaxDepth + 1) % 2 * lightDataLength;
-    readWriteOffsets.w = (treeMaxDepth + 2) % 2 * lightDataLength;
-    lightCullDrawBinds["ReadWriteOffsets"] = readWriteOffsets;
-    lightCullDrawBinds.GetUBO("ReadWriteOffsets")->Update();
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    // Forward pass reads the result
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
 void LightCullAdaptive::PostDraw()
-{
-    lightReductionDrawBinds.Unbind();
-}
+{}
 
 int GetTreeLinearIndex(int x, int y)
 {
@@ -230,14 +233,85 @@ int GetTreeLinearIndex(int x, int y)
     return index;
 }
 
-int LightCullAdaptive::GetTreeDataScreen(int screenX, int screenY, int* tree)
+int LightCullAdaptive::Validate(LightTreeCPU& reference
+                                , const std::vector<LightData>& lights
+                                , glm::mat4 viewMatrix
+                                , glm::mat4 projectionMatrixInverse
+                                , const std::vector<glm::vec2>* tileDepth)
 {
-    int depthOffset = 0;
+    reference.Build(lights, viewMatrix, projectionMatrixInverse, glm::ivec2(screenWidth, screenHeight), treeStartDepth, treeMaxDepth, tileDepth);
+
+    auto treeData = lightCullDrawBinds.GetSSBO("Tree")->GetData();
+    auto tileLightsData = lightCullDrawBinds.GetSSBO("TileLights")->GetData();
+    auto lightIndicesData = lightCullDrawBinds.GetSSBO("LightIndices")->GetData();
+
+    int* tree = (int*)treeData.get();
+    glm::ivec4* tileLights = (glm::ivec4*)tileLightsData.get();
+    int* lightIndices = (int*)lightIndicesData.get();
 
-    for(int i = 1; i < treeMaxDepth; ++i)
+    int mismatches = 0;
+
+    // Same as GetTreeDataGrid in tree.glsl
+    int depthOffset = -1;
+    for(int i = 0; i < treeStartDepth; ++i)
+        depthOffset += (int)std::pow(4, i);
+
+    for(int depth = treeStartDepth; depth <= treeMaxDepth; ++depth)
+    {
+        // Tiles at this depth were written to depth + 1's read offsets
+        glm::ivec4 readWriteOffsets = GetReadWriteOffsets(depth + 1);
+
+        for(int y = 0; y < (1 << depth); ++y)
+        {
+            for(int x = 0; x < (1 << depth); ++x)
+            {
+                int treeIndex = tree[depthOffset + GetTreeLinearIndex(x, y)];
+                int referenceCount = reference.GetLightCount(x, y, depth);
+
+                if((treeIndex >= 0) != (referenceCount >= 0))
+                {
+                    ++mismatches;
+                    continue;
+                }
+
+                // Only leaves still have their data, the rest might be overwritten by their grandchildren
+                if(!reference.IsLeaf(x, y, depth))
+                    continue;
+
+                glm::ivec4 tileLight = tileLights[readWriteOffsets.z + treeIndex];
+                if(tileLight.y != referenceCount)
+                {
+                    ++mismatches;
+                    continue;
+                }
+
+                if(referenceCount > MAX_LIGHTS_PER_TILE)
+                    continue;
+
+                // Order depends on the atomics
+                std::vector<int> gpuLights(lightIndices + readWriteOffsets.x + tileLight.x
+                                           , lightIndices + readWriteOffsets.x + tileLight.x + tileLight.y);
+                std::sort(gpuLights.begin(), gpuLights.end());
+
+                if(gpuLights != reference.GetLights(x, y, depth))
+                    ++mismatches;
+            }
+        }
+
+        depthOffset += (int)std::pow(4, depth);
+    }
+
+    return mismatches;
+}
+
+int LightCullAdaptive::GetTreeDataGrid(int x, int y, int depth, int* tree)
+{
+    // Same as GetTreeDataGrid in tree.glsl
+    int depthOffset = -1;
+    for(int i = 0; i < depth; ++i)
         depthOffset += int(pow(4, i));
 
-    int index = GetTreeLinearIndex(screenX, screenY);
+    int index = GetTreeLinearIndex(x, y);
 
     return tree[depthOffset + index];
 }
@@ -256,30 +330,31 @@ void LightCullAdaptive::DrawLightCount(SpriteRenderer& spriteRenderer
         int padding1;
     };
 
-    int indexLength = ((lightReductionDrawBinds.GetSSBO("LightIndices")->GetSize()) / sizeof(int)) / 2;
-    int lightDataLength = (lightReductionDrawBinds.GetSSBO("TileLights")->GetSize() / (sizeof(int) * 4)) / 2;
-    glm::ivec4 readWriteOffsets;
-    readWriteOffsets.x = (treeMaxDepth + 1) % 2 * indexLength;
-    readWriteOffsets.y = (treeMaxDepth + 2) % 2 * indexLength;
-    readWriteOffsets.z = (treeMaxDepth + 1) % 2 * lightDataLength;
-    readWriteOffsets.w = (treeMaxDepth + 2) % 2 * lightDataLength;
-
     auto tileLights = lightCullDrawBinds.GetSSBO("TileLights")->GetData();
 
-    int threadCount = (int)(std::pow(2, treeMaxDepth));
-    int spacing = screenWidth / threadCount;
-
-    for(int y = 0; y < threadCount; ++y)
+    // Tiles without lights aren't refined, so every leaf is drawn at the depth it ended at
+    for(int depth = treeStartDepth; depth <= treeMaxDepth; ++depth)
     {
-        for(int x = 0; x < threadCount; ++x)
-        {
-            int treeData = GetTreeDataScreen(x, (threadCount - y - 1), (int*)tree.get());
+        // What depth wrote is read with the offsets of the next depth, see lightCompaction.comp
+        glm::ivec4 readWriteOffsets = GetReadWriteOffsets(depth + 1);
 
-            if(treeData >= 0)
+        int tileCount = 1 << depth;
+        int spacing = screenWidth / tileCount;
+
+        for(int y = 0; y < tileCount; ++y)
+        {
+            for(int x = 0; x < tileCount; ++x)
             {
-                TileLight currentTile = ((TileLight*)tileLights.get())[readWriteOffsets.z + treeData];
+                int treeData = GetTreeDataGrid(x, (tileCount - y - 1), depth, (int*)tree.get());
+                if(treeData < 0)
+                    continue;
 
-                //spriteRenderer.DrawString(characterSet, std::to_string(((int*)tree.get())[startOffset + index]), glm::vec2(spacing * x, spacing * y));
+                // Refined tiles always write all four children
+                if(depth < treeMaxDepth
+                   && GetTreeDataGrid(x * 2, (tileCount - y - 1) * 2, depth + 1, (int*)tree.get()) >= 0)
+                    continue;
+
+                TileLight currentTile = ((TileLight*)tileLights.get())[readWriteOffsets.z + treeData];
 
                 std::string text = std::to_string(currentTile.count);
                 auto textWidth = characterSetSmall->GetWidthAtIndex(text.c_str(), -1);
@@ -304,6 +379,38 @@ void LightCullAdaptive::DrawLightCount(SpriteRenderer& spriteRenderer
     }
 }
 
+glm::ivec4 LightCullAdaptive::GetReadWriteOffsets(int depth) const
+{
+    // LightIndices and TileLights are double buffered, each depth reads from one half and writes to the other
+    int indexLength = GetMaxNumberOfTiles() * MAX_LIGHTS_PER_TILE;
+    int lightDataLength = GetMaxNumberOfTiles();
+
+    return glm::ivec4(depth % 2 * indexLength
+                      , (depth + 1) % 2 * indexLength
+                      , depth % 2 * lightDataLength
+                      , (depth + 1) % 2 * lightDataLength);
+}
+
+std::vector<GLuint> LightCullAdaptive::GetEmptyDispatchArgs() const
+{
+    // num_groups_x is increased by lightCompaction.comp
+    std::vector<GLuint> dispatchArgs;
+    for(int depth = 0; depth < TREE_MAX_DEPTH + 1; ++depth)
+    {
+        dispatchArgs.push_back(0);
+        dispatchArgs.push_back(1);
+        dispatchArgs.push_back(1);
+    }
+
+    return dispatchArgs;
+}
+
+int LightCullAdaptive::GetDispatchArgsOffset(int depth) const
+{
+    // Same as GetDispatchArgsOffset in refineTiles.glsl
+    return depth * 3;
+}
+
 int LightCullAdaptive::GetMaxLightsPerTile() const
 {
     return MAX_LIGHTS_PER_TILE;
@@ -8,6 +8,7 @@
 #include "spriteRenderer.h"
 #include "console/console.h"
 #include "gl/glCPPShared.h"
+#include "lightTreeCPU.h"
 
 class LightCullAdaptive
     : public LightCull
@@ -35,22 +36,45 @@ public:
     int GetTreeStartDepth() const;
     int GetTreeMaxDepth() const;
 
+    /**
+     * Builds \p reference with the current tree depths and compares it to the
+     * tree from the last Draw. Every leaf's light count is compared, and so is
+     * its light list unless it overflowed (the GPU keeps an arbitrary subset).
+     *
+     * \returns number of tiles that differ
+     */
+    int Validate(LightTreeCPU& reference
+                 , const std::vector<LightData>& lights
+                 , glm::mat4 viewMatrix
+                 , glm::mat4 projectionMatrixInverse
+                 , const std::vector<glm::vec2>* tileDepth);
+
     GLDrawBinds lightCullDrawBinds;
     GLDrawBinds lightReductionDrawBinds;
+    GLDrawBinds lightCompactionDrawBinds;
 
     std::string GetForwardShaderPath() override;
     std::string GetForwardShaderDebugPath() override;
 protected:
 private:
     const static int TREE_MAX_DEPTH = 6;
+    // Max number of parent tiles at a single depth
+    const static int MAX_REFINE_TILES = 1 << (2 * (TREE_MAX_DEPTH - 1));
+    const static int COMPACTION_THREADS_PER_GROUP = 8;
 
     int treeStartDepth = 1;
     int treeMaxDepth = TREE_MAX_DEPTH;
 
+    // GPU profiler zone name for each depth, the profiler only keeps the pointers
+    std::vector<std::string> depthZoneNames;
+
     void PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse);
     void Draw();
     void PostDraw();
-    int GetTreeDataScreen(int screenX, int screenY, int* tree);
+    int GetTreeDataGrid(int x, int y, int depth, int* tree);
+    glm::ivec4 GetReadWriteOffsets(int depth) const;
+    std::vector<GLuint> GetEmptyDispatchArgs() const;
+    int GetDispatchArgsOffset(int depth) const;
 
     std::vector<glm::vec4> colors;
 
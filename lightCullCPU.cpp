@@ -0,0 +1,327 @@
+#include "lightCullCPU.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <thread>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include "console/commandCallMethod.h"
+#include "timer.h"
+#include "tileCulling.h"
+
+LightCullCPU::LightCullCPU()
+        : threadGroupCount(0)
+          , lightsBuffer(nullptr)
+          , depthReduction(nullptr)
+          , lightCount(0)
+          , lightIndicesBuffer("LightIndices", 0, 0, 0)
+          , tileLightsBuffer("TileLights", 0, 0, 0)
+{
+    workerPool.Init((int)std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+LightCullCPU::~LightCullCPU()
+{}
+
+void LightCullCPU::InitShaderConstants(int screenWidth, int screenHeight)
+{
+    LightCull::InitShaderConstants(screenWidth, screenHeight);
+
+    threadGroupCount = glm::ivec2((int)std::pow(2, MAX_DEPTH));
+
+    // Light count + light indices
+    lightIndices = std::vector<int>((unsigned long)(1 + GetMaxNumberOfTiles() * MAX_LIGHTS_PER_TILE), -1);
+    // start + numberOfLights + padding
+    tileLights = std::vector<glm::ivec4>((unsigned long)GetMaxNumberOfTiles(), glm::ivec4(-1));
+}
+
+bool LightCullCPU::Init(ContentManager& contentManager, Console& console)
+{
+    for(int i = 0; i < GetMaxNumberOfTiles(); ++i)
+        colors.push_back({rand() / float(RAND_MAX), rand() / float(RAND_MAX), rand() / float(RAND_MAX), 1.0f});
+
+    console.AddCommand(new CommandCallMethod("lightCPU_threadCount"
+                                             , [&](const std::vector<Argument>& args)
+            {
+                if(args.size() == 0)
+                    return Argument("threadCount = " + std::to_string(GetThreadCount()));
+                else if(args.size() != 1 || !std::isdigit((unsigned char)args.front().value[0]))
+                    return Argument("Needs 1 positive number");
+
+                SetThreadCount(std::atoi(args.front().value.c_str()));
+
+                return Argument("threadCount updated to " + std::to_string(GetThreadCount()));
+            }
+    ));
+
+    // Bind is false since these aren't attached to any program,
+    // they are shared with the forward pass in SetDrawBindData
+    lightIndicesBuffer.Init(false);
+    tileLightsBuffer.Init(false);
+
+    Upload();
+
+    return true;
+}
+
+void LightCullCPU::SetLightsBuffer(LightsBuffer* lightsBuffer)
+{
+    this->lightsBuffer = lightsBuffer;
+}
+
+void LightCullCPU::SetDepthReduction(DepthReduction* depthReduction)
+{
+    this->depthReduction = depthReduction;
+}
+
+void LightCullCPU::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
+{
+    if(depthReduction != nullptr)
+        depthReduction->GetTileDepth(tileDepth);
+
+    Cull(*lightsBuffer, viewMatrix, projectionMatrixInverse, depthReduction != nullptr ? &tileDepth : nullptr);
+    Upload();
+}
+
+GLuint64 LightCullCPU::TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
+{
+    if(depthReduction != nullptr)
+        depthReduction->GetTileDepth(tileDepth);
+
+    Timer timer;
+    timer.Start();
+
+    Cull(*lightsBuffer, viewMatrix, projectionMatrixInverse, depthReduction != nullptr ? &tileDepth : nullptr);
+
+    timer.Stop();
+
+    Upload();
+
+    // Nanoseconds, same as GL_TIME_ELAPSED
+    GLuint64 time = (GLuint64)timer.GetTimeNanoseconds();
+    if(timedFrame >= 0)
+        times.push_back({ timedFrame, time });
+
+    return time;
+}
+
+std::vector<GPUTimer::Result> LightCullCPU::TakeTimes()
+{
+    // Timed on the CPU, so they're available right away
+    std::vector<GPUTimer::Result> taken;
+    taken.swap(times);
+
+    return taken;
+}
+
+void LightCullCPU::Cull(const LightsBuffer& lights
+                        , glm::mat4 viewMatrix
+                        , glm::mat4 projectionMatrixInverse
+                        , const std::vector<glm::vec2>* tileDepth)
+{
+    TransformLights(lights, viewMatrix);
+
+    lightIndices[0] = 0;
+
+    workerPool.ParallelFor(threadGroupCount.y, [&](int y, int threadIndex)
+    {
+        for(int x = 0; x < threadGroupCount.x; ++x)
+            CullTile(x, y, projectionMatrixInverse, tileDepth);
+    });
+}
+
+void LightCullCPU::TransformLights(const LightsBuffer& lights, glm::mat4 viewMatrix)
+{
+    lightCount = lights.GetCount();
+
+    viewX.resize((unsigned long)lightCount);
+    viewY.resize((unsigned long)lightCount);
+    viewZ.resize((unsigned long)lightCount);
+    viewRadius.resize((unsigned long)lightCount);
+
+    for(int i = 0; i < lightCount; ++i)
+    {
+        glm::vec3 viewPosition = glm::vec3(viewMatrix * glm::vec4(lights.positionX[i], lights.positionY[i], lights.positionZ[i], 1.0f));
+
+        viewX[i] = viewPosition.x;
+        viewY[i] = viewPosition.y;
+        viewZ[i] = viewPosition.z;
+    }
+
+    std::copy(lights.strength.begin(), lights.strength.end(), viewRadius.begin());
+}
+
+void LightCullCPU::CullTile(int x, int y, glm::mat4 projectionMatrixInverse, const std::vector<glm::vec2>* tileDepth)
+{
+    // Rounded up like LightCullNormal and DepthReduction
+    glm::vec2 tileSize((screenWidth + threadGroupCount.x - 1) / threadGroupCount.x, (screenHeight + threadGroupCount.y - 1) / threadGroupCount.y);
+    TileCulling::TileFrustum frustum = TileCulling::CreateTileFrustum(glm::ivec2(x, y)
+                                                                      , tileSize
+                                                                      , glm::vec2(screenWidth, screenHeight)
+                                                                      , projectionMatrixInverse);
+    const glm::vec3* planes = frustum.planes;
+    glm::vec3 forward = frustum.forward;
+
+    // The last depth level has the same number of tiles as this culler
+    glm::vec2 depthBounds = TileCulling::GetUnboundedDepth();
+    if(tileDepth != nullptr)
+        depthBounds = (*tileDepth)[DepthReduction::GetTileIndex(x, y, MAX_DEPTH)];
+
+    ////////////////////////////////////////////////////////////
+    // Test lights
+    int arrayIndex = y * threadGroupCount.x + x;
+    int startIndex = arrayIndex * MAX_LIGHTS_PER_TILE;
+
+    // + 1 to skip occupiedIndices
+    int* tileIndices = &lightIndices[1 + startIndex];
+    int tileLightCount = 0;
+
+    auto addLight = [&](int lightIndex)
+    {
+        if(tileLightCount < MAX_LIGHTS_PER_TILE)
+            tileIndices[tileLightCount] = lightIndex;
+
+        ++tileLightCount;
+    };
+
+    int i = 0;
+
+#if defined(__SSE__)
+    const __m128 zero4 = _mm_setzero_ps();
+    const __m128 forwardX4 = _mm_set1_ps(forward.x);
+    const __m128 forwardY4 = _mm_set1_ps(forward.y);
+    const __m128 forwardZ4 = _mm_set1_ps(forward.z);
+    const __m128 depthMin4 = _mm_set1_ps(depthBounds.x);
+    const __m128 depthMax4 = _mm_set1_ps(depthBounds.y);
+
+    __m128 planeX4[4];
+    __m128 planeY4[4];
+    __m128 planeZ4[4];
+    for(int j = 0; j < 4; ++j)
+    {
+        planeX4[j] = _mm_set1_ps(planes[j].x);
+        planeY4[j] = _mm_set1_ps(planes[j].y);
+        planeZ4[j] = _mm_set1_ps(planes[j].z);
+    }
+
+    for(; i + 4 <= lightCount; i += 4)
+    {
+        __m128 lightX = _mm_loadu_ps(&viewX[i]);
+        __m128 lightY = _mm_loadu_ps(&viewY[i]);
+        __m128 lightZ = _mm_loadu_ps(&viewZ[i]);
+        __m128 radius = _mm_loadu_ps(&viewRadius[i]);
+        __m128 negativeRadius = _mm_sub_ps(zero4, radius);
+
+        __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lightX, lightX), _mm_mul_ps(lightY, lightY)), _mm_mul_ps(lightZ, lightZ));
+        __m128 near = _mm_cmple_ps(lengthSquared, _mm_mul_ps(radius, radius));
+
+        __m128 forwardDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lightX, forwardX4), _mm_mul_ps(lightY, forwardY4)), _mm_mul_ps(lightZ, forwardZ4));
+        __m128 inside = _mm_cmpgt_ps(forwardDot, zero4);
+
+        for(int j = 0; j < 4; ++j)
+        {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lightX, planeX4[j]), _mm_mul_ps(lightY, planeY4[j])), _mm_mul_ps(lightZ, planeZ4[j]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negativeRadius));
+        }
+
+        __m128 insideDepth = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(lightZ, radius), depthMin4)
+                                        , _mm_cmple_ps(_mm_sub_ps(lightZ, radius), depthMax4));
+
+        int mask = _mm_movemask_ps(_mm_and_ps(insideDepth, _mm_or_ps(near, inside)));
+        while(mask != 0)
+        {
+            addLight(i + __builtin_ctz((unsigned int)mask));
+            mask &= mask - 1;
+        }
+    }
+#endif // __SSE__
+
+    // Remaining lights, or all of them if there's no SIMD support
+    for(; i < lightCount; ++i)
+    {
+        if(TileCulling::LightInsideTile(viewX[i], viewY[i], viewZ[i], viewRadius[i], frustum, depthBounds))
+            addLight(i);
+    }
+
+    int cappedLightCount = std::min(tileLightCount, (int)MAX_LIGHTS_PER_TILE);
+    std::fill(tileIndices + cappedLightCount, tileIndices + MAX_LIGHTS_PER_TILE, -1);
+
+    tileLights[arrayIndex] = glm::ivec4(startIndex, tileLightCount, x, y);
+}
+
+void LightCullCPU::Upload()
+{
+    lightIndicesBuffer.SetData(&lightIndices[0], sizeof(int) * lightIndices.size());
+    tileLightsBuffer.SetData(&tileLights[0], sizeof(glm::ivec4) * tileLights.size());
+}
+
+const std::vector<int>& LightCullCPU::GetLightIndices() const
+{
+    return lightIndices;
+}
+
+const std::vector<glm::ivec4>& LightCullCPU::GetTileLights() const
+{
+    return tileLights;
+}
+
+glm::ivec2 LightCullCPU::GetThreadGroupCount() const
+{
+    return threadGroupCount;
+}
+
+int LightCullCPU::GetMaxLightsPerTile() const
+{
+    return MAX_LIGHTS_PER_TILE;
+}
+
+int LightCullCPU::GetMaxNumberOfTiles() const
+{
+    return threadGroupCount.x * threadGroupCount.y;
+}
+
+int LightCullCPU::GetThreadCount() const
+{
+    return workerPool.GetThreadCount();
+}
+
+void LightCullCPU::SetThreadCount(int threadCount)
+{
+    if(threadCount != workerPool.GetThreadCount())
+        workerPool.Init(std::max(threadCount, 1));
+}
+
+void LightCullCPU::ResolutionChanged(int newWidth, int newHeight)
+{
+    this->screenWidth = newWidth;
+    this->screenHeight = newHeight;
+}
+
+void LightCullCPU::SetDrawBindData(GLDrawBinds& binds)
+{
+    binds["LightIndices"] = GLVariable(&binds, &lightIndicesBuffer);
+    binds["TileLights"] = GLVariable(&binds, &tileLightsBuffer);
+    binds["ScreenSize"] = glm::ivec2(screenWidth, screenHeight);
+    binds["ColorBuffer"] = colors;
+}
+
+void LightCullCPU::DrawLightCount(SpriteRenderer& spriteRenderer
+                                  , CharacterSet* characterSetSmall
+                                  , CharacterSet* characterSetBig)
+{
+
+}
+
+std::string LightCullCPU::GetForwardShaderPath()
+{
+    return "lightCullNormal/forward.frag";
+}
+
+std::string LightCullCPU::GetForwardShaderDebugPath()
+{
+    return "lightCullNormal/forwardDebug.frag";
+}
@@ -0,0 +1,104 @@
+#ifndef LIGHTCULLCPU_H__
+#define LIGHTCULLCPU_H__
+
+#include "lightCull.h"
+#include "lightManager.h"
+#include "gl/glShaderStorageBuffer.h"
+#include "depthReduction.h"
+#include "workerPool.h"
+
+/**
+ * Reference light culler running entirely on the CPU.
+ *
+ * Produces the same TileLights/LightIndices layout as LightCullNormal so the
+ * normal forward shaders can be used. Cull() never touches GL and can be used
+ * without a context.
+ */
+class LightCullCPU
+        : public LightCull
+{
+public:
+    LightCullCPU();
+    ~LightCullCPU();
+
+    void InitShaderConstants(int screenWidth, int screenHeight) override;
+    bool Init(ContentManager& contentManager, Console& console) override;
+    void SetDrawBindData(GLDrawBinds& binds) override;
+
+    void Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) override;
+    GLuint64 TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) override;
+    std::vector<GPUTimer::Result> TakeTimes() override;
+
+    void DrawLightCount(SpriteRenderer& spriteRenderer
+                        , CharacterSet* characterSetSmall
+                        , CharacterSet* characterSetBig) override;
+
+    void ResolutionChanged(int newWidth, int newHeight) override;
+
+    std::string GetForwardShaderPath() override;
+    std::string GetForwardShaderDebugPath() override;
+
+    void SetLightsBuffer(LightsBuffer* lightsBuffer);
+    // If set, the tile depth is read back every Draw and used to cull against each tile's depth bounds
+    void SetDepthReduction(DepthReduction* depthReduction);
+
+    /**
+     * Culls \p lights against every tile. Doesn't use any GL calls
+     *
+     * \param tileDepth tile depth pyramid as given by DepthReduction, or nullptr to skip depth bounds
+     */
+    void Cull(const LightsBuffer& lights
+              , glm::mat4 viewMatrix
+              , glm::mat4 projectionMatrixInverse
+              , const std::vector<glm::vec2>* tileDepth = nullptr);
+
+    // occupiedIndices + light indices, same as the LightIndices buffer
+    const std::vector<int>& GetLightIndices() const;
+    // start + numberOfLights + padding, same as the TileLights buffer
+    const std::vector<glm::ivec4>& GetTileLights() const;
+
+    glm::ivec2 GetThreadGroupCount() const;
+    int GetMaxLightsPerTile() const;
+    int GetMaxNumberOfTiles() const;
+
+    int GetThreadCount() const;
+    void SetThreadCount(int threadCount);
+protected:
+private:
+    // Same as LightCullNormal so the same forward shader can be used
+    const static int MAX_DEPTH = 8;
+
+    glm::ivec2 threadGroupCount;
+
+    // Rows of tiles are culled in parallel
+    WorkerPool workerPool;
+
+    LightsBuffer* lightsBuffer;
+    DepthReduction* depthReduction;
+
+    std::vector<glm::vec2> tileDepth;
+
+    // Tagged TimedDraw times until TakeTimes
+    std::vector<GPUTimer::Result> times;
+
+    // View space light positions and radii (SoA, for SIMD loads)
+    std::vector<float> viewX;
+    std::vector<float> viewY;
+    std::vector<float> viewZ;
+    std::vector<float> viewRadius;
+    int lightCount;
+
+    std::vector<int> lightIndices;
+    std::vector<glm::ivec4> tileLights;
+
+    GLShaderStorageBuffer lightIndicesBuffer;
+    GLShaderStorageBuffer tileLightsBuffer;
+
+    std::vector<glm::vec4> colors;
+
+    void TransformLights(const LightsBuffer& lights, glm::mat4 viewMatrix);
+    void CullTile(int x, int y, glm::mat4 projectionMatrixInverse, const std::vector<glm::vec2>* tileDepth);
+    void Upload();
+};
+
+#endif // LIGHTCULLCPU_H__
@@ -0,0 +1,178 @@
+#include "lightCullClustered.h"
+
+namespace
+{
+    float ToViewDepth(float ndcDepth, const glm::mat4& projectionMatrixInverse)
+    {
+        glm::vec4 unprojected = projectionMatrixInverse * glm::vec4(0.0f, 0.0f, ndcDepth, 1.0f);
+        return unprojected.z / unprojected.w;
+    }
+}
+
+LightCullClustered::LightCullClustered()
+        : threadsPerGroup(16, 16)
+          , sharedVariables(nullptr)
+{}
+
+LightCullClustered::~LightCullClustered()
+{}
+
+void LightCullClustered::InitShaderConstants(int screenWidth, int screenHeight)
+{
+    LightCull::InitShaderConstants(screenWidth, screenHeight);
+}
+
+bool LightCullClustered::Init(ContentManager& contentManager, Console& console)
+{
+    threadGroupCount = glm::ivec2((int)std::pow(2, MAX_DEPTH));
+
+    for(int i = 0; i < GetMaxNumberOfClusters(); ++i)
+        colors.push_back({rand() / float(RAND_MAX), rand() / float(RAND_MAX), rand() / float(RAND_MAX), 1.0f});
+
+    GLCPPSharedContentParameters sharedParameters;
+    sharedParameters.variables =
+            {
+                    std::make_pair("THREADS_PER_GROUP_X", std::to_string(GetThreadsPerGroup().x))
+                    , std::make_pair("THREADS_PER_GROUP_Y", std::to_string(GetThreadsPerGroup().y))
+                    , std::make_pair("TILE_SIZE_X", std::to_string(screenWidth / threadGroupCount.x))
+                    , std::make_pair("TILE_SIZE_Y", std::to_string(screenHeight / threadGroupCount.y))
+                    , std::make_pair("TILE_COUNT_X", std::to_string(threadGroupCount.x))
+                    , std::make_pair("TILE_COUNT_Y", std::to_string(threadGroupCount.y))
+                    , std::make_pair("CLUSTER_SLICES", std::to_string(CLUSTER_SLICES))
+                    , std::make_pair("MAX_LIGHTS_PER_CLUSTER", std::to_string(MAX_LIGHTS_PER_CLUSTER))
+                    , std::make_pair("MAX_LIGHT_INDICES", std::to_string(MAX_LIGHT_INDICES))
+            };
+    sharedParameters.outPath = std::string(contentManager.GetRootDir()) + "/lightCullClustered";
+    sharedVariables = contentManager.Load<GLCPPShared>("lightCullClustered/shared.h", &sharedParameters);
+
+    ////////////////////////////////////////////////////////////
+    // Make sure every slice's list fits in shared memory
+
+    GLint maxSize;
+    glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSize);
+
+    if(CLUSTER_SLICES * (MAX_LIGHTS_PER_CLUSTER + 1) > maxSize / sizeof(int))
+    {
+        Logger::LogLine(LOG_TYPE::FATAL, "GPU only supports a maximum of ", maxSize / sizeof(int), " ints in shared memory");
+        return false;
+    }
+
+    ////////////////////////////////////////////////////////////
+    // Light culling
+
+    lightCullDrawBinds.AddUniform("viewMatrix", glm::mat4());
+    lightCullDrawBinds.AddUniform("projectionInverseMatrix", glm::mat4());
+    lightCullDrawBinds.AddShaders(contentManager, GLEnums::SHADER_TYPE::COMPUTE, "lightCullClustered/lightCull.comp");
+    if(!lightCullDrawBinds.Init())
+        return false;
+
+    // Light count + light indices
+    lightCullDrawBinds["LightIndices"] = std::vector<int>((unsigned long)(1 + MAX_LIGHT_INDICES), -1);
+    // start + numberOfLights + totalLights + padding
+    lightCullDrawBinds["ClusterLights"] = std::vector<glm::ivec4>((unsigned long)GetMaxNumberOfClusters(), glm::ivec4(0));
+    lightCullDrawBinds["ClusterDepth"] = glm::vec2(0.0f);
+    lightCullDrawBinds["ScreenSize"] = glm::ivec2(screenWidth, screenHeight);
+
+    gpuTimer.Init();
+
+    return true;
+}
+
+void LightCullClustered::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
+{
+    PreDraw(viewMatrix, projectionMatrixInverse);
+
+    Draw();
+
+    PostDraw();
+}
+
+GLuint64 LightCullClustered::TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
+{
+    PreDraw(viewMatrix, projectionMatrixInverse);
+
+    gpuTimer.Start(timedFrame);
+    Draw();
+    gpuTimer.Stop();
+
+    PostDraw();
+
+    return gpuTimer.GetTime();
+}
+
+void LightCullClustered::PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
+{
+    ////////////////////////////////////////////////////////////
+    // Light culling
+    int zero = 0;
+    lightCullDrawBinds.GetSSBO("LightIndices")->UpdateData(0, &zero, sizeof(int));
+
+    // NDC z 0 is the near plane and 1 is the far plane, see DepthReduction::ToViewDepth
+    lightCullDrawBinds["ClusterDepth"] = glm::vec2(ToViewDepth(0.0f, projectionMatrixInverse)
+                                                   , ToViewDepth(1.0f, projectionMatrixInverse));
+
+    lightCullDrawBinds["viewMatrix"] = viewMatrix;
+    lightCullDrawBinds["projectionInverseMatrix"] = projectionMatrixInverse;
+
+    lightCullDrawBinds.Bind();
+}
+
+void LightCullClustered::Draw()
+{
+    glDispatchCompute((GLuint)threadGroupCount.x, (GLuint)threadGroupCount.y, 1);
+}
+
+void LightCullClustered::PostDraw()
+{
+    lightCullDrawBinds.Unbind();
+}
+
+glm::uvec2 LightCullClustered::GetThreadsPerGroup() const
+{
+    return threadsPerGroup;
+}
+
+int LightCullClustered::GetMaxLightsPerCluster() const
+{
+    return MAX_LIGHTS_PER_CLUSTER;
+}
+
+void LightCullClustered::ResolutionChanged(int newWidth, int newHeight)
+{
+    this->screenWidth = newWidth;
+    this->screenHeight = newHeight;
+
+    lightCullDrawBinds["ScreenSize"] = glm::ivec2(newWidth, newHeight);
+}
+
+void LightCullClustered::SetDrawBindData(GLDrawBinds& binds)
+{
+    binds["Lights"] = lightCullDrawBinds["Lights"];
+    binds["LightIndices"] = lightCullDrawBinds["LightIndices"];
+    binds["ClusterLights"] = lightCullDrawBinds["ClusterLights"];
+    binds["ClusterDepth"] = lightCullDrawBinds["ClusterDepth"];
+    binds["ScreenSize"] = lightCullDrawBinds["ScreenSize"];
+    binds["ColorBuffer"] = colors;
+}
+
+int LightCullClustered::GetMaxNumberOfClusters() const
+{
+    return threadGroupCount.x * threadGroupCount.y * CLUSTER_SLICES;
+}
+
+void LightCullClustered::DrawLightCount(SpriteRenderer& spriteRenderer
+                                        , CharacterSet* characterSetSmall
+                                        , CharacterSet* characterSetBig)
+{
+
+}
+
+std::string LightCullClustered::GetForwardShaderPath()
+{
+    return "lightCullClustered/forward.frag";
+}
+
+std::string LightCullClustered::GetForwardShaderDebugPath()
+{
+    return "lightCullClustered/forwardDebug.frag";
+}
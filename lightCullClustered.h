@@ -0,0 +1,66 @@
+#ifndef LIGHTCULLCLUSTERED_H__
+#define LIGHTCULLCLUSTERED_H__
+
+#include "lightCull.h"
+#include "gl/glCPPShared.h"
+
+/**
+ * Splits every screen tile into exponentially spaced depth slices (clusters)
+ * and builds a compact cluster -> light index list.
+ *
+ * Each cluster only allocates as many indices as it has lights, so the
+ * LightIndices buffer is bounded by MAX_LIGHT_INDICES instead of
+ * tiles * MAX_LIGHTS_PER_TILE.
+ */
+class LightCullClustered
+        : public LightCull
+{
+public:
+    LightCullClustered();
+    ~LightCullClustered();
+
+    void InitShaderConstants(int screenWidth, int screenHeight) override;
+    bool Init(ContentManager& contentManager, Console& console) override;
+    void SetDrawBindData(GLDrawBinds& binds) override;
+
+    void Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) override;
+    GLuint64 TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse) override;
+
+    void DrawLightCount(SpriteRenderer& spriteRenderer
+                        , CharacterSet* characterSetSmall
+                        , CharacterSet* characterSetBig) override;
+
+    void ResolutionChanged(int newWidth, int newHeight) override;
+
+    glm::uvec2 GetThreadsPerGroup() const;
+
+    int GetMaxLightsPerCluster() const;
+    int GetMaxNumberOfClusters() const;
+
+    GLDrawBinds lightCullDrawBinds;
+
+    std::string GetForwardShaderPath() override;
+    std::string GetForwardShaderDebugPath() override;
+protected:
+private:
+    // 2^6 tiles per side, same as one of the tile depth levels
+    const static int MAX_DEPTH = 6;
+    const static int CLUSTER_SLICES = 32;
+    const static int MAX_LIGHTS_PER_CLUSTER = 128;
+    // Size of the compact light index list
+    const static int MAX_LIGHT_INDICES = 1 << 22;
+
+    const glm::uvec2 threadsPerGroup;
+
+    glm::ivec2 threadGroupCount;
+
+    void PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse);
+    void Draw();
+    void PostDraw();
+
+    std::vector<glm::vec4> colors;
+
+    GLCPPShared* sharedVariables;
+};
+
+#endif // LIGHTCULLCLUSTERED_H__
@@ -25,8 +25,9 @@ bool LightCullNormal::Init(ContentManager& contentManager, Console& console)
                     std::make_pair("THREADS_PER_GROUP_X", std::to_string(GetThreadsPerGroup().x))
                     , std::make_pair("THREADS_PER_GROUP_Y", std::to_string(GetThreadsPerGroup().y))
                     , std::make_pair("MAX_LIGHTS_PER_TILE", std::to_string(GetMaxLightsPerTile()))
-                    , std::make_pair("THREAD_GROUP_SIZE_X", std::to_string(screenWidth / threadGroupCount.x))
-                    , std::make_pair("THREAD_GROUP_SIZE_Y", std::to_string(screenHeight / threadGroupCount.y))
+                    // Rounded up like the tile depth, so every pixel has a tile
+                    , std::make_pair("THREAD_GROUP_SIZE_X", std::to_string((screenWidth + threadGroupCount.x - 1) / threadGroupCount.x))
+                    , std::make_pair("THREAD_GROUP_SIZE_Y", std::to_string((screenHeight + threadGroupCount.y - 1) / threadGroupCount.y))
                     , std::make_pair("THREAD_GROUP_COUNT_X", std::to_string(threadGroupCount.x))
                     , std::make_pair("THREAD_GROUP_COUNT_Y", std::to_string(threadGroupCount.y))
             };
@@ -62,7 +63,7 @@ bool LightCullNormal::Init(ContentManager& contentManager, Console& console)
                                                         , -1);
     lightCullDrawBinds["ScreenSize"] = glm::ivec2(screenWidth, screenHeight);
 
-    glGenQueries(1, &timeQuery);
+    gpuTimer.Init();
 
     return true;
 }
@@ -78,26 +79,15 @@ void LightCullNormal::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInver
 
 GLuint64 LightCullNormal::TimedDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
 {
-    GLuint64 lightCullTime;
-
     PreDraw(viewMatrix, projectionMatrixInverse);
 
-    glBeginQuery(GL_TIME_ELAPSED, timeQuery);
+    gpuTimer.Start(timedFrame);
     Draw();
-    glEndQuery(GL_TIME_ELAPSED);
-
-    GLint timeAvailable = 0;
-    while(!timeAvailable)
-    {
-        glGetQueryObjectiv(timeQuery,  GL_QUERY_RESULT_AVAILABLE, &timeAvailable);
-        std::this_thread::sleep_for(std::chrono::nanoseconds(500));
-    }
-
-    glGetQueryObjectui64v(timeQuery, GL_QUERY_RESULT, &lightCullTime);
+    gpuTimer.Stop();
 
     PostDraw();
 
-    return lightCullTime;
+    return gpuTimer.GetTime();
 }
 
 void LightCullNormal::PreDraw(glm::mat4 viewMatrix, glm::mat4 projectionMatrixInverse)
@@ -1,18 +1,129 @@
 #include "lightManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
 #include "console/commandGetSet.h"
 #include "console/commandCallMethod.h"
 #include "primitiveDrawer.h"
+#include "profiler.h"
+
+static_assert(sizeof(LightData) == sizeof(float) * 8, "UploadData expects LightData to be 8 tightly packed floats");
+
+void LightsBuffer::UploadData(void* location) const
+{
+    PackLights(UploadHeader(location), 0, GetCount());
+}
+
+LightData* LightsBuffer::UploadHeader(void* location) const
+{
+    char* locationChar = (char*)location;
+
+    std::memcpy(locationChar + sizeof(padding), &ambientStrength, sizeof(float));
+    return (LightData*)(locationChar + sizeof(padding) + sizeof(ambientStrength));
+}
+
+void LightsBuffer::PackLights(LightData* destination, int begin, int end) const
+{
+    float* lights = (float*)destination;
+
+    int i = begin;
+#if defined(__SSE__)
+    // Each transpose turns four lights' worth of one member per register into
+    // one light's position + strength (or color + lifetime) per register
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128 first0 = _mm_loadu_ps(&positionX[i]);
+        __m128 first1 = _mm_loadu_ps(&positionY[i]);
+        __m128 first2 = _mm_loadu_ps(&positionZ[i]);
+        __m128 first3 = _mm_loadu_ps(&strength[i]);
+        _MM_TRANSPOSE4_PS(first0, first1, first2, first3);
+
+        __m128 second0 = _mm_loadu_ps(&colorR[i]);
+        __m128 second1 = _mm_loadu_ps(&colorG[i]);
+        __m128 second2 = _mm_loadu_ps(&colorB[i]);
+        __m128 second3 = _mm_loadu_ps(&lifetime[i]);
+        _MM_TRANSPOSE4_PS(second0, second1, second2, second3);
+
+        // Written in order since the destination is usually write-combined
+        float* light = lights + i * 8;
+        _mm_storeu_ps(light + 0, first0);
+        _mm_storeu_ps(light + 4, second0);
+        _mm_storeu_ps(light + 8, first1);
+        _mm_storeu_ps(light + 12, second1);
+        _mm_storeu_ps(light + 16, first2);
+        _mm_storeu_ps(light + 20, second2);
+        _mm_storeu_ps(light + 24, first3);
+        _mm_storeu_ps(light + 28, second3);
+    }
+#endif // __SSE__
+
+    for(; i < end; ++i)
+        destination[i] = Get(i);
+}
+
+void LightsBuffer::Resize(int count)
+{
+    positionX.resize((unsigned long)count);
+    positionY.resize((unsigned long)count);
+    positionZ.resize((unsigned long)count);
+    strength.resize((unsigned long)count);
+    colorR.resize((unsigned long)count);
+    colorG.resize((unsigned long)count);
+    colorB.resize((unsigned long)count);
+    lifetime.resize((unsigned long)count);
+}
+
+LightData LightsBuffer::Get(int index) const
+{
+    LightData light;
+
+    light.position = glm::vec3(positionX[index], positionY[index], positionZ[index]);
+    light.strength = strength[index];
+    light.color = glm::vec3(colorR[index], colorG[index], colorB[index]);
+    light.lifetime = lifetime[index];
+
+    return light;
+}
+
+void LightsBuffer::Set(int index, const LightData& light)
+{
+    positionX[index] = light.position.x;
+    positionY[index] = light.position.y;
+    positionZ[index] = light.position.z;
+    strength[index] = light.strength;
+    colorR[index] = light.color.x;
+    colorG[index] = light.color.y;
+    colorB[index] = light.color.z;
+    lifetime[index] = light.lifetime;
+}
+
+std::vector<LightData> LightsBuffer::GetLights() const
+{
+    std::vector<LightData> lights((unsigned long)GetCount());
+    for(int i = 0; i < GetCount(); ++i)
+        lights[i] = Get(i);
+
+    return lights;
+}
 
 LightManager::LightManager()
         : lightCount(16)
           , lightClusters(1)
           , lightClusterRadius(1.0f)
+          , lightsStorage("Lights", 0, 0, 0)
           , lightPositionStrategy(RANDOM)
           , LIGHT_DEFAULT_AMBIENT(0.0f)
           , freezeLights(false)
           , drawLightSpheres(false)
+          , frameIndex(0)
 {
-    lightsBuffer.lights.reserve(lightCount);
+    workerPool.Init((int)std::max(std::thread::hardware_concurrency(), 1u));
 
     lightsBuffer.padding = glm::vec3(1.0f, 1.2f, 1.23f);
     lightsBuffer.ambientStrength = LIGHT_DEFAULT_AMBIENT;
@@ -20,23 +131,32 @@ LightManager::LightManager()
 
     for(int i = 0; i < lightClusters; ++i)
     {
-        float xPos = ((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * CLUSTER_MAX_X;
-        float yPos = ((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * (CLUSTER_MAX_Y - CLUSTER_MIN_Y) + CLUSTER_MIN_Y;
-        float zPos = ((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * CLUSTER_MAX_Z;
+        float xPos = (random.NextFloat() * 2.0f - 1.0f) * CLUSTER_MAX_X;
+        float yPos = (random.NextFloat() * 2.0f - 1.0f) * (CLUSTER_MAX_Y - CLUSTER_MIN_Y) + CLUSTER_MIN_Y;
+        float zPos = (random.NextFloat() * 2.0f - 1.0f) * CLUSTER_MAX_Z;
         clusterPositions.push_back(glm::vec3(xPos, yPos, zPos));
     }
 
+    lightsBuffer.Resize(lightCount);
     for(int i = 0; i < lightCount; ++i)
     {
-        lightsBuffer.lights.push_back(GetRandomLight());
+        LightData light = GetRandomLight(random);
         if(lightPositionStrategy == CLUSTERED)
-            lightsBuffer.lights[i].position += clusterPositions[i / (lightCount / lightClusters)];
+            light.position += clusterPositions[i / (lightCount / lightClusters)];
+
+        lightsBuffer.Set(i, light);
     }
 }
 
 LightManager::~LightManager()
 {}
 
+bool LightManager::Init()
+{
+    lightsStorage.Init(false);
+    return lightsStorage.InitPersistent(lightsBuffer.GetTotalSize());
+}
+
 void LightManager::AddConsoleCommands(Console& console)
 {
     console.AddCommand(new CommandGetSet<bool>("light_freeze", &freezeLights));
@@ -45,6 +165,20 @@ void LightManager::AddConsoleCommands(Console& console)
     console.AddCommand(new CommandGetSet<float>("light_maxStrength", &lightMaxStrength));
     console.AddCommand(new CommandGetSet<float>("light_lifetime", &lightLifetime));
 
+    console.AddCommand(new CommandCallMethod("light_threadCount"
+                                             , [&](const std::vector<Argument>& args)
+            {
+                if(args.size() == 0)
+                    return Argument("threadCount = " + std::to_string(workerPool.GetThreadCount()));
+                else if(args.size() != 1)
+                    return Argument("Needs 1 parameter");
+
+                workerPool.Init(std::max(std::stoi(args.front().value), 1));
+
+                return Argument("threadCount updated to " + std::to_string(workerPool.GetThreadCount()));
+            }
+    ));
+
     console.AddCommand(new CommandCallMethod("light_PositionStrategy"
                                              , [&](const std::vector<Argument>& args)
             {
@@ -93,22 +227,7 @@ void LightManager::AddConsoleCommands(Console& console)
                 else if(args.size() != 1)
                     return Argument("Needs 1 parameter");
 
-                int newCount = std::stoi(args.front().value);
-
-                if(newCount > lightCount)
-                {
-                    lightsBuffer.lights.reserve(newCount);
-                    for(int i = 0; i < newCount - lightCount; ++i)
-                        lightsBuffer.lights.push_back(GetRandomLight());
-                }
-                else
-                {
-                    lightsBuffer.lights.resize(newCount);
-                    for(int i = 0; i < newCount; ++i)
-                        lightsBuffer.lights[i] = GetRandomLight();
-                }
-
-                lightCount = newCount;
+                SetLightCount(std::stoi(args.front().value));
 
                 return Argument("lightCount updated to " + std::to_string(lightCount));
             }
@@ -122,7 +241,7 @@ void LightManager::AddConsoleCommands(Console& console)
 
                 float newStrength = std::stof(args.back().value);
 
-                lightsBuffer.lights[std::stoi(args.front().value)].strength = newStrength;
+                lightsBuffer.strength[std::stoi(args.front().value)] = newStrength;
 
                 Argument returnArgument;
                 newStrength >> returnArgument;
@@ -135,53 +254,170 @@ void LightManager::AddConsoleCommands(Console& console)
     console.AddCommand(new CommandGetSet<float>("light_ambientStrength", &lightsBuffer.ambientStrength));
 }
 
-void LightManager::Update(Timer& deltaTimer, PrimitiveDrawer& primitiveDrawer)
+void LightManager::Update(float deltaMilliseconds, PrimitiveDrawer& primitiveDrawer)
 {
-    if(freezeLights)
+    PROFILE_ZONE("LightManager::Update");
+
+    LightData* mappedLights = lightsBuffer.UploadHeader(lightsStorage.MapPersistent(lightsBuffer.GetTotalSize()));
+
+    respawnIndices.resize((unsigned long)workerPool.GetThreadCount());
+    sphereBatches.resize((unsigned long)workerPool.GetThreadCount());
+
+    int chunkCount = (lightCount + UPDATE_CHUNK_SIZE - 1) / UPDATE_CHUNK_SIZE;
+    workerPool.ParallelFor(chunkCount, [&](int chunk, int threadIndex)
     {
-        if(drawLightSpheres)
-            for(int i = 0; i < lightCount; ++i)
-                primitiveDrawer.DrawSphere(lightsBuffer.lights[i].position, lightsBuffer.lights[i].strength, lightsBuffer.lights[i].color);
+        UpdateChunk(chunk, threadIndex, deltaMilliseconds, mappedLights);
+    });
 
-        return;
-    }
+    if(!freezeLights)
+        ++frameIndex;
 
-    for(int i = 0; i < lightCount; ++i)
+    if(drawLightSpheres)
     {
-        lightsBuffer.lights[i].lifetime += deltaTimer.GetDeltaMillisecondsFraction();
+        for(PrimitiveDrawer::SphereBatch& batch : sphereBatches)
+        {
+            primitiveDrawer.DrawSpheres(batch);
+            batch.Clear();
+        }
+    }
+}
 
-        float newStrength;
-        if(lightsBuffer.lights[i].lifetime <= lightLifetime * 0.5f)
-            newStrength = (lightsBuffer.lights[i].lifetime / (lightLifetime * 0.5f)) * (lightMaxStrength - lightMinStrength) + lightMinStrength;
-        else
-            newStrength = ((lightLifetime * 0.5f - (lightsBuffer.lights[i].lifetime - lightLifetime * 0.5f)) / (lightLifetime * 0.5f)) * (lightMaxStrength - lightMinStrength) + lightMinStrength;
+void LightManager::UpdateChunk(int chunk, int threadIndex, float delta, LightData* mappedLights)
+{
+    PROFILE_ZONE("LightManager::UpdateChunk");
 
-        lightsBuffer.lights[i].strength = newStrength;
+    int begin = chunk * UPDATE_CHUNK_SIZE;
+    int end = std::min(begin + UPDATE_CHUNK_SIZE, lightCount);
 
-        if(lightsBuffer.lights[i].lifetime >= lightLifetime)
+    if(!freezeLights)
+    {
+        std::vector<int>& chunkRespawnIndices = respawnIndices[threadIndex];
+        UpdateLights(begin, end, delta, chunkRespawnIndices);
+
+        if(!chunkRespawnIndices.empty())
         {
-            lightsBuffer.lights[i] = GetNewLight();
+            FastRandom chunkRandom(((uint64_t)frameIndex << 32) + (uint64_t)chunk);
+
+            for(int index : chunkRespawnIndices)
+            {
+                LightData light = GetNewLight(chunkRandom);
+                if(lightPositionStrategy == CLUSTERED)
+                    light.position += clusterPositions[index / (lightCount / lightClusters)];
+
+                lightsBuffer.Set(index, light);
+            }
+        }
+    }
+
+    lightsBuffer.PackLights(mappedLights, begin, end);
+
+    if(drawLightSpheres)
+    {
+        PrimitiveDrawer::SphereBatch& batch = sphereBatches[threadIndex];
+
+        for(int i = begin; i < end; ++i)
+            batch.DrawSphere(glm::vec3(lightsBuffer.positionX[i], lightsBuffer.positionY[i], lightsBuffer.positionZ[i])
+                             , lightsBuffer.strength[i]
+                             , glm::vec3(lightsBuffer.colorR[i], lightsBuffer.colorG[i], lightsBuffer.colorB[i]));
+    }
+}
 
-            if(lightPositionStrategy == CLUSTERED)
-                lightsBuffer.lights[i].position += clusterPositions[i / (lightCount / lightClusters)];
+void LightManager::UpdateLights(int begin, int end, float delta, std::vector<int>& respawnIndices)
+{
+    respawnIndices.clear();
+
+    if(begin >= end)
+        return;
+
+    float* lifetime = &lightsBuffer.lifetime[0];
+    float* strength = &lightsBuffer.strength[0];
+
+    // Same triangle wave as GetLightRadius, without the branch:
+    // strength = (1 - |lifetime - halfLifetime| / halfLifetime) * range + min
+    const float halfLifetime = lightLifetime * 0.5f;
+    const float halfLifetimeInverse = 1.0f / halfLifetime;
+    const float strengthRange = lightMaxStrength - lightMinStrength;
+
+    int i = begin;
+#if defined(__SSE__)
+    const __m128 delta4 = _mm_set1_ps(delta);
+    const __m128 one4 = _mm_set1_ps(1.0f);
+    const __m128 absMask4 = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 lifetimeMax4 = _mm_set1_ps(lightLifetime);
+    const __m128 halfLifetime4 = _mm_set1_ps(halfLifetime);
+    const __m128 halfLifetimeInverse4 = _mm_set1_ps(halfLifetimeInverse);
+    const __m128 strengthRange4 = _mm_set1_ps(strengthRange);
+    const __m128 strengthMin4 = _mm_set1_ps(lightMinStrength);
+
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128 lightLifetime4 = _mm_add_ps(_mm_loadu_ps(&lifetime[i]), delta4);
+        _mm_storeu_ps(&lifetime[i], lightLifetime4);
+
+        __m128 distance = _mm_and_ps(_mm_sub_ps(lightLifetime4, halfLifetime4), absMask4);
+        __m128 wave = _mm_sub_ps(one4, _mm_mul_ps(distance, halfLifetimeInverse4));
+        _mm_storeu_ps(&strength[i], _mm_add_ps(_mm_mul_ps(wave, strengthRange4), strengthMin4));
+
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(lightLifetime4, lifetimeMax4));
+        while(mask != 0)
+        {
+            respawnIndices.push_back(i + __builtin_ctz((unsigned int)mask));
+            mask &= mask - 1;
         }
+    }
+#endif // __SSE__
+
+    // Remaining lights, or all of them if there's no SIMD support
+    for(; i < end; ++i)
+    {
+        lifetime[i] += delta;
+        strength[i] = (1.0f - std::abs(lifetime[i] - halfLifetime) * halfLifetimeInverse) * strengthRange + lightMinStrength;
 
-        if(drawLightSpheres)
-            primitiveDrawer.DrawSphere(lightsBuffer.lights[i].position, lightsBuffer.lights[i].strength, lightsBuffer.lights[i].color);
+        if(lifetime[i] >= lightLifetime)
+            respawnIndices.push_back(i);
     }
 }
 
+void LightManager::SetLightCount(int newCount)
+{
+    lightsBuffer.Resize(newCount);
+
+    if(newCount > lightCount)
+    {
+        for(int i = lightCount; i < newCount; ++i)
+            lightsBuffer.Set(i, GetRandomLight(random));
+    }
+    else
+    {
+        for(int i = 0; i < newCount; ++i)
+            lightsBuffer.Set(i, GetRandomLight(random));
+    }
+
+    lightCount = newCount;
+}
+
+void LightManager::Reseed(uint64_t seed)
+{
+    random.Seed(seed);
+    frameIndex = 0;
+}
+
 LightsBuffer& LightManager::GetLightsBuffer()
 {
     return lightsBuffer;
 }
 
-LightData LightManager::GetNewLight()
+void LightManager::SetDrawBindData(GLDrawBinds& binds)
+{
+    binds["Lights"] = GLVariable(&binds, &lightsStorage);
+}
+
+LightData LightManager::GetNewLight(FastRandom& random)
 {
     LightData light;
 
-    light.position = GetRandomLightPosition();
-    light.color = glm::vec3(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
+    light.position = GetRandomLightPosition(random);
+    light.color = glm::vec3(random.NextFloat(), random.NextFloat(), random.NextFloat());
     //light.color = glm::vec3(1.0f, 204.0f / 255.0f, 0.0f);
     light.lifetime = 0.0f;
     light.strength = GetLightRadius(0.0f);
@@ -189,28 +425,28 @@ LightData LightManager::GetNewLight()
     return light;
 }
 
-LightData LightManager::GetRandomLight()
+LightData LightManager::GetRandomLight(FastRandom& random)
 {
     LightData light;
 
-    light.position = GetRandomLightPosition();
-    light.color = glm::vec3(rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
-    light.lifetime = rand() / (float)RAND_MAX * lightLifetime;
+    light.position = GetRandomLightPosition(random);
+    light.color = glm::vec3(random.NextFloat(), random.NextFloat(), random.NextFloat());
+    light.lifetime = random.NextFloat() * lightLifetime;
     light.strength = GetLightRadius(light.lifetime);
 
     return light;
 }
 
-glm::vec3 LightManager::GetRandomLightPosition()
+glm::vec3 LightManager::GetRandomLightPosition(FastRandom& random)
 {
     glm::vec3 returnPosition;
 
     switch(lightPositionStrategy)
     {
         case RANDOM:
-            returnPosition.x = ((rand() / (float)RAND_MAX) - 0.5f) * 2.0f * LIGHT_RANGE_X;
-            returnPosition.y = (rand() / (float)RAND_MAX) * LIGHT_MAX_Y + 0.5f;
-            returnPosition.z = ((rand() / (float)RAND_MAX) - 0.5f) * 2.0f * LIGHT_RANGE_Z;
+            returnPosition.x = (random.NextFloat() - 0.5f) * 2.0f * LIGHT_RANGE_X;
+            returnPosition.y = random.NextFloat() * LIGHT_MAX_Y + 0.5f;
+            returnPosition.z = (random.NextFloat() - 0.5f) * 2.0f * LIGHT_RANGE_Z;
             break;
         case CLUSTERED:
         {
@@ -219,9 +455,9 @@ glm::vec3 LightManager::GetRandomLightPosition()
 
             while(distanceSq > maxDistSQ)
             {
-                returnPosition.x = ((rand() / (float)RAND_MAX) - 0.5f) * 2.0f * lightClusterRadius;
-                returnPosition.y = ((rand() / (float)RAND_MAX) - 0.5f) * 2.0f * lightClusterRadius;
-                returnPosition.z = ((rand() / (float)RAND_MAX) - 0.5f) * 2.0f * lightClusterRadius;
+                returnPosition.x = (random.NextFloat() - 0.5f) * 2.0f * lightClusterRadius;
+                returnPosition.y = (random.NextFloat() - 0.5f) * 2.0f * lightClusterRadius;
+                returnPosition.z = (random.NextFloat() - 0.5f) * 2.0f * lightClusterRadius;
 
                 distanceSq = glm::dot(returnPosition, returnPosition);
             }
@@ -4,7 +4,10 @@
 #include <cstring>
 #include "console/console.h"
 #include "gl/glDynamicBuffer.h"
+#include "gl/glDrawBinds.h"
 #include "primitiveDrawer.h"
+#include "fastRandom.h"
+#include "workerPool.h"
 
 struct LightData
 {
@@ -14,26 +17,57 @@ struct LightData
     float lifetime;
 };
 
+/**
+* Lights stored as one array per member so Update can animate them with SIMD.
+* They are packed into LightData (the GPU layout) by UploadData
+*/
 class LightsBuffer
         : public GLDynamicBuffer
 {
 public:
     size_t GetTotalSize() const override
     {
-        return sizeof(glm::vec3) + sizeof(float) + sizeof(LightData) * lights.size();
+        return sizeof(glm::vec3) + sizeof(float) + sizeof(LightData) * GetCount();
     }
 
-    void UploadData(void* location) const override
-    {
-        char* locationChar = (char*)location;
+    void UploadData(void* location) const override;
+
+    /**
+    * Writes everything but the lights
+    *
+    * \returns where the lights should be packed
+    */
+    LightData* UploadHeader(void* location) const;
+    /**
+    * Packs lights [begin, end) into destination[begin, end)
+    */
+    void PackLights(LightData* destination, int begin, int end) const;
 
-        std::memcpy(locationChar + sizeof(padding), &ambientStrength, sizeof(float));
-        std::memcpy(locationChar + sizeof(padding) + sizeof(ambientStrength), &lights[0], sizeof(LightData) * lights.size());
+    int GetCount() const
+    {
+        return (int)lifetime.size();
     }
 
+    void Resize(int count);
+    LightData Get(int index) const;
+    void Set(int index, const LightData& light);
+
+    /**
+    * Packs every light into a new vector, for code that wants LightData
+    */
+    std::vector<LightData> GetLights() const;
+
     glm::vec3 padding;
     float ambientStrength;
-    std::vector<LightData> lights;
+
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> strength;
+    std::vector<float> colorR;
+    std::vector<float> colorG;
+    std::vector<float> colorB;
+    std::vector<float> lifetime;
 };
 
 class LightManager
@@ -42,11 +76,24 @@ public:
     LightManager();
     ~LightManager();
 
+    bool Init();
     void AddConsoleCommands(Console& console);
 
-    void Update(Timer& deltaTimer, PrimitiveDrawer& primitiveDrawer);
+    /**
+    * Animates every light
+    *
+    * \param deltaMilliseconds time to step the simulation, pass a fixed value to get reproducible light positions
+    */
+    void Update(float deltaMilliseconds, PrimitiveDrawer& primitiveDrawer);
+
+    void SetLightCount(int newCount);
+    /**
+    * Restarts every random sequence, call SetLightCount afterwards to get a reproducible set of lights
+    */
+    void Reseed(uint64_t seed);
 
     LightsBuffer& GetLightsBuffer();
+    void SetDrawBindData(GLDrawBinds& binds);
 protected:
 private:
     enum LIGHT_POSITION_STRATEGY
@@ -61,6 +108,8 @@ private:
     float lightClusterRadius;
 
     LightsBuffer lightsBuffer;
+    // Persistently mapped and triple buffered, Update writes straight into it
+    GLShaderStorageBuffer lightsStorage;
 
     LIGHT_POSITION_STRATEGY lightPositionStrategy;
     std::vector<glm::vec3> clusterPositions;
@@ -99,9 +148,31 @@ private:
     const float LIGHT_RANGE_Z = 6.0f;
 #endif
 
-    LightData GetNewLight();
-    LightData GetRandomLight();
-    glm::vec3 GetRandomLightPosition();
+    // Lights are updated in chunks of this many lights. Each chunk respawns
+    // lights with a seed from the frame and chunk index, so the result is the
+    // same no matter how many threads there are
+    const static int UPDATE_CHUNK_SIZE = 8192;
+
+    WorkerPool workerPool;
+    unsigned long frameIndex;
+
+    // Replaces rand() outside of Update, only used from the main thread
+    FastRandom random;
+
+    // One per thread
+    std::vector<std::vector<int>> respawnIndices;
+    std::vector<PrimitiveDrawer::SphereBatch> sphereBatches;
+
+    void UpdateChunk(int chunk, int threadIndex, float delta, LightData* mappedLights);
+    /**
+    * Advances lifetime and strength of lights [begin, end) and appends every
+    * light that died to respawnIndices
+    */
+    void UpdateLights(int begin, int end, float delta, std::vector<int>& respawnIndices);
+
+    LightData GetNewLight(FastRandom& random);
+    LightData GetRandomLight(FastRandom& random);
+    glm::vec3 GetRandomLightPosition(FastRandom& random);
     float GetLightRadius(float lifetime);
 };
 
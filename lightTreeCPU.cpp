@@ -0,0 +1,164 @@
+#include "lightTreeCPU.h"
+
+#include <numeric>
+
+#include "depthReduction.h"
+#include "tileCulling.h"
+
+LightTreeCPU::LightTreeCPU(int maxLightsPerTile)
+        : startDepth(0)
+          , maxDepth(0)
+          , maxLightsPerTile(maxLightsPerTile)
+{}
+
+LightTreeCPU::~LightTreeCPU()
+{}
+
+void LightTreeCPU::Build(const std::vector<LightData>& lights
+                         , glm::mat4 viewMatrix
+                         , glm::mat4 projectionMatrixInverse
+                         , glm::ivec2 screenSize
+                         , int startDepth
+                         , int maxDepth
+                         , const std::vector<glm::vec2>* tileDepth)
+{
+    this->startDepth = startDepth;
+    this->maxDepth = maxDepth;
+
+    ////////////////////////////////////////////////////////////
+    // Transform lights once
+    viewX.resize(lights.size());
+    viewY.resize(lights.size());
+    viewZ.resize(lights.size());
+    viewRadius.resize(lights.size());
+
+    for(size_t i = 0; i < lights.size(); ++i)
+    {
+        glm::vec3 viewPosition = glm::vec3(viewMatrix * glm::vec4(lights[i].position, 1.0f));
+
+        viewX[i] = viewPosition.x;
+        viewY[i] = viewPosition.y;
+        viewZ[i] = viewPosition.z;
+        viewRadius[i] = lights[i].strength;
+    }
+
+    allLights.resize(lights.size());
+    std::iota(allLights.begin(), allLights.end(), 0);
+
+    ////////////////////////////////////////////////////////////
+    // Levels
+    levels.clear();
+    levels.resize((unsigned long)(maxDepth + 1));
+
+    for(int depth = startDepth; depth <= maxDepth; ++depth)
+    {
+        int tileCount = (1 << depth) * (1 << depth);
+
+        levels[depth].lightCount.assign((unsigned long)tileCount, -1);
+        levels[depth].lights.resize((unsigned long)tileCount);
+    }
+
+    // Same as lightCull.comp
+    for(int y = 0; y < (1 << startDepth); ++y)
+        for(int x = 0; x < (1 << startDepth); ++x)
+            CullTile(x, y, startDepth, allLights, projectionMatrixInverse, screenSize, tileDepth);
+
+    // Same as lightCompaction.comp and lightReduction.comp
+    for(int depth = startDepth + 1; depth <= maxDepth; ++depth)
+    {
+        for(int y = 0; y < (1 << depth); ++y)
+        {
+            for(int x = 0; x < (1 << depth); ++x)
+            {
+                int parentLightCount = GetLightCount(x / 2, y / 2, depth - 1);
+                if(parentLightCount <= 0)
+                    continue;
+
+                // The parent's list is incomplete if it overflowed
+                const std::vector<int>& candidates = parentLightCount > maxLightsPerTile ? allLights : GetLights(x / 2, y / 2, depth - 1);
+
+                CullTile(x, y, depth, candidates, projectionMatrixInverse, screenSize, tileDepth);
+            }
+        }
+    }
+}
+
+void LightTreeCPU::CullTile(int x
+                            , int y
+                            , int depth
+                            , const std::vector<int>& candidates
+                            , glm::mat4 projectionMatrixInverse
+                            , glm::ivec2 screenSize
+                            , const std::vector<glm::vec2>* tileDepth)
+{
+    // Integer division, same as the shaders
+    glm::vec2 tileSize(screenSize.x / (1 << depth), screenSize.y / (1 << depth));
+    TileCulling::TileFrustum frustum = TileCulling::CreateTileFrustum(glm::ivec2(x, y)
+                                                                      , tileSize
+                                                                      , glm::vec2(screenSize)
+                                                                      , projectionMatrixInverse);
+
+    glm::vec2 depthBounds = TileCulling::GetUnboundedDepth();
+    if(tileDepth != nullptr)
+        depthBounds = (*tileDepth)[DepthReduction::GetTileIndex(x, y, depth)];
+
+    int index = y * (1 << depth) + x;
+    int& lightCount = levels[depth].lightCount[index];
+    std::vector<int>& tileLights = levels[depth].lights[index];
+
+    lightCount = 0;
+    tileLights.clear();
+
+    for(int lightIndex : candidates)
+    {
+        if(!TileCulling::LightInsideTile(viewX[lightIndex]
+                                         , viewY[lightIndex]
+                                         , viewZ[lightIndex]
+                                         , viewRadius[lightIndex]
+                                         , frustum
+                                         , depthBounds))
+            continue;
+
+        if(lightCount < maxLightsPerTile)
+            tileLights.push_back(lightIndex);
+
+        ++lightCount;
+    }
+}
+
+int LightTreeCPU::GetLightCount(int x, int y, int depth) const
+{
+    if(depth < startDepth || depth > maxDepth)
+        return -1;
+
+    return levels[depth].lightCount[y * (1 << depth) + x];
+}
+
+const std::vector<int>& LightTreeCPU::GetLights(int x, int y, int depth) const
+{
+    return levels[depth].lights[y * (1 << depth) + x];
+}
+
+bool LightTreeCPU::IsLeaf(int x, int y, int depth) const
+{
+    if(GetLightCount(x, y, depth) < 0)
+        return false;
+
+    // All children are created at once
+    return depth == maxDepth || GetLightCount(x * 2, y * 2, depth + 1) < 0;
+}
+
+int LightTreeCPU::GetStartDepth() const
+{
+    return startDepth;
+}
+
+int LightTreeCPU::GetMaxDepth() const
+{
+    return maxDepth;
+}
+
+int LightTreeCPU::GetMaxLightsPerTile() const
+{
+    return maxLightsPerTile;
+}
@@ -0,0 +1,78 @@
+#ifndef LIGHTTREECPU_H__
+#define LIGHTTREECPU_H__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lightManager.h"
+
+/**
+ * CPU reference of LightCullAdaptive's tree refinement.
+ *
+ * Builds the tree the same way as lightCull.comp, lightCompaction.comp, and
+ * lightReduction.comp: every tile at the start depth tests all lights, tiles
+ * without lights aren't refined, and every child only tests its parent's
+ * lights unless the parent overflowed. Doesn't use any GL calls
+ */
+class LightTreeCPU
+{
+public:
+    LightTreeCPU(int maxLightsPerTile);
+    ~LightTreeCPU();
+
+    /**
+     * \param tileDepth tile depth pyramid as given by DepthReduction, or nullptr to skip depth bounds
+     */
+    void Build(const std::vector<LightData>& lights
+               , glm::mat4 viewMatrix
+               , glm::mat4 projectionMatrixInverse
+               , glm::ivec2 screenSize
+               , int startDepth
+               , int maxDepth
+               , const std::vector<glm::vec2>* tileDepth = nullptr);
+
+    // Number of lights inside the tile, or -1 if the tile wasn't created
+    int GetLightCount(int x, int y, int depth) const;
+    // The first (at most) maxLightsPerTile lights inside the tile, in ascending order
+    const std::vector<int>& GetLights(int x, int y, int depth) const;
+    // Whether or not the tile exists and none of its children do
+    bool IsLeaf(int x, int y, int depth) const;
+
+    int GetStartDepth() const;
+    int GetMaxDepth() const;
+    int GetMaxLightsPerTile() const;
+protected:
+private:
+    struct Level
+    {
+        std::vector<int> lightCount;
+        std::vector<std::vector<int>> lights;
+    };
+
+    // Indexed by depth, levels before startDepth are empty
+    std::vector<Level> levels;
+
+    int startDepth;
+    int maxDepth;
+    const int maxLightsPerTile;
+
+    // View space light positions and radii
+    std::vector<float> viewX;
+    std::vector<float> viewY;
+    std::vector<float> viewZ;
+    std::vector<float> viewRadius;
+
+    // 0, 1, ..., lightCount - 1. Candidates for tiles without a (complete) parent list
+    std::vector<int> allLights;
+
+    void CullTile(int x
+                  , int y
+                  , int depth
+                  , const std::vector<int>& candidates
+                  , glm::mat4 projectionMatrixInverse
+                  , glm::ivec2 screenSize
+                  , const std::vector<glm::vec2>* tileDepth);
+};
+
+#endif // LIGHTTREECPU_H__
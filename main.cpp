@@ -4,9 +4,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <X11/Xlib.h>
 #include <random>
+#include <sstream>
+#include <cctype>
 
 #include "os/window.h"
 #include "timer.h"
+#include "gpuTimer.h"
 #include "logger.h"
 #include "os/input.h"
 #include "perspectiveCamera.h"
@@ -28,7 +31,13 @@
 #include "gl/glCPPShared.h"
 #include "lightCullAdaptive.h"
 #include "lightCullNormal.h"
+#include "lightCullCPU.h"
+#include "lightCullClustered.h"
+#include "depthReduction.h"
 #include "lightManager.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "gpuProfiler.h"
 
 #include <glm/gtx/component_wise.hpp>
 #include <IL/il.h>
@@ -41,6 +50,16 @@ public:
     ~Main()
     { }
 
+    /**
+    * Renders frameCount frames offscreen without X11 and then exits
+    */
+    void SetHeadless(int frameCount);
+    /**
+    * Runs the default benchmark with the camera path in pathFile as soon as
+    * everything is loaded, writes the results and exits
+    */
+    void SetBenchmark(const std::string& pathFile, const std::string& outputPath);
+
     int Run();
 protected:
 private:
@@ -53,8 +72,12 @@ private:
 
     LightCullNormal lightCullNormal;
     LightCullAdaptive lightCullAdaptive;
+    LightCullCPU lightCullCPU;
+    LightCullClustered lightCullClustered;
     LightCull* currentLightCull;
 
+    DepthReduction depthReduction;
+
     OSWindow window;
 
     std::set<KEY_CODE> keysDown;
@@ -96,18 +119,33 @@ private:
 
     float cameraSpeed;
 
-    GLuint queries[2];
+    GPUTimer opaqueTimer;
 
     int msaaCount;
 
     bool recompileShaders;
 
     bool drawLightCount;
+    bool drawProfiler;
     bool dumpPreBackBuffer;
     bool dumpPostBackBuffer;
 
     LightManager lightManager;
 
+    bool headless;
+    int headlessFrameCount;
+
+    Benchmark benchmark;
+    std::string benchmarkPathFile;
+    std::string benchmarkOutputPath;
+
+    const static int BENCHMARK_SEED = 1337;
+    // Lights step by this much per frame during benchmarks so their positions don't depend on frame times
+    constexpr static float BENCHMARK_TIMESTEP = 1000.0f / 60.0f;
+
+    // Milliseconds per frame spent finishing content from ContentManager::LoadAsync
+    constexpr static float ASYNC_LOAD_BUDGET = 2.0f;
+
     int InitContent();
     void InitConsole();
     void InitInput();
@@ -115,6 +153,9 @@ private:
     void InitQuieries();
     bool InitShaders();
 
+    bool SetCullMode(const std::string& mode);
+    bool StartBenchmark(const std::string& outputPath, const std::vector<int>& lightCounts);
+
     void Update(Timer& deltaTimer);
     void Render(Timer& deltaTimer);
     bool ResizeFramebuffer(int width, int height, bool recreateBuffers);
@@ -125,6 +166,30 @@ private:
 int main(int argc, char* argv[])
 {
     Main main;
+
+    // --headless [frameCount] --benchmark cameraPath [outputPath]
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::string(argv[i]) == "--headless")
+        {
+            // The frame count is optional, don't swallow a following flag
+            int frameCount = 1000;
+            if(i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0]))
+                frameCount = std::atoi(argv[++i]);
+
+            main.SetHeadless(frameCount);
+        }
+        else if(std::string(argv[i]) == "--benchmark" && i + 1 < argc)
+        {
+            std::string pathFile = argv[++i];
+            std::string outputPath = "benchmark";
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+                outputPath = argv[++i];
+
+            main.SetBenchmark(pathFile, outputPath);
+        }
+    }
+
     return main.Run();
 }
 
@@ -140,10 +205,25 @@ Main::Main()
           , recompileShaders(false)
           , cameraSpeed(0.01f)
           , drawLightCount(false)
+          , drawProfiler(false)
           , dumpPreBackBuffer(false)
           , dumpPostBackBuffer(false)
+          , headless(false)
+          , headlessFrameCount(0)
 { }
 
+void Main::SetHeadless(int frameCount)
+{
+    headless = true;
+    headlessFrameCount = frameCount;
+}
+
+void Main::SetBenchmark(const std::string& pathFile, const std::string& outputPath)
+{
+    benchmarkPathFile = pathFile;
+    benchmarkOutputPath = outputPath;
+}
+
 float currentFrameTime = 0.0f;
 
 int Main::Run()
@@ -154,7 +234,13 @@ int Main::Run()
 
     // TODO: Fix rename of index to blockIndex, e.g. "Used for index rounding" -> "Used for blockIndex rounding"
 
-    if(window.Create((unsigned int)screenWidth, (unsigned int)screenHeight) == OSWindow::NONE)
+    OSWindow::CREATE_WINDOW_ERROR windowError;
+    if(headless)
+        windowError = window.CreateHeadless((unsigned int)screenWidth, (unsigned int)screenHeight);
+    else
+        windowError = window.Create((unsigned int)screenWidth, (unsigned int)screenHeight);
+
+    if(windowError == OSWindow::NONE)
     {
         if(!InitShaders())
             return 3;
@@ -189,6 +275,13 @@ int Main::Run()
         InitQuieries();
         console.Autoexec();
 
+        if(!benchmarkPathFile.empty())
+        {
+            if(!benchmark.LoadPath(benchmarkPathFile)
+               || !StartBenchmark(benchmarkOutputPath, { 1000, 12000, 100000 }))
+                return 4;
+        }
+
         double frameTime = 0.0;
         unsigned long frameCount = 0;
 
@@ -199,10 +292,15 @@ int Main::Run()
 
         Logger::ClearLog();
 
+        int renderedFrames = 0;
+
         Timer deltaTimer;
         deltaTimer.ResetDelta();
         while(window.PollEvents())
         {
+            if(headless && benchmarkPathFile.empty() && renderedFrames >= headlessFrameCount)
+                break;
+
             Timer frameCapTimer;
             frameCapTimer.Start();
 
@@ -238,6 +336,29 @@ int Main::Run()
 
             Update(deltaTimer);
             Render(deltaTimer);
+            ++renderedFrames;
+
+            Profiler::EndFrame();
+
+            if(benchmark.IsRunning())
+            {
+                // The next run may use another light cull, so the last frame waits for every GPU time of this one
+                if(benchmark.IsLastFrameOfRun())
+                {
+                    currentLightCull->FinishTimes();
+                    opaqueTimer.Finish();
+                }
+
+                for(const GPUTimer::Result& result : currentLightCull->TakeTimes())
+                    benchmark.SetLightCullTime(result.frame, result.time);
+                for(const GPUTimer::Result& result : opaqueTimer.TakeResults())
+                    benchmark.SetOpaqueTime(result.frame, result.time);
+
+                benchmark.EndFrame(currentFrameTime);
+
+                if(!benchmarkPathFile.empty() && !benchmark.IsRunning())
+                    break;
+            }
 
             frameCapTimer.Stop();
             auto time = frameCapTimer.GetTimeNanoseconds();
@@ -269,11 +390,31 @@ int Main::InitContent()
 
     OBJModelParameters parameters;
     parameters.shaderPath = currentLightCull->GetForwardShaderPath();
-    worldModel = contentManager.Load<OBJModel>("models/sponza.obj", &parameters);
+    ContentHandle<OBJModel> worldModelHandle = contentManager.LoadAsync<OBJModel>("models/sponza.obj", &parameters);
+
+    // Nothing can be drawn without the model, but its textures keep loading in the background
+    while(!worldModelHandle.IsReady())
+    {
+        contentManager.FinishAsyncLoads(ASYNC_LOAD_BUDGET);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    worldModel = worldModelHandle.Get();
     if(worldModel == nullptr)
         return 3;
 
+    // Benchmarks and headless captures shouldn't see placeholder textures
+    if(headless || !benchmarkPathFile.empty())
+    {
+        while(contentManager.HasPendingAsyncLoads())
+        {
+            contentManager.FinishAsyncLoads(ASYNC_LOAD_BUDGET);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
     currentLightCull->SetDrawBindData(worldModel->drawBinds);
+    lightManager.SetDrawBindData(worldModel->drawBinds);
 
     return 0;
 }
@@ -291,63 +432,156 @@ void Main::InitConsole()
     console.AddCommand(new CommandGetSet<bool>("wireframe", &wireframe));
     console.AddCommand(new CommandGetSet<bool>("light_drawCount", &drawLightCount));
     console.AddCommand(new CommandGetSet<float>("cameraSpeed", &cameraSpeed));
+    console.AddCommand(new CommandGetSet<bool>("profiler_draw", &drawProfiler));
 
-    console.AddCommand(new CommandCallMethod("light_SetCullMode"
+    Profiler::AddConsoleCommands(console);
+
+    console.AddCommand(new CommandCallMethod("benchmark_record"
                                              , [&](const std::vector<Argument>& args)
             {
-                if(args.size() != 1)
-                    return Argument("Expected 1 argument");
+                if(!benchmark.IsRecording())
+                {
+                    benchmark.StartRecording();
+                    return Argument("Recording camera path, call benchmark_record again to stop");
+                }
 
-                std::string arg = args.front().value;
+                benchmark.StopRecording();
 
-                bool validArg = true;
-                bool debug = false;
+                std::string path = args.empty() ? "cameraPath.txt" : args.front().value;
+                if(!benchmark.SavePath(path))
+                    return Argument("Couldn't save camera path to " + path);
 
-                if(arg == "normal")
-                {
-                    currentLightCull = &lightCullNormal;
-                }
-                else if(arg == "adaptive")
-                {
-                    currentLightCull = &lightCullAdaptive;
-                }
-                else if(arg == "normalDebug")
-                {
-                    currentLightCull = &lightCullNormal;
-                    debug = true;
-                }
-                else if(arg == "adaptiveDebug")
+                return Argument("Camera path saved to " + path);
+            }
+                                             , FORCE_STRING_ARGUMENTS::PER_ARGUMENT
+    ));
+
+    // benchmark_run cameraPath [outputPath] [lightCount...]
+    console.AddCommand(new CommandCallMethod("benchmark_run"
+                                             , [&](const std::vector<Argument>& args)
+            {
+                if(args.empty())
+                    return Argument("Expected a camera path");
+
+                if(contentManager.HasPendingAsyncLoads())
+                    return Argument("Content is still loading");
+
+                if(!benchmark.LoadPath(args[0].value))
+                    return Argument("Couldn't load camera path " + args[0].value);
+
+                std::string outputPath = args.size() > 1 ? args[1].value : "benchmark";
+
+                std::vector<int> lightCounts;
+                for(int i = 2; i < (int)args.size(); ++i)
                 {
-                    currentLightCull = &lightCullAdaptive;
-                    debug = true;
+                    if(!std::isdigit((unsigned char)args[i].value[0]))
+                        return Argument("Light counts have to be positive numbers");
+
+                    lightCounts.push_back(std::atoi(args[i].value.c_str()));
                 }
-                else
-                    validArg = false;
 
-                if(validArg)
-                {
-                    std::string shaderPath;
+                if(lightCounts.empty())
+                    lightCounts = { 1000, 12000, 100000 };
 
-                    if(debug)
-                        shaderPath = currentLightCull->GetForwardShaderDebugPath();
-                    else
-                        shaderPath = currentLightCull->GetForwardShaderPath();
+                if(!StartBenchmark(outputPath, lightCounts))
+                    return Argument("Couldn't start benchmark");
 
-                    if(!worldModel->drawBinds.ChangeShader(contentManager, GLEnums::SHADER_TYPE::FRAGMENT, shaderPath))
-                        throw "Oh no";
+                return Argument("Benchmark started");
+            }
+                                             , FORCE_STRING_ARGUMENTS::PER_ARGUMENT
+    ));
+
+    console.AddCommand(new CommandCallMethod("light_SetCullMode"
+                                             , [&](const std::vector<Argument>& args)
+            {
+                if(args.size() != 1)
+                    return Argument("Expected 1 argument");
 
-                    currentLightCull->SetDrawBindData(worldModel->drawBinds);
+                if(SetCullMode(args.front().value))
                     return Argument("Lighting cull mode updated");
-                }
                 else
                     return Argument("Invalid argument");
             }
                                              , FORCE_STRING_ARGUMENTS::PER_ARGUMENT
                                              , AUTOCOMPLETE_TYPE::ONLY_CUSTOM
-                                             , "normal", "adaptive", "normalDebug", "adaptiveDebug"
+                                             , "normal", "adaptive", "cpu", "clustered", "normalDebug", "adaptiveDebug", "cpuDebug", "clusteredDebug"
+    ));
+
+
+
+    console.AddCommand(new CommandCallMethod("lightAdaptive_validate", [&](const std::vector<Argument>& args)
+            {
+                // Compares against the last frame, so lights and camera should be still
+                std::vector<glm::vec2> tileDepth;
+                depthReduction.GetTileDepth(tileDepth);
+
+                LightTreeCPU reference(lightCullAdaptive.GetMaxLightsPerTile());
+                int mismatches = lightCullAdaptive.Validate(reference
+                                                            , lightManager.GetLightsBuffer().GetLights()
+                                                            , currentCamera->GetViewMatrix()
+                                                            , glm::inverse(currentCamera->GetProjectionMatrix())
+                                                            , &tileDepth);
+
+                return Argument(std::to_string(mismatches) + " tiles differ from the CPU reference");
+            }
     ));
 
+    console.AddCommand(new CommandCallMethod("lightTree_benchmark", [&](const std::vector<Argument>& args)
+            {
+                std::vector<int> lightCounts = { 1000, 12000, 100000 };
+                if(!args.empty())
+                {
+                    lightCounts.clear();
+                    for(const Argument& arg : args)
+                    {
+                        if(!std::isdigit((unsigned char)arg.value[0]))
+                            return Argument("Light counts have to be positive numbers");
+
+                        lightCounts.push_back(std::atoi(arg.value.c_str()));
+                    }
+                }
+
+                // Same ranges as LightManager's random lights, fixed seed so runs are comparable
+                std::mt19937 generator(1337);
+                std::uniform_real_distribution<float> xDistribution(-14.0f, 14.0f);
+                std::uniform_real_distribution<float> yDistribution(0.0f, 8.0f);
+                std::uniform_real_distribution<float> zDistribution(-6.0f, 6.0f);
+                std::uniform_real_distribution<float> strengthDistribution(0.0f, 2.0f);
 
+                auto viewMatrix = currentCamera->GetViewMatrix();
+                auto projectionMatrixInverse = glm::inverse(currentCamera->GetProjectionMatrix());
+
+                LightTreeCPU tree(lightCullAdaptive.GetMaxLightsPerTile());
+
+                std::string result;
+                for(int lightCount : lightCounts)
+                {
+                    std::vector<LightData> lights((unsigned long)lightCount);
+                    for(LightData& light : lights)
+                    {
+                        light.position = glm::vec3(xDistribution(generator), yDistribution(generator), zDistribution(generator));
+                        light.strength = strengthDistribution(generator);
+                        light.color = glm::vec3(1.0f);
+                        light.lifetime = 0.0f;
+                    }
+
+                    Timer timer;
+                    timer.Start();
+                    tree.Build(lights
+                               , viewMatrix
+                               , projectionMatrixInverse
+                               , glm::ivec2(screenWidth, screenHeight)
+                               , lightCullAdaptive.GetTreeStartDepth()
+                               , lightCullAdaptive.GetTreeMaxDepth());
+                    timer.Stop();
+
+                    Logger::LogLine(LOG_TYPE::INFO, "lightTree_benchmark: ", lightCount, " lights: ", timer.GetTimeMillisecondsFraction(), " ms");
+                    result += std::to_string(lightCount) + " lights: " + std::to_string(timer.GetTimeMillisecondsFraction()) + " ms. ";
+                }
+
+                return Argument(result);
+            }
+    ));
 
     console.AddCommand(new CommandCallMethod("snapshot", [&](const std::vector<Argument>& args)
             {
@@ -486,7 +720,9 @@ void Main::InitInput()
 
 void Main::InitQuieries()
 {
-    glGenQueries(2, queries);
+    opaqueTimer.Init();
+
+    GPUProfiler::Init();
 }
 
 struct LineVertex
@@ -511,6 +747,88 @@ GLVertexBuffer lineVertexBuffer;
 GLIndexBuffer lineIndexBuffer;
 GLDrawBinds lineDrawBinds;
 
+bool Main::StartBenchmark(const std::string& outputPath, const std::vector<int>& lightCounts)
+{
+    std::vector<Benchmark::Run> runs;
+    for(const std::string& cullMode : { "normal", "adaptive" })
+        for(int lightCount : lightCounts)
+            runs.push_back({ cullMode, lightCount });
+
+    // Drop any times left over from a benchmark that was stopped early
+    for(LightCull* lightCull : { (LightCull*)&lightCullNormal, (LightCull*)&lightCullAdaptive, (LightCull*)&lightCullCPU, (LightCull*)&lightCullClustered })
+    {
+        lightCull->FinishTimes();
+        lightCull->TakeTimes();
+    }
+    opaqueTimer.Finish();
+    opaqueTimer.TakeResults();
+
+    return benchmark.Start(runs, outputPath);
+}
+
+bool Main::SetCullMode(const std::string& arg)
+{
+    bool validArg = true;
+    bool debug = false;
+
+    if(arg == "normal")
+    {
+        currentLightCull = &lightCullNormal;
+    }
+    else if(arg == "adaptive")
+    {
+        currentLightCull = &lightCullAdaptive;
+    }
+    else if(arg == "cpu")
+    {
+        currentLightCull = &lightCullCPU;
+    }
+    else if(arg == "clustered")
+    {
+        currentLightCull = &lightCullClustered;
+    }
+    else if(arg == "normalDebug")
+    {
+        currentLightCull = &lightCullNormal;
+        debug = true;
+    }
+    else if(arg == "adaptiveDebug")
+    {
+        currentLightCull = &lightCullAdaptive;
+        debug = true;
+    }
+    else if(arg == "cpuDebug")
+    {
+        currentLightCull = &lightCullCPU;
+        debug = true;
+    }
+    else if(arg == "clusteredDebug")
+    {
+        currentLightCull = &lightCullClustered;
+        debug = true;
+    }
+    else
+        validArg = false;
+
+    if(validArg)
+    {
+        std::string shaderPath;
+
+        if(debug)
+            shaderPath = currentLightCull->GetForwardShaderDebugPath();
+        else
+            shaderPath = currentLightCull->GetForwardShaderPath();
+
+        if(!worldModel->drawBinds.ChangeShader(contentManager, GLEnums::SHADER_TYPE::FRAGMENT, shaderPath))
+            throw "Oh no";
+
+        currentLightCull->SetDrawBindData(worldModel->drawBinds);
+        return true;
+    }
+    else
+        return false;
+}
+
 bool Main::InitFrameBuffers()
 {
     glGenFramebuffers(1, &frameBufferDepthOnly);
@@ -537,6 +855,32 @@ bool Main::InitShaders()
     if(!lightCullNormal.Init(contentManager, console))
         return false;
 
+    lightCullCPU.InitShaderConstants(screenWidth, screenHeight);
+    lightCullCPU.SetLightsBuffer(&lightManager.GetLightsBuffer());
+    lightCullCPU.SetDepthReduction(&depthReduction);
+    if(!lightCullCPU.Init(contentManager, console))
+        return false;
+
+    lightCullClustered.InitShaderConstants(screenWidth, screenHeight);
+    if(!lightCullClustered.Init(contentManager, console))
+        return false;
+
+    if(!depthReduction.Init(contentManager, screenWidth, screenHeight))
+        return false;
+
+    if(!lightManager.Init())
+        return false;
+
+    lightManager.SetDrawBindData(lightCullNormal.lightCullDrawBinds);
+    lightManager.SetDrawBindData(lightCullAdaptive.lightCullDrawBinds);
+    lightManager.SetDrawBindData(lightCullAdaptive.lightReductionDrawBinds);
+    lightManager.SetDrawBindData(lightCullClustered.lightCullDrawBinds);
+
+    depthReduction.SetDrawBindData(lightCullNormal.lightCullDrawBinds);
+    depthReduction.SetDrawBindData(lightCullAdaptive.lightCullDrawBinds);
+    depthReduction.SetDrawBindData(lightCullAdaptive.lightReductionDrawBinds);
+    depthReduction.SetDrawBindData(lightCullClustered.lightCullDrawBinds);
+
     currentLightCull = &lightCullAdaptive;
     //currentLightCull = &lightCullNormal;
 
@@ -560,6 +904,8 @@ bool Main::InitShaders()
 
 void Main::Update(Timer& deltaTimer)
 {
+    PROFILE_ZONE("Main::Update");
+
     if(!console.GetActive())
     {
         if(keysDown.count(KEY_CODE::A))
@@ -585,12 +931,34 @@ void Main::Update(Timer& deltaTimer)
     guiManager.Update(deltaTimer.GetDelta());
 
     contentManager.HotReload();
+    contentManager.FinishAsyncLoads(ASYNC_LOAD_BUDGET);
+
+    lightManager.Update(benchmark.IsRunning() ? BENCHMARK_TIMESTEP : deltaTimer.GetDeltaMillisecondsFraction(), primitiveDrawer);
 
-    lightManager.Update(deltaTimer, primitiveDrawer);
+    // Overrides any camera movement above
+    if(benchmark.IsRunning())
+    {
+        const Benchmark::Run* run = benchmark.BeginFrame(camera);
+        if(run != nullptr)
+        {
+            currentCamera = &camera;
+            SetCullMode(run->cullMode);
+
+            lightManager.Reseed(BENCHMARK_SEED);
+            lightManager.SetLightCount(0);
+            lightManager.SetLightCount(run->lightCount);
+        }
+    }
+    else if(benchmark.IsRecording())
+        benchmark.Record(*currentCamera);
 }
 
 void Main::Render(Timer& deltaTimer)
 {
+    PROFILE_ZONE("Main::Render");
+
+    GPUProfiler::BeginFrame();
+
     auto viewMatrix = currentCamera->GetViewMatrix();
     auto viewMatrixInverse = glm::inverse(currentCamera->GetViewMatrix());
     auto projectionMatrix = currentCamera->GetProjectionMatrix();
@@ -599,7 +967,7 @@ void Main::Render(Timer& deltaTimer)
 
     primitiveDrawer.sphereBinds["viewProjectionMatrix"] = viewProjectionMatrix;
     worldModel->drawBinds["viewProjectionMatrix"] = viewProjectionMatrix;
-    worldModel->drawBinds["Lights"] = &lightManager.GetLightsBuffer();
+    worldModel->depthDrawBinds["viewProjectionMatrix"] = viewProjectionMatrix;
 
     lineDrawBinds["viewProjectionMatrix"] = viewProjectionMatrix;
 
@@ -624,24 +992,51 @@ void Main::Render(Timer& deltaTimer)
     glBindFramebuffer(GL_FRAMEBUFFER, frameBufferDepthOnly);
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+    // Depth prepass
+    {
+        GPU_PROFILE_ZONE("Depth prepass");
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        worldModel->DrawDepth();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    {
+        GPU_PROFILE_ZONE("Depth reduction");
+        depthReduction.Reduce(depthBufferTexture, msaaCount, projectionMatrixInverse);
+    }
+
     // Light pass
-    auto lightCullTime = currentLightCull->TimedDraw(viewMatrix, projectionMatrixInverse);
+    GLuint64 lightCullTime;
+    {
+        GPU_PROFILE_ZONE("Light cull");
+        currentLightCull->SetTimedFrame(benchmark.GetFrameId());
+        lightCullTime = currentLightCull->TimedDraw(viewMatrix, projectionMatrixInverse);
+    }
 
     //worldModel->drawBinds.GetSSBO("TileLights")->Replace(lightCull.GetActiveTileLightsData());
 
-    // Forward pass (opaque)
-    glBeginQuery(GL_TIME_ELAPSED, queries[0]);
-    worldModel->DrawOpaque();
-    glEndQuery(GL_TIME_ELAPSED);
+    // Forward pass (opaque). Depth is already written by the prepass
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_GEQUAL);
 
-    GLint timeAvailable = 0;
-    while(!timeAvailable)
-        glGetQueryObjectiv(queries[0],  GL_QUERY_RESULT_AVAILABLE, &timeAvailable);
+    {
+        GPU_PROFILE_ZONE("Opaque");
 
-    GLuint64 opaqueTime;
-    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &opaqueTime);
+        opaqueTimer.Start(benchmark.GetFrameId());
+        worldModel->DrawOpaque();
+        opaqueTimer.Stop();
+    }
+
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_GREATER);
+
+    GLuint64 opaqueTime = opaqueTimer.GetTime();
 
-    primitiveDrawer.End();
+    {
+        GPU_PROFILE_ZONE("Light spheres");
+        primitiveDrawer.End();
+    }
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -651,12 +1046,17 @@ void Main::Render(Timer& deltaTimer)
     // Forward pass (transparent)
     //worldModel->DrawTransparent(camera.GetPosition());
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBufferDepthOnly);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    // Without a default framebuffer (surfaceless headless) the overlay is drawn to the offscreen one instead
+    if(window.HasDefaultFramebuffer())
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBufferDepthOnly);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, screenWidth, screenHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0); // Bind 0 for screenshots
+    }
 
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0); // Bind 0 for screenshots
     if(dumpPreBackBuffer)
        DumpBackBuffer();
 
@@ -666,6 +1066,8 @@ void Main::Render(Timer& deltaTimer)
 
     spriteRenderer.Begin();
 
+    GPUProfiler::BeginZone("Sprites");
+
     std::string frameString = std::to_string(averageFrameTime) + " [" + std::to_string(lastMinFrameTime) + ";" + std::to_string(lastMaxFrameTime) + " ]";
     spriteRenderer.DrawString(characterSet24, frameString, glm::vec2(0.0f, screenHeight - 48));
     spriteRenderer.DrawString(characterSet24, std::to_string(currentFrameTime), glm::vec2(0.0f, screenHeight - 24));
@@ -679,7 +1081,25 @@ void Main::Render(Timer& deltaTimer)
     if(drawLightCount)
         currentLightCull->DrawLightCount(spriteRenderer, characterSet8, characterSet24);
 
-    guiManager.Draw(&spriteRenderer);
+    if(drawProfiler)
+    {
+        // Last frame's zones, one per line below the frame times
+        std::istringstream profilerLines(Profiler::GetLastFrameString());
+        std::string line;
+        for(float y = screenHeight - 120.0f; std::getline(profilerLines, line) && y >= 0.0f; y -= 24.0f)
+            spriteRenderer.DrawString(characterSet24, line, glm::vec2(0.0f, y));
+    }
+
+    // Flush so the console's sprites aren't batched together with these
+    if(spriteRenderer.AnythingToDraw())
+        spriteRenderer.Draw();
+
+    GPUProfiler::EndZone();
+
+    {
+        GPU_PROFILE_ZONE("Console");
+        guiManager.Draw(&spriteRenderer);
+    }
 
     spriteRenderer.End();
 
@@ -768,12 +1188,21 @@ bool Main::ResizeFramebuffer(int width, int height, bool recreateBuffers)
 
     lightCullAdaptive.ResolutionChanged(width, height);
     lightCullNormal.ResolutionChanged(width, height);
+    lightCullCPU.ResolutionChanged(width, height);
+    lightCullClustered.ResolutionChanged(width, height);
+    depthReduction.ResolutionChanged(width, height);
 
     return true;
 }
 
 void Main::DumpBackBuffer()
 {
+    if(!window.HasDefaultFramebuffer())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "No default framebuffer to take a screenshot of");
+        return;
+    }
+
     ilInit();
 
     if(ilGetError() != 0)
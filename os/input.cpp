@@ -134,6 +134,9 @@ void Input::SetCursorPosition(int xPosition, int yPosition)
         ClientToScreen(listenWindow->GetHWND(), &lockPoint);
         SetCursorPos(lockPoint.x, lockPoint.y);
 #else
+    if(listenWindow->IsHeadless())
+        return;
+
     XWarpPointer(listenWindow->GetDisplay(), None, listenWindow->GetWindow(), 0, 0, 0, 0, xPosition, yPosition);
 #endif
 }
@@ -183,6 +186,9 @@ bool Input::GetAsyncKeyState(KEY_CODE keyCode)
 #ifdef _WIN32
 	return ((::GetAsyncKeyState(KEY_CODEToOSKey(keyCode)) >> 15) & 1) == 1;
 #else // _WIN32
+    if(listenWindow->IsHeadless())
+        return false;
+
     char keys[32];
 
     XQueryKeymap(listenWindow->GetDisplay(), keys);
@@ -495,6 +501,10 @@ int2 Input::QueryMousePosition()
 
 	return { cursorPosition.x, cursorPosition.y };
 #else
+    // No display to ask
+    if(listenWindow->IsHeadless())
+        return { 0, 0 };
+
     Window rootReturn;
     Window childReturn;
 
@@ -3,6 +3,7 @@
 #else
 #include <X11/Xlib.h>
 #include <X11/XKBlib.h>
+#include <EGL/eglext.h>
 #endif
 #include "window.h"
 #include "input.h"
@@ -36,6 +37,12 @@ OSWindow::OSWindow()
 	window = this;
 #else
     XInitThreads();
+
+    display = nullptr;
+    headless = false;
+    eglDisplay = EGL_NO_DISPLAY;
+    eglContext = EGL_NO_CONTEXT;
+    eglSurface = EGL_NO_SURFACE;
 #endif // _WIN32
 }
 
@@ -66,6 +73,13 @@ OSWindow::CREATE_WINDOW_ERROR OSWindow::Create(unsigned int width, unsigned int
     errorCode = CreateXWindow();
 #endif // _WIN32
 
+    EnableDebugOutput();
+
+    return errorCode;
+}
+
+void OSWindow::EnableDebugOutput()
+{
 #ifdef GL_ERROR_CALLBACK
     glEnable(GL_DEBUG_OUTPUT);
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
@@ -80,8 +94,6 @@ OSWindow::CREATE_WINDOW_ERROR OSWindow::Create(unsigned int width, unsigned int
     else
         LOG_DEBUG("GL_ERROR_CALLBACK was defined but glDebugMessageCallback is false");
 #endif
-
-    return errorCode;
 }
 
 #ifdef _WIN32
@@ -471,6 +483,127 @@ Colormap OSWindow::GetColormap()
 {
     return colormap;
 }
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+OSWindow::CREATE_WINDOW_ERROR OSWindow::CreateHeadless(unsigned int width, unsigned int height)
+{
+    this->width = width;
+    this->height = height;
+    this->resizedWidth = width;
+    this->resizedHeight = height;
+
+    headless = true;
+
+    eglDisplay = GetHeadlessDisplay();
+    if(eglDisplay == EGL_NO_DISPLAY
+       || !eglInitialize(eglDisplay, nullptr, nullptr))
+    {
+        CleanUp();
+        return COULDNT_CREATE_DISPLAY;
+    }
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+    {
+        CleanUp();
+        return WELL_SHIT;
+    }
+
+    EGLint configAttributes[] =
+            {
+                    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT
+                    , EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT
+                    , EGL_RED_SIZE, 8
+                    , EGL_GREEN_SIZE, 8
+                    , EGL_BLUE_SIZE, 8
+                    , EGL_ALPHA_SIZE, 8
+                    , EGL_DEPTH_SIZE, 24
+                    , EGL_STENCIL_SIZE, 8
+                    , EGL_NONE
+            };
+
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if(!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        // Surfaceless displays may not have any pbuffer configs
+        configAttributes[1] = 0;
+        if(!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+        {
+            CleanUp();
+            return COULDNT_GET_CONFIG;
+        }
+    }
+
+    EGLint contextAttributes[] =
+            {
+                    EGL_CONTEXT_MAJOR_VERSION, 4
+                    , EGL_CONTEXT_MINOR_VERSION, 5
+                    , EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT
+#ifndef NDEBUG
+                    , EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE
+#endif // NDEBUG
+                    , EGL_NONE
+            };
+
+    eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if(eglContext == EGL_NO_CONTEXT)
+    {
+        CleanUp();
+        return WELL_SHIT;
+    }
+
+    EGLint surfaceAttributes[] =
+            {
+                    EGL_WIDTH, (EGLint)width
+                    , EGL_HEIGHT, (EGLint)height
+                    , EGL_NONE
+            };
+
+    // Main blits to the default framebuffer, so prefer having one
+    eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+    if(eglSurface == EGL_NO_SURFACE)
+        LOG_WARNING("Couldn't create pbuffer, rendering without a default framebuffer");
+
+    if(!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext))
+    {
+        CleanUp();
+        return COULDNT_CREATE_WINDOW;
+    }
+
+    if(gl3wInit() != 0)
+    {
+        CleanUp();
+        return WELL_SHIT;
+    }
+
+    EnableDebugOutput();
+
+    return NONE;
+}
+
+bool OSWindow::IsHeadless() const
+{
+    return headless;
+}
+
+EGLDisplay OSWindow::GetHeadlessDisplay()
+{
+    typedef EGLDisplay (*eglGetPlatformDisplayEXTProc)(EGLenum, void*, const EGLint*);
+
+    // Mesa's surfaceless platform doesn't need a GPU or a display server
+    eglGetPlatformDisplayEXTProc eglGetPlatformDisplayEXT = (eglGetPlatformDisplayEXTProc)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(eglGetPlatformDisplayEXT != nullptr)
+    {
+        EGLDisplay platformDisplay = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if(platformDisplay != EGL_NO_DISPLAY)
+            return platformDisplay;
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
 #endif // _WIN32
 
 bool OSWindow::IsPaused() const
@@ -495,11 +628,28 @@ void OSWindow::SwapBuffers()
 #ifdef _WIN32
 	::SwapBuffers(hdc);
 #else
-    glXSwapBuffers(display, window);
+    if(headless)
+    {
+        if(eglSurface != EGL_NO_SURFACE)
+            eglSwapBuffers(eglDisplay, eglSurface);
+        else
+            glFlush();
+    }
+    else
+        glXSwapBuffers(display, window);
 #endif // _WIN32
 #endif // USE_DX
 }
 
+bool OSWindow::HasDefaultFramebuffer() const
+{
+#ifdef _WIN32
+    return true;
+#else
+    return !headless || eglSurface != EGL_NO_SURFACE;
+#endif // _WIN32
+}
+
 void OSWindow::RegisterFocusLossCallback(std::function<void()> callback)
 {
     focusLossCallback = callback;
@@ -522,6 +672,27 @@ void OSWindow::CleanUp()
 #else
 #ifdef _WIN32
 #else
+    if(headless)
+    {
+        if(eglDisplay != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+            if(eglSurface != EGL_NO_SURFACE)
+                eglDestroySurface(eglDisplay, eglSurface);
+            if(eglContext != EGL_NO_CONTEXT)
+                eglDestroyContext(eglDisplay, eglContext);
+
+            eglTerminate(eglDisplay);
+        }
+
+        eglDisplay = EGL_NO_DISPLAY;
+        eglContext = EGL_NO_CONTEXT;
+        eglSurface = EGL_NO_SURFACE;
+
+        return;
+    }
+
     if(display == nullptr)
         return;
 
@@ -560,6 +731,9 @@ bool OSWindow::PollEvents()
 		DispatchMessage(&msg);
 	}
 #else // _WIN32
+    if(headless)
+        return true;
+
     while(XPending(display) > 0)
     {
         XEvent event;
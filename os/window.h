@@ -6,6 +6,7 @@
 #else
 #include <GL/gl3w.h>
 #include <GL/glx.h>
+#include <EGL/egl.h>
 #endif
 
 #ifdef USE_DX
@@ -73,6 +74,16 @@ public:
 #else // _WIN32
     CREATE_WINDOW_ERROR CreateXWindow();
 
+    /**
+    * Creates an offscreen GL 4.5 context through EGL without X11, for machines
+    * without a display. Renders to a width * height pbuffer, or without any
+    * default framebuffer at all if pbuffers aren't supported.
+    *
+    * PollEvents never returns false and there's no input
+    */
+    CREATE_WINDOW_ERROR CreateHeadless(unsigned int width, unsigned int height);
+    bool IsHeadless() const;
+
 	Display* GetDisplay();
 	Window GetWindow();
 	GLXContext GetContext();
@@ -87,6 +98,11 @@ public:
 	int GetResolutionY() const;
 
     void SwapBuffers();
+    /**
+    * False for headless contexts that couldn't create a pbuffer, anything
+    * drawn to framebuffer 0 is lost then
+    */
+    bool HasDefaultFramebuffer() const;
 
     void RegisterFocusLossCallback(std::function<void()> callback);
 	void RegisterFocusGainCallback(std::function<void()> callback);
@@ -121,10 +137,18 @@ private:
     void CreateXWindow(Window& window, Colormap& colormap, GLXFBConfig fbConfig);
 
     GLXContext CreateContext(GLXFBConfig fbConfig);
+
+    bool headless;
+    EGLDisplay eglDisplay;
+    EGLContext eglContext;
+    EGLSurface eglSurface;
+
+    EGLDisplay GetHeadlessDisplay();
 #endif // _WIN32
 
 	GraphicsSettings* graphicsSettings;
 
+    void EnableDebugOutput();
     void CleanUp();
 };
 
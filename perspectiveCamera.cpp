@@ -134,6 +134,14 @@ void PerspectiveCamera::SetPosition(glm::vec3 position)
 	this->position = position;
 }
 
+void PerspectiveCamera::SetRotation(glm::quat rotation)
+{
+	rotationQuaternion = rotation;
+
+	yaw = glm::yaw(rotationQuaternion);
+	pitch = glm::pitch(rotationQuaternion);
+}
+
 glm::vec3 PerspectiveCamera::GetPosition() const
 {
 	return position;
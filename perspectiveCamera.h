@@ -122,6 +122,12 @@ public:
 	* \param position
 	*/
 	virtual void SetPosition(glm::vec3 position);
+	/**
+	* Sets the camera's rotation, e.g. from GetRotationQuaternion
+	*
+	* \param rotation
+	*/
+	virtual void SetRotation(glm::quat rotation);
 
 	/**
 	* Gets the current position
@@ -221,3 +221,24 @@ void PrimitiveDrawer::DrawSphere(glm::vec3 position, float size, glm::vec3 color
 
     spheres.push_back(instanceData);
 }
+
+void PrimitiveDrawer::DrawSpheres(const SphereBatch& batch)
+{
+    spheres.insert(spheres.end(), batch.spheres.begin(), batch.spheres.end());
+}
+
+void PrimitiveDrawer::SphereBatch::DrawSphere(glm::vec3 position, float size, glm::vec3 color)
+{
+    PrimitiveDrawer::InstanceData instanceData;
+
+    instanceData.color = glm::vec4(color, 1.0f);
+    instanceData.worldMatrix = glm::translate(glm::mat4(), position);
+    instanceData.worldMatrix = glm::scale(instanceData.worldMatrix, glm::vec3(size));
+
+    spheres.push_back(instanceData);
+}
+
+void PrimitiveDrawer::SphereBatch::Clear()
+{
+    spheres.clear();
+}
@@ -18,6 +18,13 @@ public:
 
     void DrawSphere(glm::vec3 position, float size, glm::vec3 color);
 
+    /**
+    * Spheres recorded without touching the drawer, so every thread can fill
+    * its own batch. Add them with DrawSpheres
+    */
+    class SphereBatch;
+    void DrawSpheres(const SphereBatch& batch);
+
 protected:
 private:
     struct Vertex
@@ -52,4 +59,15 @@ private:
     void GenerateSphere(ContentManager& contentManager, float radius, int widthSegments, int heightSegments);
 };
 
+class PrimitiveDrawer::SphereBatch
+{
+    friend class PrimitiveDrawer;
+public:
+    void DrawSphere(glm::vec3 position, float size, glm::vec3 color);
+    void Clear();
+
+private:
+    std::vector<PrimitiveDrawer::InstanceData> spheres;
+};
+
 #endif // PRIMITIVEDRAWER_H__
@@ -0,0 +1,307 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "timer.h"
+#include "logger.h"
+#include "console/console.h"
+#include "console/commandCallMethod.h"
+
+std::mutex Profiler::threadBuffersMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::threadBuffers;
+int Profiler::threadCount = 0;
+
+std::vector<Profiler::Zone> Profiler::lastFrame;
+
+void Profiler::BeginZone(const char* name)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+
+    // Zones that are too deep are still counted so that EndZone matches up
+    if(buffer.depth < MAX_DEPTH)
+    {
+        Zone& zone = buffer.openZones[buffer.depth];
+        zone.name = name;
+        zone.depth = buffer.depth;
+        zone.threadIndex = buffer.threadIndex;
+        zone.start = GetTime();
+    }
+
+    ++buffer.depth;
+}
+
+void Profiler::EndZone()
+{
+    long long end = GetTime();
+
+    ThreadBuffer& buffer = GetThreadBuffer();
+    if(buffer.depth == 0)
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Profiler::EndZone called without a matching BeginZone");
+        return;
+    }
+
+    --buffer.depth;
+    if(buffer.depth >= MAX_DEPTH)
+        return;
+
+    Zone zone = buffer.openZones[buffer.depth];
+    zone.end = end;
+
+    WriteZone(buffer, zone);
+}
+
+long long Profiler::GetTime()
+{
+    static Timer epoch = []()
+    {
+        Timer timer;
+        timer.Start();
+        return timer;
+    }();
+
+    return epoch.GetTimeNanoseconds();
+}
+
+int Profiler::AddTrack(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+    return AddBuffer(name).threadIndex;
+}
+
+void Profiler::RecordZones(int track, const std::vector<Zone>& zones)
+{
+    ThreadBuffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+        buffer = threadBuffers[track].get();
+    }
+
+    for(Zone zone : zones)
+    {
+        zone.threadIndex = track;
+        WriteZone(*buffer, zone);
+    }
+}
+
+void Profiler::EndFrame()
+{
+    lastFrame.clear();
+    {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+        for(const std::unique_ptr<ThreadBuffer>& buffer : threadBuffers)
+            buffer->frameReadIndex = CopyZones(*buffer, buffer->frameReadIndex, lastFrame);
+    }
+
+    std::sort(lastFrame.begin(), lastFrame.end(), [](const Zone& lhs, const Zone& rhs)
+    {
+        if(lhs.threadIndex != rhs.threadIndex)
+            return lhs.threadIndex < rhs.threadIndex;
+        if(lhs.start != rhs.start)
+            return lhs.start < rhs.start;
+
+        return lhs.depth < rhs.depth;
+    });
+}
+
+const std::vector<Profiler::Zone>& Profiler::GetLastFrame()
+{
+    return lastFrame;
+}
+
+std::string Profiler::GetLastFrameString()
+{
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+        for(const std::unique_ptr<ThreadBuffer>& buffer : threadBuffers)
+            names.push_back(buffer->name);
+    }
+
+    std::stringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    int currentThread = -1;
+    for(int i = 0; i < (int)lastFrame.size();)
+    {
+        const Zone& zone = lastFrame[i];
+        if(zone.threadIndex != currentThread)
+        {
+            currentThread = zone.threadIndex;
+            out << names[currentThread] << "\n";
+        }
+
+        long long duration = 0;
+        int count = 0;
+        for(; i < (int)lastFrame.size(); ++i, ++count)
+        {
+            const Zone& other = lastFrame[i];
+            if(other.threadIndex != zone.threadIndex
+               || other.depth != zone.depth
+               || std::string(other.name) != zone.name)
+                break;
+
+            duration += other.end - other.start;
+        }
+
+        out << std::string((unsigned long)(zone.depth + 1) * 2, ' ') << zone.name;
+        if(count > 1)
+            out << " x" << count;
+        out << ": " << duration * 1e-6 << " ms\n";
+    }
+
+    std::string string = out.str();
+    if(!string.empty())
+        string.pop_back(); // Pop \n
+
+    return string;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+    std::vector<Zone> zones;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+        for(const std::unique_ptr<ThreadBuffer>& buffer : threadBuffers)
+        {
+            CopyZones(*buffer, 0, zones);
+            names.push_back(buffer->name);
+        }
+    }
+
+    std::ofstream out(path);
+    if(!out.is_open())
+    {
+        Logger::LogLine(LOG_TYPE::WARNING, "Couldn't open \"" + path + "\" for writing");
+        return false;
+    }
+
+    // Timestamps and durations are in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    for(int i = 0; i < (int)names.size(); ++i)
+    {
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+            << ",\"args\":{\"name\":\"" << names[i] << "\"}},\n";
+    }
+
+    for(int i = 0; i < (int)zones.size(); ++i)
+    {
+        const Zone& zone = zones[i];
+
+        out << "{\"name\":\"";
+        for(const char* c = zone.name; *c != '\0'; ++c)
+        {
+            if(*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+        out << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.threadIndex
+            << ",\"ts\":" << zone.start * 1e-3
+            << ",\"dur\":" << (zone.end - zone.start) * 1e-3
+            << (i + 1 < (int)zones.size() ? "},\n" : "}\n");
+    }
+
+    out << "]}\n";
+
+    return true;
+}
+
+void Profiler::AddConsoleCommands(Console& console)
+{
+    console.AddCommand(new CommandCallMethod("profiler_frame"
+                                             , [](const std::vector<Argument>& args)
+            {
+                if(lastFrame.empty())
+                    return Argument("No zones recorded last frame");
+
+                return Argument(GetLastFrameString());
+            }
+    ));
+
+    console.AddCommand(new CommandCallMethod("profiler_export"
+                                             , [](const std::vector<Argument>& args)
+            {
+                std::string path = args.empty() ? "trace.json" : args.front().value;
+                if(!ExportChromeTrace(path))
+                    return Argument("Couldn't export trace to " + path);
+
+                return Argument("Trace exported to " + path);
+            }
+                                             , FORCE_STRING_ARGUMENTS::PER_ARGUMENT
+    ));
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    if(threadBuffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+        // The first thread to profile anything is the main thread
+        std::string name = threadCount == 0 ? "Main" : "Thread " + std::to_string(threadCount);
+        ++threadCount;
+
+        threadBuffer = &AddBuffer(name);
+    }
+
+    return *threadBuffer;
+}
+
+Profiler::ThreadBuffer& Profiler::AddBuffer(const std::string& name)
+{
+    // Buffers are never freed so that zones from threads that have exited can still be exported
+    std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+    newBuffer->threadIndex = (int)threadBuffers.size();
+    newBuffer->name = name;
+    newBuffer->events.reset(new Zone[EVENT_CAPACITY]);
+    newBuffer->writeIndex = 0;
+    newBuffer->depth = 0;
+    newBuffer->frameReadIndex = 0;
+
+    threadBuffers.push_back(std::move(newBuffer));
+
+    return *threadBuffers.back();
+}
+
+void Profiler::WriteZone(ThreadBuffer& buffer, const Zone& zone)
+{
+    uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+
+    buffer.events[index % EVENT_CAPACITY] = zone;
+
+    buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::CopyZones(const ThreadBuffer& buffer, uint64_t fromIndex, std::vector<Zone>& out)
+{
+    uint64_t end = buffer.writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = std::max(fromIndex, end > EVENT_CAPACITY ? end - EVENT_CAPACITY : 0);
+
+    unsigned long firstOut = out.size();
+    uint64_t index = end;
+    for(; index > begin; --index)
+        out.push_back(buffer.events[(index - 1) % EVENT_CAPACITY]);
+
+    // The owning thread keeps writing while this copies, drop anything that might have been overwritten
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newEnd = buffer.writeIndex.load(std::memory_order_relaxed);
+    uint64_t overwritten = newEnd > EVENT_CAPACITY ? newEnd - EVENT_CAPACITY : 0;
+
+    // out[firstOut + i] was copied from index end - 1 - i
+    if(overwritten > index)
+    {
+        uint64_t valid = end > overwritten ? end - overwritten : 0;
+        out.resize(firstOut + (unsigned long)std::min<uint64_t>(valid, out.size() - firstOut));
+    }
+
+    return end;
+}
@@ -0,0 +1,143 @@
+#ifndef PROFILER_H__
+#define PROFILER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Console;
+
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+/**
+* Profiles the rest of the current scope. name has to be a string literal
+* (or otherwise outlive the profiler) since only the pointer is stored
+*/
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+
+/**
+* Hierarchical CPU profiler.
+*
+* Every thread records its zones into its own ring buffer, so recording never
+* takes a lock. A zone is written once it ends, and the write index is
+* published with release semantics so other threads can read everything
+* before it. Readers copy from the newest event backwards and throw away
+* anything the owning thread might have overwritten while they were copying.
+*
+* Zones that aren't timed on a CPU thread (see GPUProfiler) go on their own
+* track through AddTrack and RecordZones, with times converted to the same
+* timeline.
+*
+* Times are nanoseconds since the profiler was first used.
+*/
+class Profiler
+{
+public:
+    struct Zone
+    {
+        const char* name;
+        long long start;
+        long long end;
+        int depth;
+        // Index of the thread or track that recorded the zone
+        int threadIndex;
+    };
+
+    const static int EVENT_CAPACITY = 1 << 16;
+    const static int MAX_DEPTH = 64;
+
+    static void BeginZone(const char* name);
+    static void EndZone();
+
+    static long long GetTime();
+
+    /**
+    * Adds a track that isn't tied to a thread
+    *
+    * \returns the track's index, pass it to RecordZones
+    */
+    static int AddTrack(const std::string& name);
+    /**
+    * Records already timed zones. Only one thread may record to each track
+    */
+    static void RecordZones(int track, const std::vector<Zone>& zones);
+
+    /**
+    * Collects every zone recorded since the last call. Call once per frame
+    * from the main thread
+    */
+    static void EndFrame();
+    /**
+    * Zones from the last frame, sorted by thread and then start time
+    */
+    static const std::vector<Zone>& GetLastFrame();
+    /**
+    * The last frame as one line per zone, indented by depth. Neighbouring
+    * zones with the same name are merged, e.g. jobs on a worker
+    */
+    static std::string GetLastFrameString();
+
+    /**
+    * Writes everything still in the ring buffers as Chrome trace JSON, which
+    * can be opened in chrome://tracing or Perfetto
+    */
+    static bool ExportChromeTrace(const std::string& path);
+
+    static void AddConsoleCommands(Console& console);
+
+private:
+    struct ThreadBuffer
+    {
+        int threadIndex;
+        std::string name;
+
+        std::unique_ptr<Zone[]> events;
+        std::atomic<uint64_t> writeIndex;
+
+        // Only touched by the owning thread
+        Zone openZones[MAX_DEPTH];
+        int depth;
+
+        // Only touched by EndFrame
+        uint64_t frameReadIndex;
+    };
+
+    static std::mutex threadBuffersMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+    static int threadCount;
+
+    static std::vector<Zone> lastFrame;
+
+    static ThreadBuffer& GetThreadBuffer();
+    // Expects threadBuffersMutex to be locked
+    static ThreadBuffer& AddBuffer(const std::string& name);
+    static void WriteZone(ThreadBuffer& buffer, const Zone& zone);
+    /**
+    * Appends every zone written at or after fromIndex that is still in the
+    * buffer, newest first
+    *
+    * \returns the write index the copy went up to
+    */
+    static uint64_t CopyZones(const ThreadBuffer& buffer, uint64_t fromIndex, std::vector<Zone>& out);
+};
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name)
+    {
+        Profiler::BeginZone(name);
+    }
+    ~ProfileZone()
+    {
+        Profiler::EndZone();
+    }
+
+    ProfileZone(const ProfileZone& other) = delete;
+    ProfileZone& operator=(const ProfileZone& rhs) = delete;
+};
+
+#endif // PROFILER_H__
@@ -1,6 +1,7 @@
 #include "spriteRenderer.h"
 
 #include "logger.h"
+#include "profiler.h"
 
 #include "content/textureCreationParameters.h"
 #include "content/shaderContentParameters.h"
@@ -10,8 +11,11 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+const glm::vec2 SpriteRenderer::SOLID_TEX_COORDS(-1.0f, -1.0f);
+
 SpriteRenderer::SpriteRenderer()
 	: hasBegun(false)
+	, instanced(true)
 	, bufferInserts(-1)
 	, whiteTexture(nullptr)
 	, currentTexture(0)
@@ -22,9 +26,10 @@ SpriteRenderer::~SpriteRenderer()
 {
 }
 
-bool SpriteRenderer::Init(ContentManager& contentManager, int screenWidth, int screenHeight)
+bool SpriteRenderer::Init(ContentManager& contentManager, int screenWidth, int screenHeight, bool instanced /*= true*/)
 {
 	hasBegun = false;
+	this->instanced = instanced;
 
     SetScreenSize(screenWidth, screenHeight);
 
@@ -45,11 +50,33 @@ bool SpriteRenderer::Init(ContentManager& contentManager, int screenWidth, int s
 	}
 
 
+	if(instanced)
+	{
+		instanceBuffer.Init<glm::vec4, glm::vec4, glm::vec4>(GLEnums::BUFFER_USAGE::STREAM_DRAW, nullptr, MAX_BUFFER_INSERTS * RING_BATCH_COUNT);
+		quadIndexBuffer.Init(GLEnums::BUFFER_USAGE::STATIC_DRAW, std::vector<GLint>{ 0, 3, 2, 2, 1, 0 });
+
+		GLInputLayout instanceInputLayout;
+		instanceInputLayout.SetInputLayout<glm::vec4, glm::vec4, glm::vec4>();
+		instanceInputLayout.SetVertexAttribDivisor(0, 1); // position
+		instanceInputLayout.SetVertexAttribDivisor(1, 1); // texCoords
+		instanceInputLayout.SetVertexAttribDivisor(2, 1); // color
+
+		instancedDrawBinds.AddShaders(contentManager
+									  , GLEnums::SHADER_TYPE::VERTEX, "rendering/spriteInstancedVertex.glsl"
+									  , GLEnums::SHADER_TYPE::FRAGMENT, "rendering/spritePixel.glsl");
+
+		instancedDrawBinds.AddBuffers(&instanceBuffer, instanceInputLayout, &quadIndexBuffer);
+
+		instancedDrawBinds.AddUniform("viewProjMatrix", viewProjectionMatrix);
+
+		return instancedDrawBinds.Init();
+	}
+
 	////////////////////////////////////////////////////////////
 	//Create buffers
 	////////////////////////////////////////////////////////////
-    vertexBuffer.Init<glm::vec2, glm::vec2, glm::vec4>(GLEnums::BUFFER_USAGE::STREAM_DRAW, nullptr, MAX_VERTEX_BUFFER_INSERTS);
-    indexBuffer.Init<GLuint>(GLEnums::BUFFER_USAGE::STREAM_DRAW, nullptr, MAX_INDEX_BUFFER_INSERTS);
+    vertexBuffer.Init<glm::vec2, glm::vec2, glm::vec4>(GLEnums::BUFFER_USAGE::STREAM_DRAW, nullptr, MAX_VERTEX_BUFFER_INSERTS * RING_BATCH_COUNT);
+    indexBuffer.Init<GLuint>(GLEnums::BUFFER_USAGE::STREAM_DRAW, nullptr, MAX_INDEX_BUFFER_INSERTS * RING_BATCH_COUNT);
 
 	//////////////////////////////////////////////////////////////////////////
 	//Shaders
@@ -95,8 +122,11 @@ void SpriteRenderer::End()
 	if(spriteBatch.size() > 0)
 		Draw();
 
-	//Unbind
-	drawBinds.Unbind();
+	//Unbind, only the draw binds matching the mode are initialized
+	if(instanced)
+		instancedDrawBinds.Unbind();
+	else
+		drawBinds.Unbind();
 
 	hasBegun = false;
 }
@@ -108,11 +138,7 @@ void SpriteRenderer::Draw(const Texture& texture2D, const Rect& drawRect, glm::v
 
 void SpriteRenderer::Draw(const Texture& texture2D, glm::vec2 position, const Rect& clipRect, glm::vec4 color)
 {
-    const glm::vec2 prediv(texture2D.GetPredivWidth(), texture2D.GetPredivHeight());
-
     glm::vec2 texCoordsMax = position + glm::vec2(clipRect.GetWidth(), clipRect.GetHeight());
-    glm::vec2 clipMin = clipRect.GetMinPosition() * prediv;
-    glm::vec2 clipMax = clipRect.GetMaxPosition() * prediv;
 
 	if(currentTexture != texture2D.GetTexture())
 		AddNewBatch(texture2D);
@@ -120,45 +146,42 @@ void SpriteRenderer::Draw(const Texture& texture2D, glm::vec2 position, const Re
 	AddDataToBatch(BatchData(
 				position
 				, texCoordsMax
-				, clipMin
-				, clipMax
+				, clipRect.GetMinPosition()
+				, clipRect.GetMaxPosition()
 				, color));
 	}
 
 void SpriteRenderer::Draw(const Texture& texture2D, const Rect& position, const Rect& clipRect, glm::vec4 color)
 {
-	glm::vec2 tempFloat2 = clipRect.GetMinPosition();
-	glm::vec2 predivSize = glm::vec2(texture2D.GetPredivWidth(), texture2D.GetPredivHeight());
-
-    glm::vec2 clipMin = clipRect.GetMinPosition() * predivSize;
-    glm::vec2 clipMax = clipRect.GetMaxPosition() * predivSize;
-
 	if(currentTexture != texture2D.GetTexture())
 		AddNewBatch(texture2D);
 
 	AddDataToBatch(BatchData(
 		position.GetMinPosition()
 		, position.GetMaxPosition()
-		, clipMin
-		, clipMax
+		, clipRect.GetMinPosition()
+		, clipRect.GetMaxPosition()
 		, color));
 	}
 
 void SpriteRenderer::Draw(const Rect& drawRect, glm::vec4 color /*= glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)*/)
 {
-	if(currentTexture != whiteTexture->GetTexture())
+	// Solid rectangles don't sample, so they can go into whatever batch is current
+	if(currentTexture == 0)
 		AddNewBatch(*whiteTexture);
 
 	AddDataToBatch(BatchData(
 		drawRect.GetMinPosition()
 		, drawRect.GetMaxPosition()
-		, glm::vec2(0.0f, 0.0f)
-		, glm::vec2(1.0f, 1.0f)
+		, SOLID_TEX_COORDS
+		, SOLID_TEX_COORDS
 		, color));
 }
 
 void SpriteRenderer::Draw()
 {
+    PROFILE_ZONE("SpriteRenderer::Draw");
+
     // TODO
 //	vertexShader->Bind(deviceContext);
 //	pixelShader->Bind(deviceContext);
@@ -174,36 +197,66 @@ void SpriteRenderer::Draw()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glBlendEquation(GL_FUNC_ADD);
 
-    indexBuffer.Update(indicies);
-    vertexBuffer.Update(&vertices[0], sizeof(Vertex2D) * vertices.size());
-
-    drawBinds.Bind();
-    drawBinds["viewProjMatrix"] = viewProjectionMatrix;
-
 	AddNewBatch(*whiteTexture);
 	spriteBatch.pop_back();
 
-    //GLBufferLock vertexLock(vertexBuffer);
-    //GLBufferLock indexLock(indexBuffer);
-
-	for(const SpriteBatch& batch : spriteBatch)
-	{
-		//deviceContext->PSSetShaderResources(0, 1, &batch.textureResourceView)-;
-		//deviceContext->DrawIndexed(batch.size, batch.offset, 0);
-		glBindTexture(GL_TEXTURE_2D, batch.texture);
-
-        drawBinds.DrawElements(batch.size, batch.offset);
-	}
+    if(instanced)
+    {
+        // Batch offsets and sizes are in instances here
+        GLint baseInstance = -1;
+        if(!instances.empty())
+            baseInstance = instanceBuffer.Append(instances);
+
+        instancedDrawBinds.Bind();
+        instancedDrawBinds["viewProjMatrix"] = viewProjectionMatrix;
+
+        if(baseInstance != -1)
+        {
+            for(const SpriteBatch& batch : spriteBatch)
+            {
+                glBindTexture(GL_TEXTURE_2D, batch.texture);
+
+                instancedDrawBinds.DrawElementsInstanced(6, batch.size, baseInstance + batch.offset);
+            }
+        }
+
+        instancedDrawBinds.Unbind();
+    }
+    else
+    {
+        // Indicies start at 0 every flush, the base vertex moves them to where the vertices were appended
+        GLint baseVertex = -1;
+        GLsizei firstIndex = -1;
+        if(!indicies.empty())
+        {
+            baseVertex = vertexBuffer.Append(vertices);
+            firstIndex = indexBuffer.Append(indicies);
+        }
+
+        drawBinds.Bind();
+        drawBinds["viewProjMatrix"] = viewProjectionMatrix;
+
+        if(baseVertex != -1 && firstIndex != -1)
+        {
+            for(const SpriteBatch& batch : spriteBatch)
+            {
+                glBindTexture(GL_TEXTURE_2D, batch.texture);
+
+                drawBinds.DrawElementsBaseVertex(batch.size, firstIndex + batch.offset, baseVertex);
+            }
+        }
+
+        drawBinds.Unbind();
+    }
 
 	vertices.clear();
 	indicies.clear();
+	instances.clear();
 
 	spriteBatch.clear();
 	currentTexture = 0;
 
 	bufferInserts = 0;
-
-    drawBinds.Unbind();
 }
 
 void SpriteRenderer::EnableScissorTest(const Rect& region)
@@ -244,12 +297,12 @@ void SpriteRenderer::AddNewBatch(const Texture& newTexture)
 
 	if(spriteBatch.size() == 1)
 	{
-		spriteBatch.back().size = static_cast<unsigned int>(indicies.size());
+		spriteBatch.back().size = GetQueuedCount();
 	}
 	else if(spriteBatch.size() > 1)
 	{
 		spriteBatch.back().offset = spriteBatch[spriteBatch.size() - 2].offset + spriteBatch[spriteBatch.size() - 2].size;
-		spriteBatch.back().size = static_cast<unsigned int>(indicies.size() - spriteBatch.back().offset);
+		spriteBatch.back().size = GetQueuedCount() - spriteBatch.back().offset;
 	}
 
 	spriteBatch.emplace_back(newTexture.GetTexture());
@@ -262,25 +315,32 @@ void SpriteRenderer::AddDataToBatch(const BatchData& data)
 	timer.Start();
 #endif // DETAILED_GRAPHS
 
-	//Top left
-	vertices.emplace_back(data.positionMin, data.texCoordsMin, data.color);
+	if(instanced)
+	{
+		instances.push_back(data);
+	}
+	else
+	{
+		//Top left
+		vertices.emplace_back(data.positionMin, data.texCoordsMin, data.color);
 
-	//Top right
-	vertices.emplace_back(data.positionMax.x, data.positionMin.y, data.texCoordsMax.x, data.texCoordsMin.y, data.color);
+		//Top right
+		vertices.emplace_back(data.positionMax.x, data.positionMin.y, data.texCoordsMax.x, data.texCoordsMin.y, data.color);
 
-	//Bottom right
-	vertices.emplace_back(data.positionMax, data.texCoordsMax, data.color);
+		//Bottom right
+		vertices.emplace_back(data.positionMax, data.texCoordsMax, data.color);
 
-	//Bottom left
-	vertices.emplace_back(data.positionMin.x, data.positionMax.y, data.texCoordsMin.x, data.texCoordsMax.y, data.color);
+		//Bottom left
+		vertices.emplace_back(data.positionMin.x, data.positionMax.y, data.texCoordsMin.x, data.texCoordsMax.y, data.color);
 
-	//ELEMENT BUFFER
-	indicies.emplace_back(bufferInserts * 4); //Top left
-	indicies.emplace_back(bufferInserts * 4 + 3); //Bottom left
-	indicies.emplace_back(bufferInserts * 4 + 2); //Bottom right
-	indicies.emplace_back(bufferInserts * 4 + 2); //Bottom right
-	indicies.emplace_back(bufferInserts * 4 + 1); //Top right
-	indicies.emplace_back(bufferInserts * 4); //Top left
+		//ELEMENT BUFFER
+		indicies.emplace_back(bufferInserts * 4); //Top left
+		indicies.emplace_back(bufferInserts * 4 + 3); //Bottom left
+		indicies.emplace_back(bufferInserts * 4 + 2); //Bottom right
+		indicies.emplace_back(bufferInserts * 4 + 2); //Bottom right
+		indicies.emplace_back(bufferInserts * 4 + 1); //Top right
+		indicies.emplace_back(bufferInserts * 4); //Top left
+	}
 
 #ifdef DETAILED_GRAPHS
 	timer.Stop();
@@ -292,54 +352,53 @@ void SpriteRenderer::AddDataToBatch(const BatchData& data)
 		Draw();
 }
 
+unsigned int SpriteRenderer::GetQueuedCount() const
+{
+	return static_cast<unsigned int>(instanced ? instances.size() : indicies.size());
+}
+
 void SpriteRenderer::DrawString(const CharacterSet* characterSet, const std::string& text, glm::vec2 position, int maxWidth, glm::vec4 color /*= glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)*/)
 {
 	//This method would use an unsigned int for maxWidth but workarounds/hacks should allow a negative width on characters.
 	//Besides, 0x7FFFFFFF should be plenty for maxWidth
-	int currentWidth = 0;
-
-	for(int i = 0, end = static_cast<int>(text.size()); i < end; ++i)
-	{
-		const Character* character = characterSet->GetCharacter(text[i]);
-
-		if(currentWidth + character->xAdvance > maxWidth)
-			return;
-
-		glm::vec2 drawPosition(position.x + character->xOffset, position.y + characterSet->GetLineHeight() - character->yOffset);
-
-		Draw(*characterSet->GetTexture(), drawPosition, Rect(character->x, character->y, character->width, character->height), color);
-		position.x += character->xAdvance;
-
-		currentWidth += character->xAdvance;
-	}
+	DrawRun(characterSet, characterSet->GetCachedRun(text.c_str(), text.size(), maxWidth), position, color);
 }
 
 glm::vec2 SpriteRenderer::DrawString(const CharacterSet* characterSet, const std::string& text, glm::vec2 position, glm::vec4 color)
 {
-	for(int i = 0, end = static_cast<int>(text.size()); i < end; ++i) //TODO: Optimize, bulk draw instead of calling Draw( ... )
-	{
-		const Character* character = characterSet->GetCharacter(text[i]);
-
-		glm::vec2 drawPosition(position.x + character->xOffset, position.y + characterSet->GetLineHeight() - character->yOffset);
+	const TextRun& run = characterSet->GetCachedRun(text.c_str(), text.size());
+	DrawRun(characterSet, run, position, color);
 
-		Draw(*characterSet->GetTexture(), drawPosition, Rect(character->x, character->y, character->width, character->height), color);
-		position.x += character->xAdvance;
-	}
-
-	return position;
+	return glm::vec2(position.x + run.advance, position.y);
 }
 
 glm::vec2 SpriteRenderer::DrawString(const CharacterSet* characterSet, const std::string& text, glm::vec2 position, unsigned int startIndex, unsigned int count, glm::vec4 color)
 {
-	for(int i = startIndex, end = startIndex + count; i < end; ++i)
-	{
-		const Character* character = characterSet->GetCharacter(text[i]);
+	const TextRun& run = characterSet->GetCachedRun(text.c_str() + startIndex, count);
+	DrawRun(characterSet, run, position, color);
 
-		glm::vec2 drawPosition(position.x + character->xOffset, position.y + characterSet->GetLineHeight() - character->yOffset);
+	return glm::vec2(position.x + run.advance, position.y);
+}
 
-		Draw(*characterSet->GetTexture(), drawPosition, Rect(character->x, character->y, character->width, character->height), color);
-		position.x += character->xAdvance;
-	}
+void SpriteRenderer::DrawRun(const CharacterSet* characterSet, const TextRun& run, glm::vec2 position, glm::vec4 color /*= glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)*/)
+{
+	const Texture& texture = *characterSet->GetTexture();
 
-	return position;
+	for(const GlyphQuad& glyph : run.glyphs)
+	{
+		// Spaces and other empty glyphs only move the pen
+		if(glyph.positionMin.x == glyph.positionMax.x)
+			continue;
+
+		// Checked every glyph since a full buffer is drawn and starts over without a batch
+		if(currentTexture != texture.GetTexture())
+			AddNewBatch(texture);
+
+		AddDataToBatch(BatchData(
+			position + glyph.positionMin
+			, position + glyph.positionMax
+			, glyph.texCoordsMin
+			, glyph.texCoordsMax
+			, color));
+	}
 }
@@ -9,6 +9,8 @@
 
 #include "rect.h"
 #include "gl/glDrawBinds.h"
+#include "gl/glStreamingVertexBuffer.h"
+#include "gl/glStreamingIndexBuffer.h"
 
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
@@ -30,7 +32,11 @@ public:
 	SpriteRenderer();
 	~SpriteRenderer();
 
-	bool Init(ContentManager& contentManager, int screenWidth, int screenHeight);
+	/**
+	* \param instanced upload one BatchData per sprite and expand the quads in
+	* the vertex shader instead of uploading four vertices and six indicies
+	*/
+	bool Init(ContentManager& contentManager, int screenWidth, int screenHeight, bool instanced = true);
 	void SetScreenSize(int width, int height);
 
 	void Begin();
@@ -62,6 +68,15 @@ public:
 	* \returns cursor position after drawing
 	*/
 	glm::vec2 DrawString(const CharacterSet* characterSet, const std::string&, glm::vec2 position, unsigned int startIndex, unsigned int count, glm::vec4 color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+	/**
+	* Draws a run laid out by \p characterSet with its origin at \p position
+	*
+	* \param characterSet the character set the run was laid out with
+	* \param run
+	* \param position
+	* \param color
+	*/
+	void DrawRun(const CharacterSet* characterSet, const TextRun& run, glm::vec2 position, glm::vec4 color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 
 	/**
 	* Draws \p texture2D into \p drawRect
@@ -144,12 +159,17 @@ private:
 		glm::vec2 positionMin;
 		glm::vec2 positionMax;
 
+		// In texels, the vertex shaders divide by the size of the texture when it's drawn.
+		// Textures such as GlyphAtlas can grow while sprites that use them are queued
 		glm::vec2 texCoordsMin;
 		glm::vec2 texCoordsMax;
 
 		glm::vec4 color;
 	};
 
+	// Uploaded as is when instanced, spriteInstancedVertex.glsl reads it as three vec4s
+	static_assert(sizeof(BatchData) == 48, "BatchData has to match the instance input layout");
+
 	struct SpriteBatch
 	{
 		SpriteBatch()
@@ -191,7 +211,7 @@ private:
 		~Vertex2D() = default;
 
 		glm::vec2 position; //8 bytes
-		glm::vec2 texCoords; //8 bytes
+		glm::vec2 texCoords; //8 bytes, in texels
 		glm::vec4 color; //16 bytes
 	};
 
@@ -215,7 +235,13 @@ private:
 	void AddNewBatch(const Texture& newTexture);
 	void AddDataToBatch(const BatchData& data);
 
+	/**
+	* Indicies or instances queued since the last Draw, depending on the mode
+	*/
+	unsigned int GetQueuedCount() const;
+
 	bool hasBegun;
+	bool instanced;
 
 	//D3D11_RECT defaultScissorRect;
 
@@ -228,12 +254,18 @@ private:
 	//PixelShader* pixelShader;
 	glm::mat4x4 viewProjectionMatrix;
 
-	// TODO: Stream buffers
-	GLVertexBuffer vertexBuffer;
-	GLIndexBuffer indexBuffer;
+	// Appended to as rings, see GLStreamingBuffer
+	GLStreamingVertexBuffer vertexBuffer;
+	GLStreamingIndexBuffer indexBuffer;
 
     GLDrawBinds drawBinds;
 
+	// Used instead of the buffers above when instanced
+	GLStreamingVertexBuffer instanceBuffer;
+	GLIndexBuffer quadIndexBuffer;
+
+	GLDrawBinds instancedDrawBinds;
+
 	/**
 	* Max inserts per batch. 1 batch = 1 draw call
 	*/
@@ -245,6 +277,18 @@ private:
 	const static unsigned int MAX_INDEX_BUFFER_INSERTS = MAX_BUFFER_INSERTS * 6;
 	const static unsigned int INDEX_BUFFER_SIZE = MAX_INDEX_BUFFER_INSERTS * sizeof(unsigned int);
 
+	/**
+	* Texture coordinates of solid rectangles. spritePixel.glsl uses white
+	* instead of sampling when it sees them, which means every texture has a
+	* white texel and rectangles never break a batch
+	*/
+	const static glm::vec2 SOLID_TEX_COORDS;
+
+	/**
+	* How many full batches fit in the buffers before they wrap around
+	*/
+	const static unsigned int RING_BATCH_COUNT = 4;
+
 	unsigned int bufferInserts;
 
 	std::vector<SpriteBatch> spriteBatch;
@@ -252,6 +296,8 @@ private:
 	std::vector<Vertex2D> vertices;
 	std::vector<GLuint> indicies;
 
+	std::vector<BatchData> instances;
+
 	//For easy drawing of rectangles via Draw()
 	Texture* whiteTexture;
 	Rect whiteTextureClipRect;
@@ -0,0 +1,89 @@
+#include "tileCulling.h"
+
+#include <limits>
+
+namespace TileCulling
+{
+    namespace
+    {
+        const int BOTTOM_LEFT = 0;
+        const int BOTTOM_RIGHT = 1;
+        const int TOP_RIGHT = 2;
+        const int TOP_LEFT = 3;
+        const int CENTER = 4;
+
+        // Same as CreatePlane in planes.glsl, the distance is always 0 since all planes go through the origin
+        glm::vec3 CreatePlane(glm::vec3 far0, glm::vec3 far1)
+        {
+            return glm::normalize(glm::cross(far0, far1));
+        }
+    }
+
+    TileFrustum CreateTileFrustum(glm::ivec2 tile
+                                  , glm::vec2 tileSize
+                                  , glm::vec2 screenSize
+                                  , const glm::mat4& projectionMatrixInverse)
+    {
+        const glm::vec2 offsets[5] =
+                {
+                        glm::vec2(0.0f, 0.0f)
+                        , glm::vec2(1.0f, 0.0f)
+                        , glm::vec2(1.0f, 1.0f)
+                        , glm::vec2(0.0f, 1.0f)
+                        , glm::vec2(0.5f, 0.5f)
+                };
+
+        glm::vec3 viewPositions[5];
+        for(int i = 0; i < 5; ++i)
+        {
+            glm::vec2 ndcPosition = ((glm::vec2(tile) + offsets[i]) * tileSize) / screenSize;
+            ndcPosition = ndcPosition * 2.0f - 1.0f;
+
+            glm::vec4 unprojectedPosition = projectionMatrixInverse * glm::vec4(ndcPosition, 1.0f, 1.0f);
+            viewPositions[i] = glm::vec3(unprojectedPosition / unprojectedPosition.w);
+        }
+
+        TileFrustum frustum;
+        frustum.planes[0] = CreatePlane(viewPositions[TOP_RIGHT], viewPositions[TOP_LEFT]);
+        frustum.planes[1] = CreatePlane(viewPositions[BOTTOM_LEFT], viewPositions[BOTTOM_RIGHT]);
+        frustum.planes[2] = CreatePlane(viewPositions[TOP_LEFT], viewPositions[BOTTOM_LEFT]);
+        frustum.planes[3] = CreatePlane(viewPositions[BOTTOM_RIGHT], viewPositions[TOP_RIGHT]);
+        // Only the sign of the dot product is used, no need to normalize
+        frustum.forward = viewPositions[CENTER];
+
+        return frustum;
+    }
+
+    bool LightInsideTile(float x
+                         , float y
+                         , float z
+                         , float radius
+                         , const TileFrustum& frustum
+                         , glm::vec2 depthBounds)
+    {
+        // Same as InsideTileDepth in tileDepth.glsl
+        if(z + radius < depthBounds.x || z - radius > depthBounds.y)
+            return false;
+
+        if(x * x + y * y + z * z <= radius * radius)
+            return true;
+
+        const glm::vec3& forward = frustum.forward;
+        if(x * forward.x + y * forward.y + z * forward.z <= 0.0f)
+            return false;
+
+        for(int i = 0; i < 4; ++i)
+        {
+            const glm::vec3& plane = frustum.planes[i];
+            if(x * plane.x + y * plane.y + z * plane.z < -radius)
+                return false;
+        }
+
+        return true;
+    }
+
+    glm::vec2 GetUnboundedDepth()
+    {
+        return glm::vec2(-std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    }
+}
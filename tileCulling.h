@@ -0,0 +1,40 @@
+#ifndef TILECULLING_H__
+#define TILECULLING_H__
+
+#include <glm/glm.hpp>
+
+/**
+ * CPU versions of the tile tests used by the light culling shaders,
+ * see CreateFarPoints and CreatePlanes in planes.glsl
+ */
+namespace TileCulling
+{
+    struct TileFrustum
+    {
+        // Top, bottom, left, right. All planes go through the origin
+        glm::vec3 planes[4];
+        // Direction through the center of the tile, not normalized
+        glm::vec3 forward;
+    };
+
+    TileFrustum CreateTileFrustum(glm::ivec2 tile
+                                  , glm::vec2 tileSize
+                                  , glm::vec2 screenSize
+                                  , const glm::mat4& projectionMatrixInverse);
+
+    /**
+     * \param x, y, z view space light position
+     * \param depthBounds min and max view space depth of the tile, see InsideTileDepth in tileDepth.glsl
+     */
+    bool LightInsideTile(float x
+                         , float y
+                         , float z
+                         , float radius
+                         , const TileFrustum& frustum
+                         , glm::vec2 depthBounds);
+
+    // Bounds that let every light through
+    glm::vec2 GetUnboundedDepth();
+}
+
+#endif // TILECULLING_H__
@@ -0,0 +1,103 @@
+#include "workerPool.h"
+
+WorkerPool::WorkerPool()
+        : currentJob(nullptr)
+          , jobCount(0)
+          , nextJob(0)
+          , activeWorkers(0)
+          , generation(0)
+          , quit(false)
+{}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+void WorkerPool::Init(int threadCount)
+{
+    Stop();
+
+    quit = false;
+    for(int i = 1; i < threadCount; ++i)
+        threads.emplace_back(&WorkerPool::WorkerMain, this, i, generation);
+}
+
+int WorkerPool::GetThreadCount() const
+{
+    return (int)threads.size() + 1;
+}
+
+void WorkerPool::ParallelFor(int jobCount, const std::function<void(int, int)>& job)
+{
+    if(threads.empty() || jobCount <= 1)
+    {
+        for(int i = 0; i < jobCount; ++i)
+            job(i, 0);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        currentJob = &job;
+        this->jobCount = jobCount;
+        nextJob = 0;
+        activeWorkers = (int)threads.size();
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    RunJobs(0);
+
+    // Workers still hold a pointer to job until they are done
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [&]() { return activeWorkers == 0; });
+
+    currentJob = nullptr;
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCondition.notify_all();
+
+    for(std::thread& thread : threads)
+        thread.join();
+
+    threads.clear();
+}
+
+void WorkerPool::WorkerMain(int threadIndex, unsigned long lastGeneration)
+{
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&]() { return quit || generation != lastGeneration; });
+
+            if(quit)
+                return;
+
+            lastGeneration = generation;
+        }
+
+        RunJobs(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--activeWorkers == 0)
+                doneCondition.notify_one();
+        }
+    }
+}
+
+void WorkerPool::RunJobs(int threadIndex)
+{
+    for(int i = nextJob++; i < jobCount; i = nextJob++)
+        (*currentJob)(i, threadIndex);
+}
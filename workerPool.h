@@ -0,0 +1,62 @@
+#ifndef WORKERPOOL_H__
+#define WORKERPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* A fixed set of threads that run ParallelFor jobs.
+*
+* The calling thread helps out, so a pool with a thread count of 1 has no
+* workers and runs everything inline. Jobs are handed out in any order, so
+* anything that should be reproducible has to depend on the job index rather
+* than the thread index.
+*/
+class WorkerPool
+{
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool& other) = delete;
+    WorkerPool& operator=(const WorkerPool& rhs) = delete;
+
+    /**
+    * Starts threadCount - 1 workers, stopping any previous ones
+    */
+    void Init(int threadCount);
+
+    int GetThreadCount() const;
+
+    /**
+    * Calls job(jobIndex, threadIndex) for every jobIndex in [0, jobCount) and
+    * returns once all of them are done. threadIndex is in [0, GetThreadCount())
+    * and 0 is the calling thread
+    */
+    void ParallelFor(int jobCount, const std::function<void(int, int)>& job);
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(int, int)>* currentJob;
+    int jobCount;
+    std::atomic<int> nextJob;
+    int activeWorkers;
+    unsigned long generation;
+    bool quit;
+
+    void Stop();
+    // lastGeneration is the generation when the worker was started, so it doesn't run old jobs
+    void WorkerMain(int threadIndex, unsigned long lastGeneration);
+    void RunJobs(int threadIndex);
+};
+
+#endif // WORKERPOOL_H__